@@ -5,6 +5,7 @@
 
 #include "MaterialDomain.h"
 #include "Brushes/SlateColorBrush.h"
+#include "Materials/MaterialInstanceConstant.h"
 
 
 UMGFXMaterial::UMGFXMaterial()
@@ -16,6 +17,7 @@ UMGFXMaterial::UMGFXMaterial()
 	  bOverrideDesignerBackground(false)
 {
 	DesignerBackground = FSlateColorBrush(FLinearColor(0.005f, 0.005f, 0.005f));
+	SharedMaterialDirectory.Path = TEXT("/Game/MGFX/SharedMaterials");
 }
 
 void UMGFXMaterial::GetAllLayers(TArray<UMGFXMaterialLayer*>& OutLayers) const
@@ -29,6 +31,20 @@ void UMGFXMaterial::GetAllLayers(TArray<UMGFXMaterialLayer*>& OutLayers) const
 	}
 }
 
+bool UMGFXMaterial::UsesSharedMaterial() const
+{
+	return bUseSharedMaterial && GeneratorBackend != EMGFXMaterialGeneratorBackend::Interpreted;
+}
+
+UMaterialInterface* UMGFXMaterial::GetOutputMaterial() const
+{
+	if (UsesSharedMaterial() && MaterialInstance)
+	{
+		return MaterialInstance;
+	}
+	return Material;
+}
+
 void UMGFXMaterial::PostLoad()
 {
 	UObject::PostLoad();
@@ -0,0 +1,299 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "MGFXMaterialBaker.h"
+
+#include "MGFXMaterial.h"
+#include "MGFXMaterialEvaluator.h"
+#include "Async/ParallelFor.h"
+#include "Engine/Texture2D.h"
+
+
+FIntPoint FMGFXMaterialBaker::GetBakeResolution(const UMGFXMaterial* MGFXMaterial, const FMGFXBakeSettings& Settings)
+{
+	if (Settings.Resolution.X > 0 && Settings.Resolution.Y > 0)
+	{
+		return Settings.Resolution;
+	}
+
+	return FIntPoint(FMath::CeilToInt(MGFXMaterial->BaseCanvasSize.X), FMath::CeilToInt(MGFXMaterial->BaseCanvasSize.Y));
+}
+
+bool FMGFXMaterialBaker::Bake(const UMGFXMaterial* MGFXMaterial, const FMGFXBakeSettings& Settings, FMGFXBakedImage& OutImage)
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialBaker_Bake, FColor::Green);
+
+	OutImage = FMGFXBakedImage();
+	if (!MGFXMaterial)
+	{
+		return false;
+	}
+
+	const FIntPoint Size = GetBakeResolution(MGFXMaterial, Settings);
+	if (Size.X <= 0 || Size.Y <= 0)
+	{
+		return false;
+	}
+
+	const FMGFXMaterialEvaluator Evaluator(MGFXMaterial);
+	OutImage.bIsComplete = Evaluator.CanEvaluateAllShapes();
+
+	// pixels cover the whole canvas, matching a quad with 0-1 uvs
+	const FVector2f PixelScale = MGFXMaterial->BaseCanvasSize / FVector2f(Size);
+
+	// MGFX_FilterWidth uses the largest derivative of the canvas uvs
+	const float PixelSize = FMath::Max(PixelScale.X, PixelScale.Y);
+
+	OutImage.Size = Size;
+	OutImage.Colors.SetNumUninitialized(Size.X * Size.Y);
+
+	// the distance field is computed from the final coverage, so that it matches the composited layers
+	TArray<float> Coverage;
+	if (Settings.bBakeDistanceField)
+	{
+		Coverage.SetNumUninitialized(Size.X * Size.Y);
+	}
+
+	const FIntPoint NumTiles(FMath::DivideAndRoundUp(Size.X, TileSize), FMath::DivideAndRoundUp(Size.Y, TileSize));
+	ParallelFor(NumTiles.X * NumTiles.Y, [&](int32 TileIdx)
+	{
+		const FIntPoint TileMin(TileIdx % NumTiles.X * TileSize, TileIdx / NumTiles.X * TileSize);
+		const FIntPoint TileMax(FMath::Min(TileMin.X + TileSize, Size.X), FMath::Min(TileMin.Y + TileSize, Size.Y));
+		const int32 TileWidth = TileMax.X - TileMin.X;
+
+		TArray<FVector2f, TInlineAllocator<TileSize>> Points;
+		TArray<FLinearColor, TInlineAllocator<TileSize>> Colors;
+		Points.SetNumUninitialized(TileWidth);
+		Colors.SetNumUninitialized(TileWidth);
+
+		// evaluate each row of the tile together, sampling the center of each pixel
+		for (int32 Y = TileMin.Y; Y < TileMax.Y; ++Y)
+		{
+			for (int32 X = TileMin.X; X < TileMax.X; ++X)
+			{
+				Points[X - TileMin.X] = FVector2f(X + 0.5f, Y + 0.5f) * PixelScale;
+			}
+
+			Evaluator.Evaluate(Points, PixelSize, Colors, TArrayView<float>(), false);
+
+			const int32 RowStart = Y * Size.X + TileMin.X;
+			for (int32 Idx = 0; Idx < TileWidth; ++Idx)
+			{
+				OutImage.Colors[RowStart + Idx] = Colors[Idx].GetClamped().ToFColorSRGB();
+			}
+
+			if (Settings.bBakeDistanceField)
+			{
+				for (int32 Idx = 0; Idx < TileWidth; ++Idx)
+				{
+					Coverage[RowStart + Idx] = FMath::Clamp(Colors[Idx].A, 0.f, 1.f);
+				}
+			}
+		}
+	});
+
+	if (Settings.bBakeDistanceField)
+	{
+		TArray<float> Distances;
+		ComputeDistanceField(Size, PixelScale, Coverage, Distances);
+
+		OutImage.DistanceField.SetNumUninitialized(Distances.Num());
+		for (int32 Idx = 0; Idx < Distances.Num(); ++Idx)
+		{
+			OutImage.DistanceField[Idx] = EncodeDistance(Distances[Idx], Settings.DistanceFieldSpread);
+		}
+	}
+
+	return true;
+}
+
+uint8 FMGFXMaterialBaker::EncodeDistance(float Distance, float Spread)
+{
+	// map [-Spread, Spread] to [255, 0], so that values above 0.5 are inside shapes
+	const float Value = 0.5f - 0.5f * Distance / FMath::Max(Spread, UE_SMALL_NUMBER);
+	return static_cast<uint8>(FMath::RoundToInt(FMath::Clamp(Value, 0.f, 1.f) * 255.f));
+}
+
+void FMGFXMaterialBaker::ComputeDistanceField(FIntPoint Size, FVector2f PixelScale, TConstArrayView<float> Coverage, TArray<float>& OutDistances)
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialBaker_ComputeDistanceField, FColor::Green);
+
+	const int32 NumPixels = Size.X * Size.Y;
+	check(Coverage.Num() == NumPixels);
+
+	// pixels with at least half coverage are inside, find the distance from each pixel to the nearest pixel on the other side
+	TArray<float> SquaredDistancesToInside;
+	TArray<float> SquaredDistancesToOutside;
+	SquaredDistancesToInside.SetNumUninitialized(NumPixels);
+	SquaredDistancesToOutside.SetNumUninitialized(NumPixels);
+	for (int32 Idx = 0; Idx < NumPixels; ++Idx)
+	{
+		const bool bIsInside = Coverage[Idx] >= 0.5f;
+		SquaredDistancesToInside[Idx] = bIsInside ? 0.f : NoSeed;
+		SquaredDistancesToOutside[Idx] = bIsInside ? NoSeed : 0.f;
+	}
+
+	DistanceTransform(Size, PixelScale, SquaredDistancesToInside);
+	DistanceTransform(Size, PixelScale, SquaredDistancesToOutside);
+
+	// the edge is about half a pixel from the nearest pixel on the other side. antialiased pixels along the edge
+	// are offset from it by their coverage instead, since the filter width is about one pixel.
+	const float PixelSize = FMath::Max(PixelScale.X, PixelScale.Y);
+	const float HalfPixelSize = 0.5f * PixelSize;
+
+	OutDistances.SetNumUninitialized(NumPixels);
+	for (int32 Idx = 0; Idx < NumPixels; ++Idx)
+	{
+		const float Alpha = Coverage[Idx];
+		if (Alpha > 0.f && Alpha < 1.f)
+		{
+			OutDistances[Idx] = (0.5f - Alpha) * PixelSize;
+		}
+		else if (Alpha >= 0.5f)
+		{
+			OutDistances[Idx] = SquaredDistancesToOutside[Idx] < NoSeed
+				                    ? HalfPixelSize - FMath::Sqrt(SquaredDistancesToOutside[Idx])
+				                    : -FMGFXMaterialEvaluator::MaxDistance;
+		}
+		else
+		{
+			OutDistances[Idx] = SquaredDistancesToInside[Idx] < NoSeed
+				                    ? FMath::Sqrt(SquaredDistancesToInside[Idx]) - HalfPixelSize
+				                    : FMGFXMaterialEvaluator::MaxDistance;
+		}
+	}
+}
+
+void FMGFXMaterialBaker::DistanceTransform(FIntPoint Size, FVector2f PixelScale, TArray<float>& InOutSquaredDistances)
+{
+	// transform each row, then each column of the result
+	ParallelFor(Size.Y, [&](int32 Y)
+	{
+		DistanceTransform1D(MakeArrayView(&InOutSquaredDistances[Y * Size.X], Size.X), PixelScale.X);
+	});
+
+	ParallelFor(Size.X, [&](int32 X)
+	{
+		TArray<float, TInlineAllocator<TileSize>> Column;
+		Column.SetNumUninitialized(Size.Y);
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			Column[Y] = InOutSquaredDistances[Y * Size.X + X];
+		}
+
+		DistanceTransform1D(Column, PixelScale.Y);
+
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			InOutSquaredDistances[Y * Size.X + X] = Column[Y];
+		}
+	});
+}
+
+void FMGFXMaterialBaker::DistanceTransform1D(TArrayView<float> InOutSquaredDistances, float Spacing)
+{
+	const int32 Num = InOutSquaredDistances.Num();
+
+	// the lower envelope of the parabolas rooted at each seed, and the ranges where each parabola is lowest
+	TArray<int32, TInlineAllocator<TileSize>> Parabolas;
+	TArray<float, TInlineAllocator<TileSize>> Bounds;
+	Parabolas.Reserve(Num);
+	Bounds.Reserve(Num + 1);
+
+	for (int32 Idx = 0; Idx < Num; ++Idx)
+	{
+		const float Value = InOutSquaredDistances[Idx];
+		if (Value >= NoSeed)
+		{
+			continue;
+		}
+
+		const float Pos = Idx * Spacing;
+		float Intersection = -TNumericLimits<float>::Max();
+		while (!Parabolas.IsEmpty())
+		{
+			const int32 Last = Parabolas.Last();
+			const float LastPos = Last * Spacing;
+			Intersection = ((Value + Pos * Pos) - (InOutSquaredDistances[Last] + LastPos * LastPos)) / (2.f * (Pos - LastPos));
+			if (Intersection > Bounds.Last())
+			{
+				break;
+			}
+
+			// the new parabola is lower than the last one over its whole range
+			Parabolas.Pop();
+			Bounds.Pop();
+			Intersection = -TNumericLimits<float>::Max();
+		}
+
+		Parabolas.Add(Idx);
+		Bounds.Add(Intersection);
+	}
+
+	if (Parabolas.IsEmpty())
+	{
+		return;
+	}
+
+	// the values are overwritten in order, after the parabolas rooted at them are no longer needed
+	TArray<float, TInlineAllocator<TileSize>> SeedValues;
+	SeedValues.SetNumUninitialized(Parabolas.Num());
+	for (int32 ParabolaIdx = 0; ParabolaIdx < Parabolas.Num(); ++ParabolaIdx)
+	{
+		SeedValues[ParabolaIdx] = InOutSquaredDistances[Parabolas[ParabolaIdx]];
+	}
+
+	int32 ParabolaIdx = 0;
+	for (int32 Idx = 0; Idx < Num; ++Idx)
+	{
+		const float Pos = Idx * Spacing;
+		while (ParabolaIdx + 1 < Parabolas.Num() && Bounds[ParabolaIdx + 1] < Pos)
+		{
+			++ParabolaIdx;
+		}
+
+		const float Offset = Pos - Parabolas[ParabolaIdx] * Spacing;
+		InOutSquaredDistances[Idx] = Offset * Offset + SeedValues[ParabolaIdx];
+	}
+}
+
+UTexture2D* FMGFXMaterialBaker::CreateTransientTexture(const FMGFXBakedImage& Image, FName Name)
+{
+	if (!Image.IsValid())
+	{
+		return nullptr;
+	}
+
+	return CreateTransientTextureFromData(Image.Size, PF_B8G8R8A8, true, Image.Colors.GetData(), Image.Colors.Num() * sizeof(FColor), Name);
+}
+
+UTexture2D* FMGFXMaterialBaker::CreateTransientDistanceFieldTexture(const FMGFXBakedImage& Image, FName Name)
+{
+	if (!Image.IsValid() || Image.DistanceField.Num() != Image.Colors.Num())
+	{
+		return nullptr;
+	}
+
+	return CreateTransientTextureFromData(Image.Size, PF_G8, false, Image.DistanceField.GetData(), Image.DistanceField.Num(), Name);
+}
+
+UTexture2D* FMGFXMaterialBaker::CreateTransientTextureFromData(FIntPoint Size, EPixelFormat Format, bool bSRGB, const void* Data, int32 DataSize, FName Name)
+{
+	UTexture2D* Texture = UTexture2D::CreateTransient(Size.X, Size.Y, Format, Name);
+	if (!Texture)
+	{
+		return nullptr;
+	}
+
+	Texture->SRGB = bSRGB;
+	Texture->LODGroup = TEXTUREGROUP_UI;
+	Texture->Filter = TF_Bilinear;
+
+	FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+	void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(MipData, Data, DataSize);
+	Mip.BulkData.Unlock();
+
+	Texture->UpdateResource();
+	return Texture;
+}
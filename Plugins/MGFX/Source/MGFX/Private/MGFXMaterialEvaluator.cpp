@@ -0,0 +1,366 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "MGFXMaterialEvaluator.h"
+
+#include "MGFXMaterial.h"
+#include "MGFXMaterialLayer.h"
+#include "MGFXVectorMath.h"
+#include "Async/ParallelFor.h"
+#include "Shapes/MGFXMaterialShape.h"
+#include "Shapes/MGFXMaterialShapeVisual.h"
+
+
+// FMGFXMaterialEvaluator::FLayerOutputs
+// -------------------------------------
+
+FMGFXVectorRGBA FMGFXMaterialEvaluator::FLayerOutputs::LoadVisual(int32 Idx) const
+{
+	return {VectorLoad(&R[Idx]), VectorLoad(&G[Idx]), VectorLoad(&B[Idx]), VectorLoad(&A[Idx])};
+}
+
+void FMGFXMaterialEvaluator::FLayerOutputs::StoreVisual(const FMGFXVectorRGBA& Visual, int32 Idx)
+{
+	VectorStore(Visual.R, &R[Idx]);
+	VectorStore(Visual.G, &G[Idx]);
+	VectorStore(Visual.B, &B[Idx]);
+	VectorStore(Visual.A, &A[Idx]);
+}
+
+
+// FMGFXMaterialEvaluator
+// ----------------------
+
+FMGFXMaterialEvaluator::FMGFXMaterialEvaluator(const UMGFXMaterial* InMGFXMaterial)
+{
+	Compile(InMGFXMaterial);
+}
+
+void FMGFXMaterialEvaluator::Compile(const UMGFXMaterial* InMGFXMaterial)
+{
+	MGFXMaterial = InMGFXMaterial;
+	Layers.Reset();
+	RootLayers.Reset();
+	bCanEvaluateAllShapes = true;
+
+	if (!InMGFXMaterial)
+	{
+		return;
+	}
+
+	bComputeFilterWidth = InMGFXMaterial->bComputeFilterWidth;
+	FixedFilterWidth = InMGFXMaterial->FixedFilterWidth;
+	bAllAnimatable = InMGFXMaterial->bAllAnimatable;
+
+	// compile layers bottom to top, in the same order they are generated
+	for (int32 Idx = InMGFXMaterial->RootLayers.Num() - 1; Idx >= 0; --Idx)
+	{
+		if (const UMGFXMaterialLayer* Layer = InMGFXMaterial->RootLayers[Idx])
+		{
+			RootLayers.Add(CompileLayer(Layer, FTransform2D(), 1.f));
+		}
+	}
+}
+
+int32 FMGFXMaterialEvaluator::CompileLayer(const UMGFXMaterialLayer* Layer, const FTransform2D& ParentTransform, float ParentFilterWidthScale)
+{
+	const int32 LayerIdx = Layers.AddDefaulted();
+	FLayer CompiledLayer;
+
+	// bake the transform of this layer and all parents into one transform from canvas space.
+	// this matches the static transforms of the generated material, and is equivalent to its animatable transforms.
+	const FTransform2D Transform = Layer->Transform.ToTransform2D().Concatenate(ParentTransform);
+	const FTransform2D InvTransform = Transform.Inverse();
+	CompiledLayer.Offset = FVector2f(InvTransform.TransformPoint(FVector2D::ZeroVector));
+	CompiledLayer.AxisX = FVector2f(InvTransform.TransformPoint(FVector2D(1.f, 0.f))) - CompiledLayer.Offset;
+	CompiledLayer.AxisY = FVector2f(InvTransform.TransformPoint(FVector2D(0.f, 1.f))) - CompiledLayer.Offset;
+
+	// the derivatives of the local uvs are the transform axes scaled by the pixel size, so MGFX_FilterWidth can be computed exactly
+	CompiledLayer.PixelSizeScale = FMath::Max(CompiledLayer.AxisX.GetAbsMax(), CompiledLayer.AxisY.GetAbsMax());
+	CompiledLayer.DistanceScale = 1.f / FMath::Max(FMath::Max(CompiledLayer.AxisX.Size(), CompiledLayer.AxisY.Size()), UE_SMALL_NUMBER);
+
+	// recalculate filter width only where the generated material does
+	const bool bNoOptimization = Layer->Transform.bAnimatable || bAllAnimatable;
+	const bool bHasModifiedScale = !(Layer->Transform.Scale - FVector2f::One()).IsNearlyZero();
+	CompiledLayer.FilterWidthScale = bComputeFilterWidth && (bNoOptimization || bHasModifiedScale)
+		                                 ? CompiledLayer.PixelSizeScale
+		                                 : ParentFilterWidthScale;
+
+	CompiledLayer.MergeOperation = Layer->MergeOperation;
+
+	if (const UMGFXMaterialShape* Shape = Layer->Shape)
+	{
+		if (Shape->CanEvaluateSDF())
+		{
+			CompiledLayer.Shape = Shape;
+			CompiledLayer.ShapeMergeOperation = Shape->ShapeMergeOperation;
+			CompiledLayer.ShapeMergeSmoothness = Shape->ShapeMergeSmoothness;
+			CompiledLayer.bIsShapeMergedWithNext = IsShapeMergedWithNext(Layer);
+
+			for (const UMGFXMaterialShapeVisual* Visual : Shape->Visuals)
+			{
+				if (const UMGFXMaterialShapeFill* Fill = Cast<UMGFXMaterialShapeFill>(Visual))
+				{
+					FVisual& CompiledVisual = CompiledLayer.Visuals.AddDefaulted_GetRef();
+					CompiledVisual.Color = Fill->Color;
+					CompiledVisual.bEnableFilterBias = Fill->bEnableFilterBias;
+					CompiledVisual.bComputeFilterWidth = Fill->bComputeFilterWidth;
+				}
+				else if (const UMGFXMaterialShapeStroke* Stroke = Cast<UMGFXMaterialShapeStroke>(Visual))
+				{
+					FVisual& CompiledVisual = CompiledLayer.Visuals.AddDefaulted_GetRef();
+					CompiledVisual.Color = Stroke->Color;
+					CompiledVisual.bIsStroke = true;
+					CompiledVisual.StrokeWidth = Stroke->StrokeWidth;
+					CompiledVisual.bComputeFilterWidth = Stroke->bComputeFilterWidth;
+				}
+			}
+		}
+		else
+		{
+			bCanEvaluateAllShapes = false;
+		}
+	}
+
+	// compile children bottom to top
+	for (int32 Idx = Layer->NumLayers() - 1; Idx >= 0; --Idx)
+	{
+		if (const UMGFXMaterialLayer* ChildLayer = Layer->GetLayer(Idx))
+		{
+			CompiledLayer.Children.Add(CompileLayer(ChildLayer, Transform, CompiledLayer.FilterWidthScale));
+		}
+	}
+
+	Layers[LayerIdx] = MoveTemp(CompiledLayer);
+	return LayerIdx;
+}
+
+bool FMGFXMaterialEvaluator::IsShapeMergedWithNext(const UMGFXMaterialLayer* Layer)
+{
+	if (!Layer->Shape)
+	{
+		return false;
+	}
+
+	// layers are evaluated bottom to top, so the next sibling is the one above this layer
+	if (const IMGFXMaterialLayerParentInterface* Container = Layer->GetParentContainer())
+	{
+		const int32 LayerIdx = Container->GetLayerIndex(Layer);
+		const UMGFXMaterialLayer* NextLayer = LayerIdx > 0 ? Container->GetLayer(LayerIdx - 1) : nullptr;
+		return NextLayer && NextLayer->Shape && NextLayer->Shape->ShapeMergeOperation != EMGFXShapeMergeOperation::None;
+	}
+
+	return false;
+}
+
+void FMGFXMaterialEvaluator::Evaluate(TConstArrayView<FVector2f> Points, float PixelSize, TArrayView<FLinearColor> OutColors,
+                                     TArrayView<float> OutSDFs, bool bParallel) const
+{
+	check(OutColors.Num() == Points.Num());
+	check(OutSDFs.IsEmpty() || OutSDFs.Num() == Points.Num());
+
+	const int32 NumChunks = FMath::DivideAndRoundUp(Points.Num(), ChunkSize);
+	ParallelFor(NumChunks, [&](int32 ChunkIdx)
+	{
+		const int32 Start = ChunkIdx * ChunkSize;
+		const int32 Num = FMath::Min(ChunkSize, Points.Num() - Start);
+		EvaluateChunk(Points.Slice(Start, Num), PixelSize, OutColors.Slice(Start, Num),
+		              OutSDFs.IsEmpty() ? TArrayView<float>() : OutSDFs.Slice(Start, Num));
+	}, bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+}
+
+FLinearColor FMGFXMaterialEvaluator::EvaluatePoint(const FVector2f& Point, float PixelSize, float* OutSDF) const
+{
+	FLinearColor Result;
+	float SDF;
+	EvaluateChunk(MakeArrayView(&Point, 1), PixelSize, MakeArrayView(&Result, 1), MakeArrayView(&SDF, 1));
+
+	if (OutSDF)
+	{
+		*OutSDF = SDF;
+	}
+	return Result;
+}
+
+void FMGFXMaterialEvaluator::EvaluateChunk(TConstArrayView<FVector2f> Points, float PixelSize, TArrayView<FLinearColor> OutColors,
+                                           TArrayView<float> OutSDFs) const
+{
+	FBatch Batch;
+	Batch.PixelSize = PixelSize;
+	Batch.FilterWidth = bComputeFilterWidth ? PixelSize : FixedFilterWidth;
+
+	// evaluate each root layer merged with the previous one, alternating outputs
+	FLayerOutputs LayerOutputs[2];
+
+	for (int32 Start = 0; Start < Points.Num(); Start += BatchSize)
+	{
+		const int32 Num = FMath::Min(BatchSize, Points.Num() - Start);
+		for (int32 Idx = 0; Idx < BatchSize; ++Idx)
+		{
+			// fill the rest of a partial batch with the last point
+			const FVector2f& Point = Points[Start + FMath::Min(Idx, Num - 1)];
+			Batch.X[Idx] = Point.X;
+			Batch.Y[Idx] = Point.Y;
+			Batch.SDF[Idx] = MaxDistance;
+		}
+
+		int32 OutputsIdx = 0;
+		LayerOutputs[OutputsIdx].bHasShape = false;
+		LayerOutputs[OutputsIdx].bHasVisual = false;
+		for (const int32 LayerIdx : RootLayers)
+		{
+			EvaluateLayer(Layers[LayerIdx], Batch, LayerOutputs[OutputsIdx], LayerOutputs[1 - OutputsIdx]);
+			OutputsIdx = 1 - OutputsIdx;
+		}
+
+		FLayerOutputs& Outputs = LayerOutputs[OutputsIdx];
+		if (!Outputs.bHasVisual)
+		{
+			for (int32 Idx = 0; Idx < Num; ++Idx)
+			{
+				OutColors[Start + Idx] = FLinearColor::Transparent;
+			}
+		}
+		else
+		{
+			// unpremult after all merges
+			for (int32 Idx = 0; Idx < BatchSize; Idx += 4)
+			{
+				Outputs.StoreVisual(FMGFXVectorMath::Unpremult(Outputs.LoadVisual(Idx)), Idx);
+			}
+
+			for (int32 Idx = 0; Idx < Num; ++Idx)
+			{
+				OutColors[Start + Idx] = FLinearColor(Outputs.R[Idx], Outputs.G[Idx], Outputs.B[Idx], Outputs.A[Idx]);
+			}
+		}
+
+		if (!OutSDFs.IsEmpty())
+		{
+			FMemory::Memcpy(&OutSDFs[Start], Batch.SDF, Num * sizeof(float));
+		}
+	}
+}
+
+void FMGFXMaterialEvaluator::EvaluateLayer(const FLayer& Layer, FBatch& Batch, const FLayerOutputs& PrevOutputs, FLayerOutputs& OutOutputs) const
+{
+	OutOutputs.bHasShape = false;
+	OutOutputs.bHasVisual = false;
+
+	// evaluate children bottom to top, alternating outputs
+	FLayerOutputs ChildOutputs[2];
+	int32 ChildOutputsIdx = 0;
+	for (const int32 ChildLayerIdx : Layer.Children)
+	{
+		EvaluateLayer(Layers[ChildLayerIdx], Batch, ChildOutputs[ChildOutputsIdx], ChildOutputs[1 - ChildOutputsIdx]);
+		ChildOutputsIdx = 1 - ChildOutputsIdx;
+	}
+	const FLayerOutputs& LastChildOutputs = ChildOutputs[ChildOutputsIdx];
+
+	if (Layer.Shape)
+	{
+		// transform points into local space
+		float X[BatchSize];
+		float Y[BatchSize];
+		const VectorRegister4Float AxisXX = VectorSetFloat1(Layer.AxisX.X);
+		const VectorRegister4Float AxisXY = VectorSetFloat1(Layer.AxisX.Y);
+		const VectorRegister4Float AxisYX = VectorSetFloat1(Layer.AxisY.X);
+		const VectorRegister4Float AxisYY = VectorSetFloat1(Layer.AxisY.Y);
+		const VectorRegister4Float OffsetX = VectorSetFloat1(Layer.Offset.X);
+		const VectorRegister4Float OffsetY = VectorSetFloat1(Layer.Offset.Y);
+		for (int32 Idx = 0; Idx < BatchSize; Idx += 4)
+		{
+			const VectorRegister4Float PX = VectorLoad(&Batch.X[Idx]);
+			const VectorRegister4Float PY = VectorLoad(&Batch.Y[Idx]);
+			VectorStore(VectorMultiplyAdd(PX, AxisXX, VectorMultiplyAdd(PY, AxisYX, OffsetX)), &X[Idx]);
+			VectorStore(VectorMultiplyAdd(PX, AxisXY, VectorMultiplyAdd(PY, AxisYY, OffsetY)), &Y[Idx]);
+		}
+
+		Layer.Shape->EvaluateSDF(MakeArrayView(X), MakeArrayView(Y), MakeArrayView(OutOutputs.Shape));
+		OutOutputs.bHasShape = true;
+
+		// merge with the shape below before evaluating visuals, so that merged shapes share the same visuals
+		if (PrevOutputs.bHasShape)
+		{
+			for (int32 Idx = 0; Idx < BatchSize; Idx += 4)
+			{
+				const VectorRegister4Float Merged = FMGFXVectorMath::MergeShapes(VectorLoad(&PrevOutputs.Shape[Idx]), VectorLoad(&OutOutputs.Shape[Idx]),
+				                                                                 Layer.ShapeMergeOperation, Layer.ShapeMergeSmoothness);
+				VectorStore(Merged, &OutOutputs.Shape[Idx]);
+			}
+		}
+
+		// the visuals of shapes merged with the shape above are evaluated by that shape instead
+		if (!Layer.bIsShapeMergedWithNext)
+		{
+			EvaluateVisuals(Layer, Batch, OutOutputs);
+		}
+	}
+
+	// merge this layer with its children
+	if (LastChildOutputs.bHasVisual)
+	{
+		for (int32 Idx = 0; Idx < BatchSize; Idx += 4)
+		{
+			const FMGFXVectorRGBA ChildVisual = LastChildOutputs.LoadVisual(Idx);
+			OutOutputs.StoreVisual(OutOutputs.bHasVisual
+				                       ? FMGFXVectorMath::Merge(OutOutputs.LoadVisual(Idx), ChildVisual, Layer.MergeOperation)
+				                       : ChildVisual, Idx);
+		}
+		OutOutputs.bHasVisual = true;
+	}
+
+	// merge this layer with the previous sibling
+	if (PrevOutputs.bHasVisual)
+	{
+		for (int32 Idx = 0; Idx < BatchSize; Idx += 4)
+		{
+			const FMGFXVectorRGBA PrevVisual = PrevOutputs.LoadVisual(Idx);
+			OutOutputs.StoreVisual(OutOutputs.bHasVisual
+				                       ? FMGFXVectorMath::Merge(OutOutputs.LoadVisual(Idx), PrevVisual, Layer.MergeOperation)
+				                       : PrevVisual, Idx);
+		}
+		OutOutputs.bHasVisual = true;
+	}
+}
+
+void FMGFXMaterialEvaluator::EvaluateVisuals(const FLayer& Layer, FBatch& Batch, FLayerOutputs& OutOutputs) const
+{
+	if (Layer.Visuals.IsEmpty())
+	{
+		return;
+	}
+
+	const float FilterWidth = Batch.FilterWidth * Layer.FilterWidthScale;
+
+	// there are no derivatives on the CPU, so visuals that compute their filter width assume the SDF has a unit gradient in local space
+	const float ComputedFilterWidth = Batch.PixelSize * Layer.PixelSizeScale;
+
+	const VectorRegister4Float DistanceScale = VectorSetFloat1(Layer.DistanceScale);
+
+	for (int32 Idx = 0; Idx < BatchSize; Idx += 4)
+	{
+		const VectorRegister4Float SDF = VectorLoad(&OutOutputs.Shape[Idx]);
+
+		// evaluate all visuals from the same SDF, merging each over the previous ones
+		FMGFXVectorRGBA Result = {VectorZeroFloat(), VectorZeroFloat(), VectorZeroFloat(), VectorZeroFloat()};
+		for (int32 VisualIdx = 0; VisualIdx < Layer.Visuals.Num(); ++VisualIdx)
+		{
+			const FVisual& Visual = Layer.Visuals[VisualIdx];
+			const float VisualFilterWidth = Visual.bComputeFilterWidth ? ComputedFilterWidth : FilterWidth;
+			const VectorRegister4Float Coverage = Visual.bIsStroke
+				                                      ? FMGFXVectorMath::Stroke(SDF, Visual.StrokeWidth, VisualFilterWidth)
+				                                      : FMGFXVectorMath::Fill(SDF, VisualFilterWidth, Visual.bEnableFilterBias);
+			const FMGFXVectorRGBA VisualValue = FMGFXVectorMath::Tint(Coverage, Visual.Color);
+
+			Result = VisualIdx == 0 ? VisualValue : FMGFXVectorMath::Merge(VisualValue, Result, EMGFXLayerMergeOperation::Over);
+		}
+		OutOutputs.StoreVisual(Result, Idx);
+
+		// track the nearest shape with visuals in canvas space
+		const VectorRegister4Float CanvasSDF = VectorMultiply(SDF, DistanceScale);
+		VectorStore(VectorMin(VectorLoad(&Batch.SDF[Idx]), CanvasSDF), &Batch.SDF[Idx]);
+	}
+
+	OutOutputs.bHasVisual = true;
+}
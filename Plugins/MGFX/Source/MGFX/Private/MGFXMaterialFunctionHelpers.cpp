@@ -13,6 +13,9 @@ FString FMGFXMaterialFunctions::ShapePath(TEXT("Shape/MF_MGFX_Shape_"));
 FString FMGFXMaterialFunctions::TransformPath(TEXT("Transform/MF_MGFX_"));
 FString FMGFXMaterialFunctions::UtilPath(TEXT("Util/MF_MGFX_"));
 FString FMGFXMaterialFunctions::VisualPath(TEXT("Visual/MF_MGFX_"));
+FString FMGFXMaterialFunctions::CommonShaderPath(TEXT("/Plugin/MGFX/Private/MGFXCommon.ush"));
+FString FMGFXMaterialFunctions::ShapesShaderPath(TEXT("/Plugin/MGFX/Private/MGFXShapes.ush"));
+FString FMGFXMaterialFunctions::InterpreterShaderPath(TEXT("/Plugin/MGFX/Private/MGFXInterpreter.ush"));
 
 TSoftObjectPtr<UMaterialFunctionInterface> FMGFXMaterialFunctions::GetFunction(const FString RelativePath)
 {
@@ -45,3 +48,8 @@ TSoftObjectPtr<UMaterialFunctionInterface> FMGFXMaterialFunctions::GetUtil(const
 {
 	return GetFunction(UtilPath + Name);
 }
+
+FString FMGFXMaterialFunctions::GetShapeHLSLFunction(const FString& Name)
+{
+	return TEXT("MGFX_Shape_") + Name;
+}
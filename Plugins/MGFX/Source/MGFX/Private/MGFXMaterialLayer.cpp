@@ -5,6 +5,7 @@
 
 #include "MGFXMaterial.h"
 #include "Shapes/MGFXMaterialShape.h"
+#include "Shapes/MGFXMaterialShapeVisual.h"
 
 
 // IMGFXMaterialLayerContainerInterface
@@ -123,6 +124,33 @@ FBox2D UMGFXMaterialLayer::GetBounds() const
 #endif
 
 
+const FMGFXPropertyAnimation* UMGFXMaterialLayer::FindAnimation(const UObject* Object, FName PropertyName) const
+{
+	// visual properties have the same names for every visual, so they are also matched by index
+	int32 VisualIndex = INDEX_NONE;
+	if (const UMGFXMaterialShapeVisual* Visual = Cast<UMGFXMaterialShapeVisual>(Object))
+	{
+		VisualIndex = Shape ? Shape->Visuals.IndexOfByKey(Visual) : INDEX_NONE;
+		if (VisualIndex == INDEX_NONE)
+		{
+			return nullptr;
+		}
+	}
+
+	return Animations.FindByPredicate([PropertyName, VisualIndex](const FMGFXPropertyAnimation& Animation)
+	{
+		return Animation.PropertyName == PropertyName && !Animation.Keys.IsEmpty() &&
+			(VisualIndex == INDEX_NONE || Animation.VisualIndex == VisualIndex);
+	});
+}
+
+bool UMGFXMaterialLayer::IsTransformAnimated() const
+{
+	return FindAnimation(this, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location)) ||
+		FindAnimation(this, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation)) ||
+		FindAnimation(this, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale));
+}
+
 IMGFXMaterialLayerParentInterface* UMGFXMaterialLayer::GetParentContainer() const
 {
 	if (UMGFXMaterialLayer* ParentLayer = GetParentLayer())
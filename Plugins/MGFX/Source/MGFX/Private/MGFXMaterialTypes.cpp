@@ -3,6 +3,8 @@
 
 #include "MGFXMaterialTypes.h"
 
+#include "Algo/StableSort.h"
+
 
 FMGFXShapeTransform2D::FMGFXShapeTransform2D(const FTransform2D& InTransform)
 {
@@ -18,3 +20,17 @@ FTransform2D FMGFXShapeTransform2D::ToTransform2D() const
 		FQuat2D(FMath::DegreesToRadians(Rotation)),
 		FVector2D(Location));
 }
+
+FLinearColor FMGFXShapeTransform2D::GetRotationParameterValue(float InRotation)
+{
+	// uvs are rotated by the inverse, so that shapes appear rotated by the positive amount
+	const FVector2f Axis = FVector2f(FQuat2D(FMath::DegreesToRadians(-InRotation)).TransformPoint(FVector2D(1.f, 0.f)));
+	return FLinearColor(Axis.X, Axis.Y, 0.f, 0.f);
+}
+
+TArray<FMGFXAnimationKey> FMGFXPropertyAnimation::GetSortedKeys() const
+{
+	TArray<FMGFXAnimationKey> Result = Keys;
+	Algo::StableSortBy(Result, &FMGFXAnimationKey::Time);
+	return Result;
+}
@@ -0,0 +1,423 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "MGFXPackedLayers.h"
+
+#include "MGFXMaterial.h"
+#include "MGFXMaterialEvaluator.h"
+#include "MGFXShapeSDF.h"
+#include "MGFXVectorMath.h"
+#include "Engine/Texture2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Shapes/MGFXMaterialShape.h"
+
+
+// FMGFXPackedLayers
+// -----------------
+
+FIntPoint FMGFXPackedLayers::GetTextureSize() const
+{
+	return FIntPoint(TextureWidth, FMath::Max(FMath::DivideAndRoundUp(Texels.Num(), TextureWidth), 1));
+}
+
+uint32 FMGFXPackedLayers::GetTexelsHash() const
+{
+	return FCrc::MemCrc32(Texels.GetData(), Texels.Num() * Texels.GetTypeSize());
+}
+
+
+// FMGFXLayerPacker
+// ----------------
+
+const FName FMGFXLayerPacker::LayerDataParameterName(TEXT("LayerData"));
+
+bool FMGFXLayerPacker::Pack(const UMGFXMaterial* MGFXMaterial, FMGFXPackedLayers& OutLayers)
+{
+	SCOPED_NAMED_EVENT(FMGFXLayerPacker_Pack, FColor::Green);
+
+	OutLayers = FMGFXPackedLayers();
+	if (!MGFXMaterial)
+	{
+		return false;
+	}
+
+	const FMGFXMaterialEvaluator Evaluator(MGFXMaterial);
+	OutLayers.bIsComplete = Evaluator.CanEvaluateAllShapes();
+
+	// the number of texels is stored after packing all layers
+	OutLayers.Texels.Add(FVector4f(FMGFXPackedLayers::Version, 0.f, Evaluator.bComputeFilterWidth ? 1.f : 0.f, Evaluator.FixedFilterWidth));
+	OutLayers.Texels.Add(FVector4f(MGFXMaterial->BaseCanvasSize.X, MGFXMaterial->BaseCanvasSize.Y, 0.f, 0.f));
+
+	for (const int32 LayerIdx : Evaluator.RootLayers)
+	{
+		PackLayer(Evaluator, LayerIdx, 0, OutLayers);
+	}
+
+	OutLayers.Texels.Add(FVector4f(FMGFXPackedLayers::EnumToTexel(FMGFXPackedLayers::EOp::End), 0.f, 0.f, 0.f));
+	OutLayers.Texels[0].Y = OutLayers.Texels.Num();
+	return true;
+}
+
+void FMGFXLayerPacker::PackLayer(const FMGFXMaterialEvaluator& Evaluator, int32 LayerIdx, int32 Depth, FMGFXPackedLayers& OutLayers)
+{
+	const FMGFXMaterialEvaluator::FLayer& Layer = Evaluator.Layers[LayerIdx];
+	FMGFXPackedLayers::ELayerFlags Flags = FMGFXPackedLayers::ELayerFlags::None;
+
+	// children are packed first onto a new stack frame, and merged by this layer
+	if (!Layer.Children.IsEmpty())
+	{
+		if (Depth + 1 < FMGFXPackedLayers::MaxDepth)
+		{
+			OutLayers.Texels.Add(FVector4f(FMGFXPackedLayers::EnumToTexel(FMGFXPackedLayers::EOp::BeginChildren), 0.f, 0.f, 0.f));
+			for (const int32 ChildLayerIdx : Layer.Children)
+			{
+				PackLayer(Evaluator, ChildLayerIdx, Depth + 1, OutLayers);
+			}
+			Flags |= FMGFXPackedLayers::ELayerFlags::HasChildren;
+		}
+		else
+		{
+			OutLayers.bIsComplete = false;
+		}
+	}
+
+	FVector4f ShapeInputs(0.f, 0.f, 0.f, 0.f);
+	EMGFXShapeType ShapeType = EMGFXShapeType::None;
+	if (Layer.Shape)
+	{
+		// shapes that evaluate their own SDF on the CPU can't be interpreted
+		ShapeType = Layer.Shape->GetShapeType(ShapeInputs);
+		if (ShapeType == EMGFXShapeType::None)
+		{
+			OutLayers.bIsComplete = false;
+		}
+	}
+
+	if (Layer.bIsShapeMergedWithNext)
+	{
+		Flags |= FMGFXPackedLayers::ELayerFlags::ShapeMergedWithNext;
+	}
+
+	const int32 NumVisuals = ShapeType != EMGFXShapeType::None ? Layer.Visuals.Num() : 0;
+
+	OutLayers.Texels.Add(FVector4f(FMGFXPackedLayers::EnumToTexel(FMGFXPackedLayers::EOp::Layer), FMGFXPackedLayers::EnumToTexel(ShapeType),
+	                               FMGFXPackedLayers::EnumToTexel(Flags), NumVisuals));
+	OutLayers.Texels.Add(FVector4f(Layer.AxisX.X, Layer.AxisY.X, Layer.Offset.X, FMGFXPackedLayers::EnumToTexel(Layer.MergeOperation)));
+	OutLayers.Texels.Add(FVector4f(Layer.AxisX.Y, Layer.AxisY.Y, Layer.Offset.Y, FMGFXPackedLayers::EnumToTexel(Layer.ShapeMergeOperation)));
+	OutLayers.Texels.Add(ShapeInputs);
+	OutLayers.Texels.Add(FVector4f(Layer.ShapeMergeSmoothness, Layer.FilterWidthScale, Layer.PixelSizeScale, 0.f));
+
+	for (int32 VisualIdx = 0; VisualIdx < NumVisuals; ++VisualIdx)
+	{
+		const FMGFXMaterialEvaluator::FVisual& Visual = Layer.Visuals[VisualIdx];
+		OutLayers.Texels.Add(FVector4f(Visual.Color));
+		OutLayers.Texels.Add(FVector4f(Visual.bIsStroke ? 1.f : 0.f, Visual.StrokeWidth, Visual.bEnableFilterBias ? 1.f : 0.f,
+		                               Visual.bComputeFilterWidth ? 1.f : 0.f));
+	}
+}
+
+TArray<FVector4f> FMGFXLayerPacker::GetPaddedTexels(const FMGFXPackedLayers& Layers)
+{
+	// padding is zero, which is the End op
+	const FIntPoint Size = Layers.GetTextureSize();
+	TArray<FVector4f> Result = Layers.Texels;
+	Result.SetNumZeroed(Size.X * Size.Y);
+	return Result;
+}
+
+UTexture2D* FMGFXLayerPacker::CreateTransientTexture(const FMGFXPackedLayers& Layers, FName Name)
+{
+	if (!Layers.IsValid())
+	{
+		return nullptr;
+	}
+
+	const FIntPoint Size = Layers.GetTextureSize();
+	UTexture2D* Texture = UTexture2D::CreateTransient(Size.X, Size.Y, PF_A32B32G32R32F, Name);
+	if (!Texture)
+	{
+		return nullptr;
+	}
+
+	Texture->SRGB = false;
+	Texture->CompressionSettings = TC_HDR_F32;
+	Texture->Filter = TF_Nearest;
+
+	const TArray<FVector4f> Texels = GetPaddedTexels(Layers);
+	FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+	void* MipData = Mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memcpy(MipData, Texels.GetData(), Texels.Num() * sizeof(FVector4f));
+	Mip.BulkData.Unlock();
+
+	Texture->UpdateResource();
+	return Texture;
+}
+
+bool FMGFXLayerPacker::UpdateTransientTexture(UTexture2D* Texture, const FMGFXPackedLayers& Layers)
+{
+	if (!Texture || !Texture->GetResource() || !Layers.IsValid())
+	{
+		return false;
+	}
+
+	const FIntPoint Size = Layers.GetTextureSize();
+	if (Texture->GetSizeX() != Size.X || Texture->GetSizeY() != Size.Y || Texture->GetPixelFormat() != PF_A32B32G32R32F)
+	{
+		return false;
+	}
+
+	// the texels and region are copied on the render thread, so they're freed once the update is finished
+	TArray<FVector4f>* Texels = new TArray<FVector4f>(GetPaddedTexels(Layers));
+	FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, Size.X, Size.Y);
+	auto CleanupData = [Texels](uint8*, const FUpdateTextureRegion2D* UpdatedRegion)
+	{
+		delete Texels;
+		delete UpdatedRegion;
+	};
+	Texture->UpdateTextureRegions(0, 1, Region, Size.X * sizeof(FVector4f), sizeof(FVector4f), reinterpret_cast<uint8*>(Texels->GetData()),
+	                              CleanupData);
+	return true;
+}
+
+UTexture2D* FMGFXLayerPacker::SetLayerDataParameter(UMaterialInstanceDynamic* MID, const FMGFXPackedLayers& Layers)
+{
+	if (!MID)
+	{
+		return nullptr;
+	}
+
+	UTexture2D* Texture = CreateTransientTexture(Layers);
+	if (Texture)
+	{
+		MID->SetTextureParameterValue(LayerDataParameterName, Texture);
+	}
+	return Texture;
+}
+
+#if WITH_EDITOR
+void FMGFXLayerPacker::SetTextureSource(UTexture2D* Texture, const FMGFXPackedLayers& Layers)
+{
+	if (!Texture || !Layers.IsValid())
+	{
+		return;
+	}
+
+	const FIntPoint Size = Layers.GetTextureSize();
+	const TArray<FVector4f> Texels = GetPaddedTexels(Layers);
+
+	Texture->Modify();
+	Texture->PreEditChange(nullptr);
+	Texture->Source.Init(Size.X, Size.Y, 1, 1, TSF_RGBA32F, reinterpret_cast<const uint8*>(Texels.GetData()));
+	Texture->SRGB = false;
+	Texture->CompressionSettings = TC_HDR_F32;
+	Texture->LODGroup = TEXTUREGROUP_Pixels2D;
+	Texture->MipGenSettings = TMGS_NoMipmaps;
+	Texture->Filter = TF_Nearest;
+	Texture->NeverStream = true;
+	Texture->PostEditChange();
+	Texture->MarkPackageDirty();
+}
+#endif
+
+
+// FMGFXPackedLayersInterpreter
+// ----------------------------
+
+struct FMGFXPackedLayersInterpreter::FFrame
+{
+	bool bHasShape = false;
+	bool bHasVisual = false;
+
+	VectorRegister4Float Shape = VectorZeroFloat();
+
+	/** The premultiplied visual. */
+	FMGFXVectorRGBA Visual = {VectorZeroFloat(), VectorZeroFloat(), VectorZeroFloat(), VectorZeroFloat()};
+};
+
+bool FMGFXPackedLayersInterpreter::CanInterpret(const FMGFXPackedLayers& Layers)
+{
+	return Layers.IsValid() &&
+		static_cast<int32>(Layers.Texels[0].X) == FMGFXPackedLayers::Version &&
+		static_cast<int32>(Layers.Texels[0].Y) <= Layers.Texels.Num();
+}
+
+void FMGFXPackedLayersInterpreter::Evaluate(const FMGFXPackedLayers& Layers, TConstArrayView<FVector2f> Points, float PixelSize,
+                                            TArrayView<FLinearColor> OutColors)
+{
+	check(OutColors.Num() == Points.Num());
+
+	if (!CanInterpret(Layers))
+	{
+		for (FLinearColor& Color : OutColors)
+		{
+			Color = FLinearColor::Transparent;
+		}
+		return;
+	}
+
+	float X[4];
+	float Y[4];
+	FLinearColor Colors[4];
+	for (int32 Start = 0; Start < Points.Num(); Start += 4)
+	{
+		const int32 Num = FMath::Min(4, Points.Num() - Start);
+		for (int32 Idx = 0; Idx < 4; ++Idx)
+		{
+			// fill the rest of a partial batch with the last point
+			const FVector2f& Point = Points[Start + FMath::Min(Idx, Num - 1)];
+			X[Idx] = Point.X;
+			Y[Idx] = Point.Y;
+		}
+
+		InterpretBatch(Layers, MakeArrayView(X), MakeArrayView(Y), PixelSize, MakeArrayView(Colors));
+
+		for (int32 Idx = 0; Idx < Num; ++Idx)
+		{
+			OutColors[Start + Idx] = Colors[Idx];
+		}
+	}
+}
+
+FLinearColor FMGFXPackedLayersInterpreter::EvaluatePoint(const FMGFXPackedLayers& Layers, const FVector2f& Point, float PixelSize)
+{
+	FLinearColor Result;
+	Evaluate(Layers, MakeArrayView(&Point, 1), PixelSize, MakeArrayView(&Result, 1));
+	return Result;
+}
+
+void FMGFXPackedLayersInterpreter::InterpretBatch(const FMGFXPackedLayers& Layers, TConstArrayView<float> X, TConstArrayView<float> Y,
+                                                  float PixelSize, TArrayView<FLinearColor> OutColors)
+{
+	const TArray<FVector4f>& Texels = Layers.Texels;
+	const int32 NumTexels = static_cast<int32>(Texels[0].Y);
+	const bool bComputeFilterWidth = Texels[0].Z != 0.f;
+	const float CanvasFilterWidth = bComputeFilterWidth ? PixelSize : Texels[0].W;
+
+	// the outputs of the last layer at each level of nesting, where the top frame is the current level
+	FFrame Frames[FMGFXPackedLayers::MaxDepth];
+	int32 Top = 0;
+
+	// stop at the first invalid instruction, the same as the shader
+	int32 TexelIdx = FMGFXPackedLayers::HeaderSize;
+	while (TexelIdx < NumTexels)
+	{
+		const FVector4f& Instruction = Texels[TexelIdx];
+		const FMGFXPackedLayers::EOp Op = FMGFXPackedLayers::TexelToEnum<FMGFXPackedLayers::EOp>(Instruction.X);
+
+		if (Op == FMGFXPackedLayers::EOp::BeginChildren)
+		{
+			if (Top + 1 >= FMGFXPackedLayers::MaxDepth)
+			{
+				break;
+			}
+			Frames[++Top] = FFrame();
+			++TexelIdx;
+		}
+		else if (Op == FMGFXPackedLayers::EOp::Layer)
+		{
+			const int32 NumVisuals = static_cast<int32>(Instruction.W);
+			const int32 Size = FMGFXPackedLayers::LayerSize + NumVisuals * FMGFXPackedLayers::VisualSize;
+			const bool bHasChildren = EnumHasAnyFlags(FMGFXPackedLayers::TexelToEnum<FMGFXPackedLayers::ELayerFlags>(Instruction.Z),
+			                                          FMGFXPackedLayers::ELayerFlags::HasChildren);
+			if (TexelIdx + Size > NumTexels || (bHasChildren && Top == 0))
+			{
+				break;
+			}
+
+			// pop the children, and replace the previous sibling with this layer
+			const FFrame ChildFrame = bHasChildren ? Frames[Top--] : FFrame();
+			FFrame OutFrame;
+			InterpretLayer(&Texels[TexelIdx], X, Y, CanvasFilterWidth, PixelSize, Frames[Top], ChildFrame, OutFrame);
+			Frames[Top] = OutFrame;
+			TexelIdx += Size;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	float R[4], G[4], B[4], A[4];
+	const FMGFXVectorRGBA Result = FMGFXVectorMath::Unpremult(Frames[0].Visual);
+	VectorStore(Result.R, R);
+	VectorStore(Result.G, G);
+	VectorStore(Result.B, B);
+	VectorStore(Result.A, A);
+	for (int32 Idx = 0; Idx < 4; ++Idx)
+	{
+		OutColors[Idx] = FLinearColor(R[Idx], G[Idx], B[Idx], A[Idx]);
+	}
+}
+
+void FMGFXPackedLayersInterpreter::InterpretLayer(const FVector4f* LayerTexels, TConstArrayView<float> X, TConstArrayView<float> Y,
+                                                  float CanvasFilterWidth, float PixelSize, const FFrame& PrevFrame, const FFrame& ChildFrame,
+                                                  FFrame& OutFrame)
+{
+	const EMGFXShapeType ShapeType = FMGFXPackedLayers::TexelToEnum<EMGFXShapeType>(LayerTexels[0].Y);
+	const FMGFXPackedLayers::ELayerFlags Flags = FMGFXPackedLayers::TexelToEnum<FMGFXPackedLayers::ELayerFlags>(LayerTexels[0].Z);
+	const int32 NumVisuals = static_cast<int32>(LayerTexels[0].W);
+	const FVector4f& Row0 = LayerTexels[1];
+	const FVector4f& Row1 = LayerTexels[2];
+	const FVector4f& ShapeInputs = LayerTexels[3];
+	const FVector4f& Scales = LayerTexels[4];
+	const EMGFXLayerMergeOperation MergeOperation = FMGFXPackedLayers::TexelToEnum<EMGFXLayerMergeOperation>(Row0.W);
+
+	OutFrame = FFrame();
+
+	if (ShapeType != EMGFXShapeType::None)
+	{
+		// transform points into local space
+		float LocalX[4];
+		float LocalY[4];
+		float SDF[4];
+		for (int32 Idx = 0; Idx < 4; ++Idx)
+		{
+			LocalX[Idx] = X[Idx] * Row0.X + Y[Idx] * Row0.Y + Row0.Z;
+			LocalY[Idx] = X[Idx] * Row1.X + Y[Idx] * Row1.Y + Row1.Z;
+		}
+		FMGFXShapeSDF::Evaluate(ShapeType, ShapeInputs, MakeArrayView(LocalX), MakeArrayView(LocalY), MakeArrayView(SDF));
+		OutFrame.Shape = VectorLoad(SDF);
+		OutFrame.bHasShape = true;
+
+		// merge with the shape below before evaluating visuals
+		if (PrevFrame.bHasShape)
+		{
+			const EMGFXShapeMergeOperation ShapeMergeOperation = FMGFXPackedLayers::TexelToEnum<EMGFXShapeMergeOperation>(Row1.W);
+			OutFrame.Shape = FMGFXVectorMath::MergeShapes(PrevFrame.Shape, OutFrame.Shape, ShapeMergeOperation, Scales.X);
+		}
+
+		if (!EnumHasAnyFlags(Flags, FMGFXPackedLayers::ELayerFlags::ShapeMergedWithNext) && NumVisuals > 0)
+		{
+			const float FilterWidth = CanvasFilterWidth * Scales.Y;
+			const float ComputedFilterWidth = PixelSize * Scales.Z;
+
+			for (int32 VisualIdx = 0; VisualIdx < NumVisuals; ++VisualIdx)
+			{
+				const FVector4f& Color = LayerTexels[FMGFXPackedLayers::LayerSize + VisualIdx * FMGFXPackedLayers::VisualSize];
+				const FVector4f& Settings = LayerTexels[FMGFXPackedLayers::LayerSize + VisualIdx * FMGFXPackedLayers::VisualSize + 1];
+				const float VisualFilterWidth = Settings.W != 0.f ? ComputedFilterWidth : FilterWidth;
+				const VectorRegister4Float Coverage = Settings.X != 0.f
+					                                      ? FMGFXVectorMath::Stroke(OutFrame.Shape, Settings.Y, VisualFilterWidth)
+					                                      : FMGFXVectorMath::Fill(OutFrame.Shape, VisualFilterWidth, Settings.Z != 0.f);
+				const FMGFXVectorRGBA VisualValue = FMGFXVectorMath::Tint(Coverage, FLinearColor(Color.X, Color.Y, Color.Z, Color.W));
+
+				OutFrame.Visual = VisualIdx == 0 ? VisualValue : FMGFXVectorMath::Merge(VisualValue, OutFrame.Visual, EMGFXLayerMergeOperation::Over);
+			}
+			OutFrame.bHasVisual = true;
+		}
+	}
+
+	// merge this layer with its children
+	if (ChildFrame.bHasVisual)
+	{
+		OutFrame.Visual = OutFrame.bHasVisual ? FMGFXVectorMath::Merge(OutFrame.Visual, ChildFrame.Visual, MergeOperation) : ChildFrame.Visual;
+		OutFrame.bHasVisual = true;
+	}
+
+	// merge this layer with the previous sibling
+	if (PrevFrame.bHasVisual)
+	{
+		OutFrame.Visual = OutFrame.bHasVisual ? FMGFXVectorMath::Merge(OutFrame.Visual, PrevFrame.Visual, MergeOperation) : PrevFrame.Visual;
+		OutFrame.bHasVisual = true;
+	}
+}
@@ -0,0 +1,170 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "MGFXShapeSDF.h"
+
+#include "MGFXVectorMath.h"
+
+
+void FMGFXShapeSDF::Evaluate(EMGFXShapeType Type, const FVector4f& Inputs, TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF)
+{
+	switch (Type)
+	{
+	case EMGFXShapeType::Circle:
+		Circle(X, Y, OutSDF, Inputs.X);
+		break;
+	case EMGFXShapeType::Rect:
+		Rect(X, Y, OutSDF, FVector2f(Inputs.X, Inputs.Y), Inputs.Z);
+		break;
+	case EMGFXShapeType::Line:
+		Line(X, Y, OutSDF, FVector2f(Inputs.X, Inputs.Y), FVector2f(Inputs.Z, Inputs.W));
+		break;
+	case EMGFXShapeType::Cross:
+		Cross(X, Y, OutSDF, Inputs.X);
+		break;
+	case EMGFXShapeType::GridDots:
+		GridDots(X, Y, OutSDF, FVector2f(Inputs.X, Inputs.Y), Inputs.Z);
+		break;
+	case EMGFXShapeType::Arc:
+		Arc(X, Y, OutSDF, Inputs.X, Inputs.Y, Inputs.Z);
+		break;
+	case EMGFXShapeType::Pie:
+		Pie(X, Y, OutSDF, Inputs.X, Inputs.Y, Inputs.Z);
+		break;
+	case EMGFXShapeType::Triangle:
+		Triangle(X, Y, OutSDF, Inputs.X, Inputs.Y);
+		break;
+	default:
+		break;
+	}
+}
+
+void FMGFXShapeSDF::Circle(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size)
+{
+	const VectorRegister4Float Radius = VectorSetFloat1(Size * 0.5f);
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		return VectorSubtract(FMGFXVectorMath::Length(UVX, UVY), Radius);
+	});
+}
+
+void FMGFXShapeSDF::Rect(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FVector2f Size, float CornerRadius)
+{
+	const VectorRegister4Float QOffsetX = VectorSetFloat1(CornerRadius - Size.X * 0.5f);
+	const VectorRegister4Float QOffsetY = VectorSetFloat1(CornerRadius - Size.Y * 0.5f);
+	const VectorRegister4Float Radius = VectorSetFloat1(CornerRadius);
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		const VectorRegister4Float QX = VectorAdd(VectorAbs(UVX), QOffsetX);
+		const VectorRegister4Float QY = VectorAdd(VectorAbs(UVY), QOffsetY);
+		const VectorRegister4Float Outside = FMGFXVectorMath::Length(VectorMax(QX, VectorZeroFloat()), VectorMax(QY, VectorZeroFloat()));
+		const VectorRegister4Float Inside = VectorMin(VectorMax(QX, QY), VectorZeroFloat());
+		return VectorSubtract(VectorAdd(Outside, Inside), Radius);
+	});
+}
+
+void FMGFXShapeSDF::Line(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FVector2f PointA, FVector2f PointB)
+{
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		return FMGFXVectorMath::Segment(UVX, UVY, PointA, PointB);
+	});
+}
+
+void FMGFXShapeSDF::Cross(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size)
+{
+	const float HalfSize = Size * 0.5f;
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		return VectorMin(FMGFXVectorMath::Segment(UVX, UVY, FVector2f(-HalfSize, 0.f), FVector2f(HalfSize, 0.f)),
+		                 FMGFXVectorMath::Segment(UVX, UVY, FVector2f(0.f, -HalfSize), FVector2f(0.f, HalfSize)));
+	});
+}
+
+void FMGFXShapeSDF::GridDots(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FVector2f Spacing, float Size)
+{
+	// repeat a circle in every cell of the grid
+	const VectorRegister4Float SpacingX = VectorSetFloat1(Spacing.X);
+	const VectorRegister4Float SpacingY = VectorSetFloat1(Spacing.Y);
+	const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+	const VectorRegister4Float Radius = VectorSetFloat1(Size * 0.5f);
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		const VectorRegister4Float CellX = VectorMultiply(VectorSubtract(FMGFXVectorMath::Frac(VectorAdd(VectorDivide(UVX, SpacingX), Half)), Half), SpacingX);
+		const VectorRegister4Float CellY = VectorMultiply(VectorSubtract(FMGFXVectorMath::Frac(VectorAdd(VectorDivide(UVY, SpacingY), Half)), Half), SpacingY);
+		return VectorSubtract(FMGFXVectorMath::Length(CellX, CellY), Radius);
+	});
+}
+
+void FMGFXShapeSDF::Arc(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size, float Width, float Sweep)
+{
+	// the arc is symmetric around the top of the circle, with uvs y-down
+	float Sin, Cos;
+	FMath::SinCos(&Sin, &Cos, Sweep * UE_PI);
+	const float Radius = (Size - Width) * 0.5f;
+	const VectorRegister4Float VSin = VectorSetFloat1(Sin);
+	const VectorRegister4Float VCos = VectorSetFloat1(Cos);
+	const VectorRegister4Float EndX = VectorSetFloat1(Sin * Radius);
+	const VectorRegister4Float EndY = VectorSetFloat1(Cos * Radius);
+	const VectorRegister4Float VRadius = VectorSetFloat1(Radius);
+	const VectorRegister4Float HalfWidth = VectorSetFloat1(Width * 0.5f);
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		const VectorRegister4Float PX = VectorAbs(UVX);
+		const VectorRegister4Float PY = VectorNegate(UVY);
+		const VectorRegister4Float EndDistance = FMGFXVectorMath::Length(VectorSubtract(PX, EndX), VectorSubtract(PY, EndY));
+		const VectorRegister4Float RingDistance = VectorAbs(VectorSubtract(FMGFXVectorMath::Length(PX, PY), VRadius));
+		const VectorRegister4Float bPastEnd = VectorCompareGT(VectorMultiply(VCos, PX), VectorMultiply(VSin, PY));
+		return VectorSubtract(VectorSelect(bPastEnd, EndDistance, RingDistance), HalfWidth);
+	});
+}
+
+void FMGFXShapeSDF::Pie(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size, float Sweep, float CornerRadius)
+{
+	// the pie is symmetric around the top of the circle, with uvs y-down
+	float Sin, Cos;
+	FMath::SinCos(&Sin, &Cos, Sweep * UE_PI);
+	const VectorRegister4Float VSin = VectorSetFloat1(Sin);
+	const VectorRegister4Float VCos = VectorSetFloat1(Cos);
+	const VectorRegister4Float Radius = VectorSetFloat1(Size * 0.5f - CornerRadius);
+	const VectorRegister4Float VCornerRadius = VectorSetFloat1(CornerRadius);
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		const VectorRegister4Float PX = VectorAbs(UVX);
+		const VectorRegister4Float PY = VectorNegate(UVY);
+		const VectorRegister4Float CircleDistance = VectorSubtract(FMGFXVectorMath::Length(PX, PY), Radius);
+		const VectorRegister4Float T = FMGFXVectorMath::Clamp(VectorMultiplyAdd(PX, VSin, VectorMultiply(PY, VCos)), VectorZeroFloat(), Radius);
+		const VectorRegister4Float EdgeDistance = FMGFXVectorMath::Length(VectorNegateMultiplyAdd(VSin, T, PX), VectorNegateMultiplyAdd(VCos, T, PY));
+		const VectorRegister4Float EdgeSign = FMGFXVectorMath::Sign(VectorSubtract(VectorMultiply(VCos, PX), VectorMultiply(VSin, PY)));
+		return VectorSubtract(VectorMax(CircleDistance, VectorMultiply(EdgeDistance, EdgeSign)), VCornerRadius);
+	});
+}
+
+void FMGFXShapeSDF::Triangle(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size, float CornerRadius)
+{
+	// an equilateral triangle pointing up, with uvs y-down
+	const float K = FMath::Sqrt(3.f);
+	const float HalfSize = Size * 0.5f - CornerRadius;
+	const VectorRegister4Float VK = VectorSetFloat1(K);
+	const VectorRegister4Float VHalfSize = VectorSetFloat1(HalfSize);
+	const VectorRegister4Float OffsetY = VectorSetFloat1(HalfSize / K);
+	const VectorRegister4Float MinX = VectorSetFloat1(-2.f * HalfSize);
+	const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+	const VectorRegister4Float VCornerRadius = VectorSetFloat1(CornerRadius);
+	FMGFXVectorMath::ForEachPoint4(X, Y, OutSDF, [&](const VectorRegister4Float& UVX, const VectorRegister4Float& UVY)
+	{
+		VectorRegister4Float PX = VectorSubtract(VectorAbs(UVX), VHalfSize);
+		VectorRegister4Float PY = VectorSubtract(OffsetY, UVY);
+
+		// reflect points beyond the edge
+		const VectorRegister4Float bReflect = VectorCompareGT(VectorMultiplyAdd(VK, PY, PX), VectorZeroFloat());
+		const VectorRegister4Float ReflectedX = VectorMultiply(VectorNegateMultiplyAdd(VK, PY, PX), Half);
+		const VectorRegister4Float ReflectedY = VectorMultiply(VectorNegate(VectorMultiplyAdd(VK, PX, PY)), Half);
+		PX = VectorSelect(bReflect, ReflectedX, PX);
+		PY = VectorSelect(bReflect, ReflectedY, PY);
+
+		PX = VectorSubtract(PX, FMGFXVectorMath::Clamp(PX, MinX, VectorZeroFloat()));
+		const VectorRegister4Float Distance = VectorMultiply(FMGFXVectorMath::Length(PX, PY), FMGFXVectorMath::Sign(PY));
+		return VectorSubtract(VectorNegate(Distance), VCornerRadius);
+	});
+}
@@ -3,6 +3,7 @@
 
 #include "Shapes/MGFXMaterialShape.h"
 
+#include "MGFXShapeSDF.h"
 #include "Materials/MaterialFunctionInterface.h"
 #include "Shapes/MGFXMaterialShapeVisual.h"
 #include "Misc/DataValidation.h"
@@ -53,6 +54,19 @@ UMaterialFunctionInterface* UMGFXMaterialShape::GetMaterialFunction() const
 	return !FunctionPtr.IsNull() ? FunctionPtr.LoadSynchronous() : nullptr;
 }
 
+bool UMGFXMaterialShape::CanEvaluateSDF() const
+{
+	FVector4f Inputs;
+	return GetShapeType(Inputs) != EMGFXShapeType::None;
+}
+
+void UMGFXMaterialShape::EvaluateSDF(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF) const
+{
+	FVector4f Inputs;
+	const EMGFXShapeType ShapeType = GetShapeType(Inputs);
+	FMGFXShapeSDF::Evaluate(ShapeType, Inputs, X, Y, OutSDF);
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape::GetBounds() const
 {
@@ -70,6 +84,16 @@ TArray<FMGFXMaterialShapeInput> UMGFXMaterialShape::GetInputs_BP_Implementation(
 	return TArray<FMGFXMaterialShapeInput>();
 }
 
+TArray<FString> UMGFXMaterialShape::GetInputNames() const
+{
+	TArray<FString> Result;
+	for (const FMGFXMaterialShapeInput& Input : GetInputs())
+	{
+		Result.Add(Input.Name);
+	}
+	return Result;
+}
+
 EDataValidationResult UMGFXMaterialShape::IsDataValid(FDataValidationContext& Context) const
 {
 	EDataValidationResult Result = Super::IsDataValid(Context);
@@ -11,9 +11,16 @@ UMGFXMaterialShape_Arc::UMGFXMaterialShape_Arc()
 {
 	ShapeName = TEXT("Arc");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeFill::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Arc::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Size, Width, Sweep, 0.f);
+	return EMGFXShapeType::Arc;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Arc::GetBounds() const
 {
@@ -11,9 +11,16 @@ UMGFXMaterialShape_Circle::UMGFXMaterialShape_Circle()
 {
 	ShapeName = TEXT("Circle");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeFill::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Circle::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Size, 0.f, 0.f, 0.f);
+	return EMGFXShapeType::Circle;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Circle::GetBounds() const
 {
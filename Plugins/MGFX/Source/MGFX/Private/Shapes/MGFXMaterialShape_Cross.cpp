@@ -11,9 +11,16 @@ UMGFXMaterialShape_Cross::UMGFXMaterialShape_Cross()
 {
 	ShapeName = TEXT("Cross");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeStroke::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Cross::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Size, 0.f, 0.f, 0.f);
+	return EMGFXShapeType::Cross;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Cross::GetBounds() const
 {
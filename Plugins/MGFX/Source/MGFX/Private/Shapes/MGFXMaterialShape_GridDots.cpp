@@ -11,9 +11,16 @@ UMGFXMaterialShape_GridDots::UMGFXMaterialShape_GridDots()
 {
 	ShapeName = TEXT("GridDots");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeFill::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_GridDots::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Spacing.X, Spacing.Y, Size, 0.f);
+	return EMGFXShapeType::GridDots;
+}
+
 #if WITH_EDITOR
 TArray<FMGFXMaterialShapeInput> UMGFXMaterialShape_GridDots::GetInputs() const
 {
@@ -11,9 +11,16 @@ UMGFXMaterialShape_Line::UMGFXMaterialShape_Line()
 {
 	ShapeName = TEXT("Line");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeStroke::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Line::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(PointA.X, PointA.Y, PointB.X, PointB.Y);
+	return EMGFXShapeType::Line;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Line::GetBounds() const
 {
@@ -11,9 +11,16 @@ UMGFXMaterialShape_Pie::UMGFXMaterialShape_Pie()
 {
 	ShapeName = TEXT("Pie");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeFill::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Pie::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Size, Sweep, CornerRadius, 0.f);
+	return EMGFXShapeType::Pie;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Pie::GetBounds() const
 {
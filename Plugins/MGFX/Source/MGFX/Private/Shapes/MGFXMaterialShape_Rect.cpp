@@ -11,9 +11,16 @@ UMGFXMaterialShape_Rect::UMGFXMaterialShape_Rect()
 {
 	ShapeName = TEXT("Rect");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeFill::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Rect::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Size.X, Size.Y, CornerRadius, 0.f);
+	return EMGFXShapeType::Rect;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Rect::GetBounds() const
 {
@@ -11,9 +11,16 @@ UMGFXMaterialShape_Triangle::UMGFXMaterialShape_Triangle()
 {
 	ShapeName = TEXT("Triangle");
 	MaterialFunction = FMGFXMaterialFunctions::GetShape(ShapeName);
+	HLSLFunctionName = FMGFXMaterialFunctions::GetShapeHLSLFunction(ShapeName);
 	DefaultVisualsClass = UMGFXMaterialShapeFill::StaticClass();
 }
 
+EMGFXShapeType UMGFXMaterialShape_Triangle::GetShapeType(FVector4f& OutInputs) const
+{
+	OutInputs = FVector4f(Size, CornerRadius, 0.f, 0.f);
+	return EMGFXShapeType::Triangle;
+}
+
 #if WITH_EDITOR
 FBox2D UMGFXMaterialShape_Triangle::GetBounds() const
 {
@@ -0,0 +1,45 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetUserData.h"
+#include "MGFXGeneratedMaterialUserData.generated.h"
+
+
+/**
+ * Stored on a material generated from an MGFX material, to detect when it needs to be regenerated.
+ */
+UCLASS()
+class MGFX_API UMGFXGeneratedMaterialUserData : public UAssetUserData
+{
+	GENERATED_BODY()
+
+public:
+	/** Hash of the MGFX material content and generator settings the material was last generated from. */
+	UPROPERTY(VisibleAnywhere, Category = "MGFX")
+	uint32 ContentHash = 0;
+
+	/** The version of the generator the material was last generated by, stored separately so that shared materials keep their name. */
+	UPROPERTY(VisibleAnywhere, Category = "MGFX")
+	uint32 GeneratorVersion = 0;
+
+	/** True if the material is shared by every MGFX material with the same structure, and must never be regenerated for another one. */
+	UPROPERTY(VisibleAnywhere, Category = "MGFX")
+	bool bIsSharedMaterial = false;
+
+	/**
+	 * The hashes combined into the content hash of a shared material, whose name only contains the combined hash.
+	 * Compared before reusing a shared material, to detect materials with a different structure but the same name.
+	 */
+	UPROPERTY(VisibleAnywhere, Category = "MGFX")
+	uint32 SettingsHash = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "MGFX")
+	uint32 BoilerplateHash = 0;
+
+	UPROPERTY(VisibleAnywhere, Category = "MGFX")
+	uint32 LayersHash = 0;
+
+	virtual bool IsEditorOnly() const override { return true; }
+};
@@ -8,7 +8,9 @@
 #include "Styling/SlateBrush.h"
 #include "MGFXMaterial.generated.h"
 
+class UMaterialInstanceConstant;
 class UMGFXMaterialShape;
+class UTexture2D;
 
 
 /**
@@ -69,10 +71,79 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced")
 	bool bAllAnimatable = false;
 
+	/**
+	 * How the material is generated. All parameters are exposed the same way by the Graph and HLSL backends.
+	 * HLSL requires every shape to define an HLSL function. Interpreted supports only builtin shapes, and has no layer parameters.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced")
+	EMGFXMaterialGeneratorBackend GeneratorBackend = EMGFXMaterialGeneratorBackend::Graph;
+
+	/**
+	 * Skip evaluating the shape and visuals of each bounded layer for pixels outside of its bounds, using a dynamic branch.
+	 * Greatly reduces the cost of materials made of many small shapes. Requires the HLSL backend.
+	 * Layers with exposed shape inputs, merged shapes, or visuals that compute their own filter width are always evaluated.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced",
+		Meta = (EditCondition = "GeneratorBackend == EMGFXMaterialGeneratorBackend::HLSL"))
+	bool bEnableBoundsBranching = false;
+
+	/**
+	 * Pack scalar parameters of each layer into the channels of shared vector parameters, unpacked with component masks.
+	 * Reduces the number of parameters and the size of the uniform buffer. Packed values must be set using the
+	 * vector parameter named after the first scalar parameter in it, e.g. "Layer.LocationX_Packed".
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced")
+	bool bPackParameters = false;
+
+	/**
+	 * Optimize the editor preview the same as the target material, except for selected and recently edited layers.
+	 * Keeps the preview of large materials close to their final cost, but editing other layers requires regenerating the preview.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced")
+	bool bOptimizePreview = false;
+
+	/**
+	 * Generate a parent material shared by all MGFX materials with the same structure, and output a material instance with
+	 * the values of this material. Every value becomes a parameter, as if all animatable, but materials that differ only in
+	 * colors, sizes, and positions share one compiled material. Not used by the interpreted backend, which is always shared.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced",
+		Meta = (EditCondition = "GeneratorBackend != EMGFXMaterialGeneratorBackend::Interpreted"))
+	bool bUseSharedMaterial = false;
+
+	/** The directory containing shared materials, which are named after the hash of their structure. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Advanced", Meta = (ContentDir, EditCondition = "bUseSharedMaterial"))
+	FDirectoryPath SharedMaterialDirectory;
+
 	/** The target material asset being edited. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, AssetRegistrySearchable, Category = "Advanced")
 	TObjectPtr<UMaterial> Material;
 
+	/** The instance of the shared material with the values of this material, when using a shared material. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AssetRegistrySearchable, Category = "Advanced", Meta = (EditCondition = "bUseSharedMaterial"))
+	TObjectPtr<UMaterialInstanceConstant> MaterialInstance;
+
+	/** The texture containing the packed layers of the material, used as the default layer data of the interpreted backend. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AssetRegistrySearchable, Category = "Advanced",
+		Meta = (EditCondition = "GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted"))
+	TObjectPtr<UTexture2D> PackedLayersTexture;
+
+	/** Where the time of keyframed layer animations comes from. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation")
+	EMGFXAnimationTimeSource AnimationTimeSource = EMGFXAnimationTimeSource::Time;
+
+	/** Settings for baking the material into textures, for static designs that don't need to be evaluated per pixel at runtime. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Bake")
+	FMGFXBakeSettings BakeSettings;
+
+	/** The texture the material was last baked into. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AssetRegistrySearchable, Category = "Bake")
+	TObjectPtr<UTexture2D> BakedTexture;
+
+	/** The distance field texture the material was last baked into, if enabled. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, AssetRegistrySearchable, Category = "Bake")
+	TObjectPtr<UTexture2D> BakedDistanceFieldTexture;
+
 	/** The root layers of the material. */
 	UPROPERTY()
 	TArray<TObjectPtr<UMGFXMaterialLayer>> RootLayers;
@@ -80,6 +151,12 @@ public:
 	/** Return a flat list of all layers in the material. */
 	void GetAllLayers(TArray<UMGFXMaterialLayer*>& OutLayers) const;
 
+	/** Return true if the material is generated as a shared material, with its values set by a material instance. */
+	bool UsesSharedMaterial() const;
+
+	/** Return the material to render this MGFX material with, which is the material instance when using a shared material. */
+	UMaterialInterface* GetOutputMaterial() const;
+
 	// IMGFXMaterialLayerParentInterface
 	virtual const TArray<TObjectPtr<UMGFXMaterialLayer>>& GetLayers() const override { return RootLayers; }
 	virtual TArray<TObjectPtr<UMGFXMaterialLayer>>& GetMutableLayers() override { return RootLayers; }
@@ -0,0 +1,88 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialTypes.h"
+#include "PixelFormat.h"
+
+class UMGFXMaterial;
+class UTexture2D;
+
+
+/**
+ * The pixels of an MGFX material baked on the CPU.
+ */
+struct MGFX_API FMGFXBakedImage
+{
+	/** The size of the image in pixels. */
+	FIntPoint Size = FIntPoint::ZeroValue;
+
+	/** The unpremultiplied sRGB colors, row by row. */
+	TArray<FColor> Colors;
+
+	/**
+	 * The encoded distance to the nearest edge of the baked coverage, row by row, where 128 is the edge and larger values are inside.
+	 * Empty if not baked.
+	 */
+	TArray<uint8> DistanceField;
+
+	/** False if any shapes were skipped because they can't be evaluated on the CPU, e.g. shapes that aren't builtin. */
+	bool bIsComplete = true;
+
+	bool IsValid() const { return Size.X > 0 && Size.Y > 0 && Colors.Num() == Size.X * Size.Y; }
+};
+
+
+/**
+ * Rasterizes MGFX materials into images on the CPU using FMGFXMaterialEvaluator, for static designs that
+ * can use a single texture sample instead of evaluating every layer per pixel.
+ * The image is split into tiles that are rasterized across worker threads, and uses the same filter width antialiasing
+ * as the generated material when displayed at the baked resolution.
+ */
+class MGFX_API FMGFXMaterialBaker
+{
+public:
+	/** The size in pixels of each tile rasterized by a worker thread. */
+	static constexpr int32 TileSize = 64;
+
+	/** Return the resolution to bake at, using the base canvas size if the settings don't specify one. */
+	static FIntPoint GetBakeResolution(const UMGFXMaterial* MGFXMaterial, const FMGFXBakeSettings& Settings);
+
+	/** Rasterize a material, returning false if it has nothing to bake. */
+	static bool Bake(const UMGFXMaterial* MGFXMaterial, const FMGFXBakeSettings& Settings, FMGFXBakedImage& OutImage);
+
+	/** Encode a distance in canvas pixels into a distance field value. */
+	static uint8 EncodeDistance(float Distance, float Spread);
+
+	/**
+	 * Compute the signed distance field of baked coverage, so that it matches the composited alpha of all layers,
+	 * including strokes and merge operations.
+	 * @param Coverage The alpha of each pixel, row by row.
+	 * @param PixelScale The size of a pixel in canvas space.
+	 * @param OutDistances The distance in canvas space from each pixel to the nearest edge, negative inside.
+	 */
+	static void ComputeDistanceField(FIntPoint Size, FVector2f PixelScale, TConstArrayView<float> Coverage, TArray<float>& OutDistances);
+
+	/** Create a transient texture from the colors of a baked image, e.g. to bake at runtime. */
+	static UTexture2D* CreateTransientTexture(const FMGFXBakedImage& Image, FName Name = NAME_None);
+
+	/** Create a transient texture from the distance field of a baked image. */
+	static UTexture2D* CreateTransientDistanceFieldTexture(const FMGFXBakedImage& Image, FName Name = NAME_None);
+
+protected:
+	/** The squared distance of pixels that aren't seeds in a distance transform. */
+	static constexpr float NoSeed = TNumericLimits<float>::Max();
+
+	/**
+	 * Replace the squared distance of each pixel with the squared distance to the nearest seed pixel, which have a distance of 0,
+	 * using the separable exact euclidean distance transform of Felzenszwalb and Huttenlocher.
+	 */
+	static void DistanceTransform(FIntPoint Size, FVector2f PixelScale, TArray<float>& InOutSquaredDistances);
+
+	/** Transform one row or column of squared distances, with pixels Spacing apart. */
+	static void DistanceTransform1D(TArrayView<float> InOutSquaredDistances, float Spacing);
+
+	/** Create a transient texture and fill its first mip with data. */
+	static UTexture2D* CreateTransientTextureFromData(FIntPoint Size, EPixelFormat Format, bool bSRGB, const void* Data, int32 DataSize, FName Name);
+};
@@ -0,0 +1,179 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialTypes.h"
+#include "UObject/WeakObjectPtr.h"
+
+class UMGFXMaterial;
+class UMGFXMaterialLayer;
+class UMGFXMaterialShape;
+struct FMGFXVectorRGBA;
+
+
+/**
+ * Evaluates the layers of an MGFX material on the CPU at arbitrary canvas points, mirroring the shapes, visuals,
+ * and merges of the generated material, e.g. for hit testing or baking.
+ *
+ * Layers are compiled into a flat list once, and points are evaluated in batches using SIMD.
+ * Large numbers of points are split into chunks that are evaluated in parallel.
+ * The material must be recompiled after it changes, and must not be modified while evaluating.
+ */
+class MGFX_API FMGFXMaterialEvaluator
+{
+public:
+	FMGFXMaterialEvaluator()
+	{
+	}
+
+	explicit FMGFXMaterialEvaluator(const UMGFXMaterial* InMGFXMaterial);
+
+	/** The number of points evaluated together in one batch. */
+	static constexpr int32 BatchSize = 32;
+
+	/** The number of points evaluated by each parallel task. */
+	static constexpr int32 ChunkSize = 1024;
+
+	/** The SDF returned for points when no shapes have visuals. */
+	static constexpr float MaxDistance = 1e5f;
+
+	/** Compile all layers of an MGFX material for evaluation. */
+	void Compile(const UMGFXMaterial* InMGFXMaterial);
+
+	/** Return true if the evaluator has been compiled and the material still exists. */
+	bool IsValid() const { return MGFXMaterial.IsValid(); }
+
+	/** Return true if every shape can be evaluated. Shapes that can't be evaluated are skipped, like shapes without an HLSL function. */
+	bool CanEvaluateAllShapes() const { return bCanEvaluateAllShapes; }
+
+	/**
+	 * Evaluate the material at a number of points.
+	 * @param Points The points to evaluate, in canvas space, where the canvas is BaseCanvasSize.
+	 * @param PixelSize The distance between adjacent pixels in canvas space, used as the filter width if the material computes it.
+	 * @param OutColors The unpremultiplied colors, matching the output of the generated material. Must be the same size as Points.
+	 * @param OutSDFs Optional distances in canvas space to the nearest shape with visuals. Must be empty or the same size as Points.
+	 * @param bParallel Evaluate chunks of points across all cores.
+	 */
+	void Evaluate(TConstArrayView<FVector2f> Points, float PixelSize, TArrayView<FLinearColor> OutColors,
+	              TArrayView<float> OutSDFs = TArrayView<float>(), bool bParallel = true) const;
+
+	/** Evaluate the material at a single point. Prefer evaluating points together, since this evaluates a whole batch. */
+	FLinearColor EvaluatePoint(const FVector2f& Point, float PixelSize, float* OutSDF = nullptr) const;
+
+protected:
+	friend class FMGFXLayerPacker;
+
+	/** A compiled visual of a shape. */
+	struct FVisual
+	{
+		FLinearColor Color = FLinearColor::White;
+
+		bool bIsStroke = false;
+
+		float StrokeWidth = 0.f;
+
+		bool bEnableFilterBias = false;
+
+		bool bComputeFilterWidth = false;
+	};
+
+	/** A compiled layer. */
+	struct FLayer
+	{
+		/** The shape to evaluate, or null if the layer has no shape that can be evaluated. */
+		const UMGFXMaterialShape* Shape = nullptr;
+
+		/** The transform from canvas space to the local space of the layer, stored as inverse transform rows. */
+		FVector2f AxisX = FVector2f(1.f, 0.f);
+		FVector2f AxisY = FVector2f(0.f, 1.f);
+		FVector2f Offset = FVector2f::ZeroVector;
+
+		/** The scale of the canvas filter width in local space, reused from the parent unless the material would recompute it. */
+		float FilterWidthScale = 1.f;
+
+		/** The scale of the canvas pixel size in local space, used by visuals that compute their own filter width. */
+		float PixelSizeScale = 1.f;
+
+		/** The scale to convert local distances into canvas distances. */
+		float DistanceScale = 1.f;
+
+		EMGFXShapeMergeOperation ShapeMergeOperation = EMGFXShapeMergeOperation::None;
+
+		float ShapeMergeSmoothness = 0.f;
+
+		/** True if the shape is merged with the layer above, which evaluates the visuals instead. */
+		bool bIsShapeMergedWithNext = false;
+
+		EMGFXLayerMergeOperation MergeOperation = EMGFXLayerMergeOperation::Over;
+
+		TArray<FVisual> Visuals;
+
+		/** The indices of all child layers, bottom to top. */
+		TArray<int32> Children;
+	};
+
+	/** The points of a batch, and the results that aren't per layer. */
+	struct FBatch
+	{
+		float X[BatchSize];
+		float Y[BatchSize];
+
+		/** The minimum distance to all shapes with visuals. */
+		float SDF[BatchSize];
+
+		/** The canvas filter width and pixel size. */
+		float FilterWidth = 0.f;
+		float PixelSize = 0.f;
+	};
+
+	/** The outputs of a layer for a batch, that are merged with the layer above. */
+	struct FLayerOutputs
+	{
+		bool bHasShape = false;
+		bool bHasVisual = false;
+
+		float Shape[BatchSize];
+
+		/** The premultiplied visual. */
+		float R[BatchSize];
+		float G[BatchSize];
+		float B[BatchSize];
+		float A[BatchSize];
+
+		FMGFXVectorRGBA LoadVisual(int32 Idx) const;
+		void StoreVisual(const FMGFXVectorRGBA& Visual, int32 Idx);
+	};
+
+	/** Compile a layer and all its children recursively, returning its index. */
+	int32 CompileLayer(const UMGFXMaterialLayer* Layer, const FTransform2D& ParentTransform, float ParentFilterWidthScale);
+
+	/** Evaluate all points of a chunk in batches. */
+	void EvaluateChunk(TConstArrayView<FVector2f> Points, float PixelSize, TArrayView<FLinearColor> OutColors, TArrayView<float> OutSDFs) const;
+
+	/** Evaluate a layer and all its children, merged with the outputs of the previous sibling. */
+	void EvaluateLayer(const FLayer& Layer, FBatch& Batch, const FLayerOutputs& PrevOutputs, FLayerOutputs& OutOutputs) const;
+
+	/** Evaluate the visuals of a shape, merging each over the previous ones. */
+	void EvaluateVisuals(const FLayer& Layer, FBatch& Batch, FLayerOutputs& OutOutputs) const;
+
+	/** Return true if the shape of a layer is merged with the next layer above. */
+	static bool IsShapeMergedWithNext(const UMGFXMaterialLayer* Layer);
+
+	/** The material that was compiled. */
+	TWeakObjectPtr<const UMGFXMaterial> MGFXMaterial;
+
+	/** All compiled layers. */
+	TArray<FLayer> Layers;
+
+	/** The indices of all root layers, bottom to top. */
+	TArray<int32> RootLayers;
+
+	bool bComputeFilterWidth = true;
+
+	float FixedFilterWidth = 1.f;
+
+	bool bAllAnimatable = false;
+
+	bool bCanEvaluateAllShapes = true;
+};
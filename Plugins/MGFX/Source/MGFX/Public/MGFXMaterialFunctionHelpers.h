@@ -35,6 +35,9 @@ public:
 	/** Return a soft object pointer to a material function in the Util folder. */
 	static TSoftObjectPtr<UMaterialFunctionInterface> GetUtil(const FString& Name);
 
+	/** Return the name of a shape's HLSL function defined in the shapes shader file. */
+	static FString GetShapeHLSLFunction(const FString& Name);
+
 public:
 	/** The unreal path to all material functions in the plugin. */
 	static FString MaterialFunctionsPath;
@@ -44,4 +47,13 @@ public:
 	static FString TransformPath;
 	static FString UtilPath;
 	static FString VisualPath;
+
+	/** The virtual shader path of the file defining all transform, visual, and merge HLSL functions. */
+	static FString CommonShaderPath;
+
+	/** The virtual shader path of the file defining all shape HLSL functions. */
+	static FString ShapesShaderPath;
+
+	/** The virtual shader path of the file defining the packed layer interpreter. */
+	static FString InterpreterShaderPath;
 };
@@ -83,6 +83,19 @@ public:
 	UPROPERTY(EditAnywhere, Instanced, Category = "Shape")
 	TObjectPtr<UMGFXMaterialShape> Shape;
 
+	/**
+	 * Keyframed animations of the transform, shape inputs, and visuals of this layer.
+	 * Keys are baked into the generated material and evaluated from the animation time, replacing the parameters of animated properties.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation")
+	TArray<FMGFXPropertyAnimation> Animations;
+
+	/** Return the animation of a property of this layer, its shape, or one of its visuals, or null if it isn't animated. */
+	const FMGFXPropertyAnimation* FindAnimation(const UObject* Object, FName PropertyName) const;
+
+	/** Return true if the location, rotation, or scale of this layer is animated. */
+	bool IsTransformAnimated() const;
+
 #if WITH_EDITOR
 	/** Return the accumulated transform of this layer. */
 	FTransform2D GetTransform() const;
@@ -49,6 +49,45 @@ enum class EMGFXLayerMergeOperation : uint8
 };
 
 
+/**
+ * The builtin shapes with SDFs that can be evaluated on the CPU and by the interpreted material.
+ * Values are stored in packed layer data, so existing values must not change.
+ */
+UENUM(BlueprintType)
+enum class EMGFXShapeType : uint8
+{
+	/** A shape that can only be evaluated using its material or HLSL function. */
+	None,
+	Circle,
+	Rect,
+	Line,
+	Cross,
+	GridDots,
+	Arc,
+	Pie,
+	Triangle,
+};
+
+
+/**
+ * The method used to generate a material from an MGFX material.
+ */
+UENUM(BlueprintType)
+enum class EMGFXMaterialGeneratorBackend : uint8
+{
+	/** Generate a material graph using material functions for every shape, visual, and merge. */
+	Graph,
+	/** Generate straight-line HLSL for all layers in a single custom expression. Much faster to generate and compile for large materials. */
+	HLSL,
+	/**
+	 * Generate a fixed material that interprets packed layer data from a texture, instead of generating code for each layer.
+	 * Layers can be changed without recompiling shaders, and all materials share the same shader, but it is slower to render.
+	 * Only builtin shapes are supported, and all values are stored in the layer data instead of material parameters.
+	 */
+	Interpreted,
+};
+
+
 USTRUCT(BlueprintType)
 struct MGFX_API FMGFXShapeTransform2D
 {
@@ -76,6 +115,12 @@ struct MGFX_API FMGFXShapeTransform2D
 
 	FTransform2D ToTransform2D() const;
 
+	/**
+	 * Return the value to use for a packed rotation material parameter.
+	 * The inverse rotation is stored as the rotated X axis in RG, so that materials can rotate uvs without any trig.
+	 */
+	static FLinearColor GetRotationParameterValue(float InRotation);
+
 	/** Return true if the location, rotation, and scale are equal. */
 	bool IsEqual(const FMGFXShapeTransform2D& Other) const
 	{
@@ -84,3 +129,107 @@ struct MGFX_API FMGFXShapeTransform2D
 			Scale == Other.Scale;
 	}
 };
+
+
+/**
+ * How an animated value changes from one key to the next.
+ */
+UENUM(BlueprintType)
+enum class EMGFXAnimationInterpMode : uint8
+{
+	/** Hold the value of the key until the next key. */
+	Constant,
+	/** Interpolate linearly to the next key. */
+	Linear,
+	/** Ease in and out of the next key. */
+	Smooth,
+};
+
+
+/**
+ * Where the time of keyframed layer animations comes from.
+ */
+UENUM(BlueprintType)
+enum class EMGFXAnimationTimeSource : uint8
+{
+	/** The material time, so that animations play without any CPU cost. */
+	Time,
+	/** A scalar parameter named AnimationTime, for animations that are started, stopped, or scrubbed by game code. */
+	Parameter,
+};
+
+
+USTRUCT(BlueprintType)
+struct MGFX_API FMGFXAnimationKey
+{
+	GENERATED_BODY()
+
+	/** The time of the key in seconds. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Time = 0.f;
+
+	/** The value of the key, stored the same way as shape inputs, e.g. X and Y in R and G for a Vector2. Rotation is in degrees. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FLinearColor Value = FLinearColor(0.f, 0.f, 0.f, 0.f);
+
+	/** How the value changes from this key to the next. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EMGFXAnimationInterpMode InterpMode = EMGFXAnimationInterpMode::Linear;
+};
+
+
+/**
+ * Keyframes of a single layer property, baked into the generated material as a piecewise curve.
+ */
+USTRUCT(BlueprintType)
+struct MGFX_API FMGFXPropertyAnimation
+{
+	GENERATED_BODY()
+
+	/**
+	 * The property to animate. Location, Rotation, and Scale animate the layer transform, Color and StrokeWidth
+	 * animate a visual of the shape, and any other name animates the shape input with that name.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FName PropertyName;
+
+	/** The index of the visual to animate, when animating a visual property. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Meta = (ClampMin = "0"))
+	int32 VisualIndex = 0;
+
+	/** Repeat the keys from the time of the first key to the time of the last, otherwise hold the first and last values. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bLoop = true;
+
+	/** The keys of the animation. Sorted by time when generated. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FMGFXAnimationKey> Keys;
+
+	/** Return the keys sorted by time. */
+	TArray<FMGFXAnimationKey> GetSortedKeys() const;
+};
+
+
+/**
+ * Settings for baking an MGFX material into textures on the CPU.
+ */
+USTRUCT(BlueprintType)
+struct MGFX_API FMGFXBakeSettings
+{
+	GENERATED_BODY()
+
+	/** The size of the baked textures in pixels. Zero uses the base canvas size. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Meta = (ClampMin = "0"))
+	FIntPoint Resolution = FIntPoint::ZeroValue;
+
+	/** Also bake a distance field of the baked coverage, which stays sharp when scaled. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bBakeDistanceField = false;
+
+	/**
+	 * The distance in canvas pixels on each side of a shape edge that the distance field can represent.
+	 * Larger values allow wider outlines and glows, but reduce precision.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Meta = (ClampMin = "0.01", EditCondition = "bBakeDistanceField"))
+	float DistanceFieldSpread = 8.f;
+};
@@ -0,0 +1,152 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FMGFXMaterialEvaluator;
+class UMaterialInstanceDynamic;
+class UMGFXMaterial;
+class UTexture2D;
+
+
+/**
+ * The layers of an MGFX material packed into a program of float4 texels, interpreted by the MGFX_Interpret shader function.
+ *
+ * The first two texels are the header: (Version, NumTexels, bComputeFilterWidth, FixedFilterWidth) and (CanvasSize, 0, 0).
+ * Layers follow bottom to top, each with its children packed before it between a BeginChildren op and the layer itself,
+ * so that the interpreter only needs a stack of layer outputs. A layer is packed as:
+ *   (Layer, ShapeType, Flags, NumVisuals)
+ *   (AxisX.X, AxisY.X, Offset.X, MergeOperation)
+ *   (AxisX.Y, AxisY.Y, Offset.Y, ShapeMergeOperation)
+ *   (ShapeInputs)
+ *   (ShapeMergeSmoothness, FilterWidthScale, PixelSizeScale, 0)
+ * followed by two texels for each visual: (Color) and (bIsStroke, StrokeWidth, bEnableFilterBias, bComputeFilterWidth).
+ * The program ends with an End op. Changes to the format must increment Version and be mirrored in MGFXInterpreter.ush.
+ */
+struct MGFX_API FMGFXPackedLayers
+{
+	static constexpr int32 Version = 1;
+
+	/** The width of layer data textures, which have as many rows as needed. */
+	static constexpr int32 TextureWidth = 256;
+
+	/** The maximum depth of nested layers, including the root. Must match MGFX_INTERPRETER_MAX_DEPTH. */
+	static constexpr int32 MaxDepth = 8;
+
+	static constexpr int32 HeaderSize = 2;
+	static constexpr int32 LayerSize = 5;
+	static constexpr int32 VisualSize = 2;
+
+	/** The ops stored in the first channel of each instruction. */
+	enum class EOp : uint8
+	{
+		End = 0,
+		BeginChildren = 1,
+		Layer = 2,
+	};
+
+	/** Flags stored in the third channel of a layer. */
+	enum class ELayerFlags : uint8
+	{
+		None = 0,
+		HasChildren = 1 << 0,
+		ShapeMergedWithNext = 1 << 1,
+	};
+
+	TArray<FVector4f> Texels;
+
+	/** False if any layers were skipped or packed without their shape, e.g. shapes that aren't builtin or layers nested too deep. */
+	bool bIsComplete = true;
+
+	bool IsValid() const { return Texels.Num() > HeaderSize; }
+
+	/** Store an enum or flags value in a texel channel. */
+	template <typename EnumType>
+	static float EnumToTexel(EnumType Value) { return static_cast<float>(static_cast<uint8>(Value)); }
+
+	/** Read an enum or flags value from a texel channel. */
+	template <typename EnumType>
+	static EnumType TexelToEnum(float Value) { return static_cast<EnumType>(static_cast<uint8>(Value)); }
+
+	/** Return the size of a texture that can store all texels. */
+	FIntPoint GetTextureSize() const;
+
+	/** Return a hash of all texels, e.g. to detect when layer data textures are out of date. */
+	uint32 GetTexelsHash() const;
+};
+
+ENUM_CLASS_FLAGS(FMGFXPackedLayers::ELayerFlags);
+
+
+/**
+ * Packs MGFX materials into layer data for the interpreted material, and creates textures from it.
+ * Layers are packed from the same compiled layers as FMGFXMaterialEvaluator, with all transforms baked.
+ */
+class MGFX_API FMGFXLayerPacker
+{
+public:
+	/** The name of the texture parameter of the interpreted material. */
+	static const FName LayerDataParameterName;
+
+	/** Pack all layers of a material. Returns false if the material is null. */
+	static bool Pack(const UMGFXMaterial* MGFXMaterial, FMGFXPackedLayers& OutLayers);
+
+	/** Create a transient texture containing packed layers, e.g. to change the layers of an interpreted material at runtime. */
+	static UTexture2D* CreateTransientTexture(const FMGFXPackedLayers& Layers, FName Name = NAME_None);
+
+	/**
+	 * Update a transient texture created by CreateTransientTexture with new packed layers, without creating a new texture.
+	 * Returns false if the texture is null or the packed layers no longer fit, in which case a new texture must be created.
+	 */
+	static bool UpdateTransientTexture(UTexture2D* Texture, const FMGFXPackedLayers& Layers);
+
+	/** Create a transient texture of packed layers, and set it as the layer data of a material instance. */
+	static UTexture2D* SetLayerDataParameter(UMaterialInstanceDynamic* MID, const FMGFXPackedLayers& Layers);
+
+#if WITH_EDITOR
+	/** Set the source data of a texture asset to packed layers, configuring it to store exact floats. */
+	static void SetTextureSource(UTexture2D* Texture, const FMGFXPackedLayers& Layers);
+#endif
+
+protected:
+	static void PackLayer(const FMGFXMaterialEvaluator& Evaluator, int32 LayerIdx, int32 Depth, FMGFXPackedLayers& OutLayers);
+
+	/** Return the texels padded to fill a whole texture. */
+	static TArray<FVector4f> GetPaddedTexels(const FMGFXPackedLayers& Layers);
+};
+
+
+/**
+ * Interprets packed layers on the CPU, mirroring MGFX_Interpret, as a reference for testing the packer and the shader.
+ * Results should match FMGFXMaterialEvaluator for the same material, except for shapes that couldn't be packed.
+ */
+class MGFX_API FMGFXPackedLayersInterpreter
+{
+public:
+	/** Return true if packed layers have a valid header and can be interpreted. */
+	static bool CanInterpret(const FMGFXPackedLayers& Layers);
+
+	/**
+	 * Evaluate packed layers at a number of points.
+	 * @param Points The points to evaluate, in canvas space.
+	 * @param PixelSize The distance between adjacent pixels in canvas space.
+	 * @param OutColors The unpremultiplied colors. Must be the same size as Points.
+	 */
+	static void Evaluate(const FMGFXPackedLayers& Layers, TConstArrayView<FVector2f> Points, float PixelSize, TArrayView<FLinearColor> OutColors);
+
+	/** Evaluate packed layers at a single point. */
+	static FLinearColor EvaluatePoint(const FMGFXPackedLayers& Layers, const FVector2f& Point, float PixelSize);
+
+protected:
+	/** The outputs of the last layer at one level of nesting, for 4 points. */
+	struct FFrame;
+
+	/** Interpret packed layers for 4 points. */
+	static void InterpretBatch(const FMGFXPackedLayers& Layers, TConstArrayView<float> X, TConstArrayView<float> Y, float PixelSize,
+	                           TArrayView<FLinearColor> OutColors);
+
+	/** Interpret a packed layer, merged with its children and the previous sibling. */
+	static void InterpretLayer(const FVector4f* LayerTexels, TConstArrayView<float> X, TConstArrayView<float> Y, float CanvasFilterWidth,
+	                           float PixelSize, const FFrame& PrevFrame, const FFrame& ChildFrame, FFrame& OutFrame);
+};
@@ -0,0 +1,36 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialTypes.h"
+
+
+/**
+ * SIMD versions of the builtin shape functions in MGFXShapes.ush, used to evaluate shapes on the CPU.
+ * Shapes are identified by type, with their inputs packed in the same order as the arguments of their HLSL function.
+ */
+struct MGFX_API FMGFXShapeSDF
+{
+	/**
+	 * Evaluate the SDF of a builtin shape at a batch of points in local space.
+	 * The number of points must be a multiple of 4. Does nothing for shapes of type None.
+	 */
+	static void Evaluate(EMGFXShapeType Type, const FVector4f& Inputs, TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF);
+
+	static void Circle(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size);
+
+	static void Rect(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FVector2f Size, float CornerRadius);
+
+	static void Line(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FVector2f PointA, FVector2f PointB);
+
+	static void Cross(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size);
+
+	static void GridDots(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FVector2f Spacing, float Size);
+
+	static void Arc(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size, float Width, float Sweep);
+
+	static void Pie(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size, float Sweep, float CornerRadius);
+
+	static void Triangle(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, float Size, float CornerRadius);
+};
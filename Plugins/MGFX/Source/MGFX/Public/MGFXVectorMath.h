@@ -0,0 +1,203 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialTypes.h"
+
+
+/**
+ * Four premultiplied RGBA colors stored as one vector per channel.
+ */
+struct FMGFXVectorRGBA
+{
+	VectorRegister4Float R;
+	VectorRegister4Float G;
+	VectorRegister4Float B;
+	VectorRegister4Float A;
+};
+
+
+/**
+ * SIMD versions of the HLSL functions in MGFXCommon.ush, used to evaluate MGFX materials on the CPU.
+ * Every function operates on 4 values at once, and must match the result of the HLSL function it mirrors.
+ */
+struct FMGFXVectorMath
+{
+	/** Call Func with the x and y vectors of each group of 4 points, and store the returned SDF. The number of points must be a multiple of 4. */
+	template <typename FuncType>
+	static FORCEINLINE void ForEachPoint4(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF, FuncType&& Func)
+	{
+		check(OutSDF.Num() % 4 == 0 && X.Num() >= OutSDF.Num() && Y.Num() >= OutSDF.Num());
+		for (int32 Idx = 0; Idx < OutSDF.Num(); Idx += 4)
+		{
+			VectorStore(Func(VectorLoad(&X[Idx]), VectorLoad(&Y[Idx])), &OutSDF[Idx]);
+		}
+	}
+
+	static FORCEINLINE VectorRegister4Float Length(const VectorRegister4Float& X, const VectorRegister4Float& Y)
+	{
+		return VectorSqrt(VectorMultiplyAdd(X, X, VectorMultiply(Y, Y)));
+	}
+
+	static FORCEINLINE VectorRegister4Float Saturate(const VectorRegister4Float& V)
+	{
+		return VectorMin(VectorMax(V, VectorZeroFloat()), VectorOneFloat());
+	}
+
+	static FORCEINLINE VectorRegister4Float Clamp(const VectorRegister4Float& V, const VectorRegister4Float& Min, const VectorRegister4Float& Max)
+	{
+		return VectorMin(VectorMax(V, Min), Max);
+	}
+
+	static FORCEINLINE VectorRegister4Float Lerp(const VectorRegister4Float& A, const VectorRegister4Float& B, const VectorRegister4Float& T)
+	{
+		return VectorMultiplyAdd(VectorSubtract(B, A), T, A);
+	}
+
+	static FORCEINLINE VectorRegister4Float Frac(const VectorRegister4Float& V)
+	{
+		return VectorSubtract(V, VectorFloor(V));
+	}
+
+	/** Return -1, 0, or 1 for each value, matching HLSL sign. */
+	static FORCEINLINE VectorRegister4Float Sign(const VectorRegister4Float& V)
+	{
+		const VectorRegister4Float Positive = VectorSelect(VectorCompareGT(V, VectorZeroFloat()), VectorOneFloat(), VectorZeroFloat());
+		const VectorRegister4Float Negative = VectorSelect(VectorCompareLT(V, VectorZeroFloat()), VectorOneFloat(), VectorZeroFloat());
+		return VectorSubtract(Positive, Negative);
+	}
+
+	static FORCEINLINE VectorRegister4Float SmoothStep(float Edge0, float Edge1, const VectorRegister4Float& V)
+	{
+		// avoid dividing by zero when the filter width is zero, which makes this a step function
+		const float InvRange = 1.f / FMath::Max(Edge1 - Edge0, UE_SMALL_NUMBER);
+		const VectorRegister4Float T = Saturate(VectorMultiply(VectorSubtract(V, VectorSetFloat1(Edge0)), VectorSetFloat1(InvRange)));
+		return VectorMultiply(VectorMultiply(T, T), VectorSubtract(VectorSetFloat1(3.f), VectorAdd(T, T)));
+	}
+
+	/** Return the distance to a line segment. */
+	static FORCEINLINE VectorRegister4Float Segment(const VectorRegister4Float& X, const VectorRegister4Float& Y, FVector2f PointA, FVector2f PointB)
+	{
+		const FVector2f BA = PointB - PointA;
+		const VectorRegister4Float PAX = VectorSubtract(X, VectorSetFloat1(PointA.X));
+		const VectorRegister4Float PAY = VectorSubtract(Y, VectorSetFloat1(PointA.Y));
+		const VectorRegister4Float BAX = VectorSetFloat1(BA.X);
+		const VectorRegister4Float BAY = VectorSetFloat1(BA.Y);
+		const VectorRegister4Float InvBALengthSq = VectorSetFloat1(1.f / FMath::Max(BA.Dot(BA), 1e-5f));
+		const VectorRegister4Float H = Saturate(VectorMultiply(VectorMultiplyAdd(PAX, BAX, VectorMultiply(PAY, BAY)), InvBALengthSq));
+		return Length(VectorNegateMultiplyAdd(BAX, H, PAX), VectorNegateMultiplyAdd(BAY, H, PAY));
+	}
+
+
+	// Visual
+	// ------
+
+	/** Return the coverage of a solid fill from an SDF shape. */
+	static FORCEINLINE VectorRegister4Float Fill(const VectorRegister4Float& SDF, float FilterWidth, bool bEnableFilterBias)
+	{
+		const float HalfWidth = FilterWidth * 0.5f;
+		const VectorRegister4Float BiasedSDF = bEnableFilterBias ? VectorSubtract(SDF, VectorSetFloat1(HalfWidth)) : SDF;
+		return VectorSubtract(VectorOneFloat(), SmoothStep(-HalfWidth, HalfWidth, BiasedSDF));
+	}
+
+	/** Return the coverage of a stroke centered on the edge of an SDF shape. */
+	static FORCEINLINE VectorRegister4Float Stroke(const VectorRegister4Float& SDF, float StrokeWidth, float FilterWidth)
+	{
+		return Fill(VectorSubtract(VectorAbs(SDF), VectorSetFloat1(StrokeWidth * 0.5f)), FilterWidth, true);
+	}
+
+	/** Multiply coverage by a color, returning premultiplied RGBA. */
+	static FORCEINLINE FMGFXVectorRGBA Tint(const VectorRegister4Float& Coverage, const FLinearColor& Color)
+	{
+		const VectorRegister4Float Alpha = VectorMultiply(Coverage, VectorSetFloat1(Color.A));
+		return {
+			VectorMultiply(Alpha, VectorSetFloat1(Color.R)),
+			VectorMultiply(Alpha, VectorSetFloat1(Color.G)),
+			VectorMultiply(Alpha, VectorSetFloat1(Color.B)),
+			Alpha
+		};
+	}
+
+	/** Divide RGB by A to convert from premultiplied color to straight color. */
+	static FORCEINLINE FMGFXVectorRGBA Unpremult(const FMGFXVectorRGBA& RGBA)
+	{
+		const VectorRegister4Float InvAlpha = VectorReciprocalAccurate(VectorMax(RGBA.A, VectorSetFloat1(1e-5f)));
+		return {VectorMultiply(RGBA.R, InvAlpha), VectorMultiply(RGBA.G, InvAlpha), VectorMultiply(RGBA.B, InvAlpha), RGBA.A};
+	}
+
+
+	// Shape Merge
+	// -----------
+
+	/** Return the polynomial smooth minimum of two distances, blending over a distance of K. */
+	static FORCEINLINE VectorRegister4Float SmoothMin(const VectorRegister4Float& A, const VectorRegister4Float& B, float K)
+	{
+		const VectorRegister4Float VK = VectorSetFloat1(K);
+		const VectorRegister4Float H = Saturate(VectorMultiplyAdd(VectorSubtract(B, A), VectorSetFloat1(0.5f / K), VectorSetFloat1(0.5f)));
+		return VectorSubtract(Lerp(B, A, H), VectorMultiply(VectorMultiply(VK, H), VectorSubtract(VectorOneFloat(), H)));
+	}
+
+	/** Merge two SDF shapes, where A is the shape below B. Returns B if the shapes aren't merged. */
+	static FORCEINLINE VectorRegister4Float MergeShapes(const VectorRegister4Float& A, const VectorRegister4Float& B,
+	                                                    EMGFXShapeMergeOperation Operation, float Smoothness)
+	{
+		const bool bSmooth = Smoothness > 0.f;
+		switch (Operation)
+		{
+		case EMGFXShapeMergeOperation::Union:
+			return bSmooth ? SmoothMin(A, B, Smoothness) : VectorMin(A, B);
+		case EMGFXShapeMergeOperation::Subtraction:
+			return bSmooth ? VectorNegate(SmoothMin(VectorNegate(A), B, Smoothness)) : VectorMax(A, VectorNegate(B));
+		case EMGFXShapeMergeOperation::Intersection:
+			return bSmooth ? VectorNegate(SmoothMin(VectorNegate(A), VectorNegate(B), Smoothness)) : VectorMax(A, B);
+		default:
+			return B;
+		}
+	}
+
+
+	// Merge
+	// -----
+
+	/** Merge two premultiplied colors, where A is the layer on top of B. */
+	static FORCEINLINE FMGFXVectorRGBA Merge(const FMGFXVectorRGBA& A, const FMGFXVectorRGBA& B, EMGFXLayerMergeOperation Operation)
+	{
+		switch (Operation)
+		{
+		case EMGFXLayerMergeOperation::Over:
+			{
+				const VectorRegister4Float InvAlpha = VectorSubtract(VectorOneFloat(), A.A);
+				return {
+					VectorMultiplyAdd(B.R, InvAlpha, A.R), VectorMultiplyAdd(B.G, InvAlpha, A.G),
+					VectorMultiplyAdd(B.B, InvAlpha, A.B), VectorMultiplyAdd(B.A, InvAlpha, A.A)
+				};
+			}
+		case EMGFXLayerMergeOperation::Add:
+			return {VectorAdd(A.R, B.R), VectorAdd(A.G, B.G), VectorAdd(A.B, B.B), VectorAdd(A.A, B.A)};
+		case EMGFXLayerMergeOperation::Subtract:
+			return {
+				VectorMax(VectorSubtract(B.R, A.R), VectorZeroFloat()), VectorMax(VectorSubtract(B.G, A.G), VectorZeroFloat()),
+				VectorMax(VectorSubtract(B.B, A.B), VectorZeroFloat()), VectorMax(VectorSubtract(B.A, A.A), VectorZeroFloat())
+			};
+		case EMGFXLayerMergeOperation::Multiply:
+			return {VectorMultiply(A.R, B.R), VectorMultiply(A.G, B.G), VectorMultiply(A.B, B.B), VectorMultiply(A.A, B.A)};
+		case EMGFXLayerMergeOperation::In:
+			return Scale(A, B.A);
+		case EMGFXLayerMergeOperation::Out:
+			return Scale(A, VectorSubtract(VectorOneFloat(), B.A));
+		case EMGFXLayerMergeOperation::Mask:
+			return Scale(B, A.A);
+		case EMGFXLayerMergeOperation::Stencil:
+			return Scale(B, VectorSubtract(VectorOneFloat(), A.A));
+		default:
+			// no valid merge function
+			return A;
+		}
+	}
+
+	static FORCEINLINE FMGFXVectorRGBA Scale(const FMGFXVectorRGBA& RGBA, const VectorRegister4Float& Factor)
+	{
+		return {VectorMultiply(RGBA.R, Factor), VectorMultiply(RGBA.G, Factor), VectorMultiply(RGBA.B, Factor), VectorMultiply(RGBA.A, Factor)};
+	}
+};
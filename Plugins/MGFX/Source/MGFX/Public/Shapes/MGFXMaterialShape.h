@@ -67,10 +67,24 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Shape|Editor")
 	FString ShapeName;
 
-	/** The operation to use when merging this shape with the one below. */
+	/**
+	 * The operation to use when merging this shape with the one below.
+	 * Merged shapes are combined as a single SDF, and only the visuals of the topmost merged shape are used.
+	 */
 	UPROPERTY(EditAnywhere, Category = "Shape")
 	EMGFXShapeMergeOperation ShapeMergeOperation;
 
+	/** The distance over which to smoothly blend this shape with the one below. A value of 0 merges without blending. */
+	UPROPERTY(EditAnywhere, Category = "Shape", Meta = (ClampMin = "0", EditCondition = "ShapeMergeOperation != EMGFXShapeMergeOperation::None"))
+	float ShapeMergeSmoothness = 0.f;
+
+	/**
+	 * The inputs to expose as material parameters, so they can be animated.
+	 * All other inputs are baked into the material as constants, unless the material is fully animatable.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Shape", Meta = (GetOptions = "GetInputNames"))
+	TArray<FString> ExposedInputs;
+
 	UPROPERTY(EditAnywhere, Instanced, Category = "Fill / Stroke")
 	TArray<TObjectPtr<UMGFXMaterialShapeVisual>> Visuals;
 
@@ -87,9 +101,34 @@ public:
 	/** Return the material function to use. */
 	virtual UMaterialFunctionInterface* GetMaterialFunction() const;
 
+	/** Return the name of the HLSL function to use when generating HLSL, or empty if not supported. */
+	virtual FString GetHLSLFunctionName() const { return HLSLFunctionName; }
+
+	/** Return the shader file that defines the HLSL function, or empty if it's defined in the builtin shapes file. */
+	virtual FString GetHLSLIncludeFilePath() const { return HLSLIncludeFilePath; }
+
 	/** Add the default visual for this shape. */
 	virtual void AddDefaultVisual();
 
+	/** Return true if an input should be exposed as a material parameter. */
+	bool IsInputExposed(const FString& InputName) const { return ExposedInputs.Contains(InputName); }
+
+	/**
+	 * Return the builtin shape type of this shape, and its inputs in the same order as its HLSL function.
+	 * Builtin shapes can be evaluated on the CPU and by the interpreted material.
+	 */
+	virtual EMGFXShapeType GetShapeType(FVector4f& OutInputs) const { return EMGFXShapeType::None; }
+
+	/** Return true if the SDF of this shape can be evaluated on the CPU. */
+	virtual bool CanEvaluateSDF() const;
+
+	/**
+	 * Evaluate the SDF of this shape at a batch of points in local space, mirroring its HLSL function.
+	 * The number of points must be a multiple of 4, so that they can be evaluated using SIMD. Must be thread safe.
+	 * Evaluates the builtin shape type by default.
+	 */
+	virtual void EvaluateSDF(TConstArrayView<float> X, TConstArrayView<float> Y, TArrayView<float> OutSDF) const;
+
 #if WITH_EDITOR
 	// TODO: move to SMGFXMaterialShape widgets defined for each shape...
 	/** Return true if the shape has finite bounds. */
@@ -104,6 +143,10 @@ public:
 	UFUNCTION(BlueprintNativeEvent, DisplayName = "GetInputs")
 	TArray<FMGFXMaterialShapeInput> GetInputs_BP() const;
 
+	/** Return the names of all inputs, used as options for ExposedInputs. */
+	UFUNCTION()
+	TArray<FString> GetInputNames() const;
+
 	virtual EDataValidationResult IsDataValid(FDataValidationContext& Context) const override;
 #endif
 
@@ -111,4 +154,15 @@ protected:
 	/** The material function of this shape. */
 	UPROPERTY(EditDefaultsOnly, Category = "Shape|Editor")
 	TSoftObjectPtr<UMaterialFunctionInterface> MaterialFunction;
+
+	/**
+	 * The HLSL function of this shape, used instead of the material function when generating HLSL.
+	 * Must accept the uvs followed by all inputs in order, and return the SDF.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category = "Shape|Editor")
+	FString HLSLFunctionName;
+
+	/** The virtual shader path of the file that defines the HLSL function, if not defined in the builtin shapes file. */
+	UPROPERTY(EditDefaultsOnly, Category = "Shape|Editor")
+	FString HLSLIncludeFilePath;
 };
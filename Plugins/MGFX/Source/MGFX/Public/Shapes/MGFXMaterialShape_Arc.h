@@ -29,6 +29,8 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Arc", Meta = (ClampMin = 0, ClampMax = 1))
 	float Sweep = 0.75f;
 
+	virtual EMGFXShapeType GetShapeType(FVector4f& OutInputs) const override;
+
 #if WITH_EDITOR
 	virtual bool HasBounds() const override { return true; }
 	virtual FBox2D GetBounds() const override;
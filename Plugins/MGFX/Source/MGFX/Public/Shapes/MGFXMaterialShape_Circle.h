@@ -22,6 +22,8 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Circle")
 	float Size = 100.f;
 
+	virtual EMGFXShapeType GetShapeType(FVector4f& OutInputs) const override;
+
 #if WITH_EDITOR
 	virtual bool HasBounds() const override { return true; }
 	virtual FBox2D GetBounds() const override;
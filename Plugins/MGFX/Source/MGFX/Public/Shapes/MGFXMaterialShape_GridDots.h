@@ -26,6 +26,8 @@ public:
 	UPROPERTY(EditAnywhere, Category = "GridDots")
 	float Size = 2.f;
 
+	virtual EMGFXShapeType GetShapeType(FVector4f& OutInputs) const override;
+
 #if WITH_EDITOR
 	virtual TArray<FMGFXMaterialShapeInput> GetInputs() const override;
 #endif
@@ -24,6 +24,8 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Line")
 	FVector2f PointB = FVector2f(100.f, 100.f);
 
+	virtual EMGFXShapeType GetShapeType(FVector4f& OutInputs) const override;
+
 #if WITH_EDITOR
 	virtual bool HasBounds() const override { return true; }
 	virtual FBox2D GetBounds() const override;
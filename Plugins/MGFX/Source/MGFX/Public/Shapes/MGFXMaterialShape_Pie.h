@@ -29,6 +29,8 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Pie")
 	float CornerRadius = 0.f;
 
+	virtual EMGFXShapeType GetShapeType(FVector4f& OutInputs) const override;
+
 #if WITH_EDITOR
 	virtual bool HasBounds() const override { return true; }
 	virtual FBox2D GetBounds() const override;
@@ -21,7 +21,10 @@ public class MGFXEditor : ModuleRules
 		PrivateDependencyModuleNames.AddRange(new string[]
 		{
 			"CoreUObject",
+			"DesktopPlatform",
 			"Engine",
+			"Json",
+			"JsonUtilities",
 			"RenderCore",
 			"Slate",
 			"SlateCore",
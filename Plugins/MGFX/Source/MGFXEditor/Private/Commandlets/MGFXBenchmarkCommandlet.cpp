@@ -0,0 +1,256 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "Commandlets/MGFXBenchmarkCommandlet.h"
+
+#include "JsonObjectConverter.h"
+#include "MGFXEditorModule.h"
+#include "MGFXMaterial.h"
+#include "MGFXMaterialGenerator.h"
+#include "MaterialShared.h"
+#include "MGFXPackedLayers.h"
+#include "ShaderCompiler.h"
+#include "Materials/Material.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Shapes/MGFXMaterialShape.h"
+#include "Shapes/MGFXMaterialShape_Rect.h"
+#include "UObject/UObjectIterator.h"
+
+
+// FMGFXBenchmarkReport
+// --------------------
+
+FString FMGFXBenchmarkReport::ToJson() const
+{
+	FString Result;
+	FJsonObjectConverter::UStructToJsonObjectString(*this, Result);
+	return Result;
+}
+
+
+// UMGFXBenchmarkCommandlet
+// ------------------------
+
+UMGFXBenchmarkCommandlet::UMGFXBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UMGFXBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString SizesStr = TEXT("10,100,1000");
+	FString ScenariosStr = TEXT("Flat,Nested,AllShapes,MixedMerge");
+	FString BackendsStr = TEXT("Graph,HLSL");
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("MGFX") / TEXT("Benchmark.json");
+	FParse::Value(*Params, TEXT("Sizes="), SizesStr);
+	FParse::Value(*Params, TEXT("Scenarios="), ScenariosStr);
+	FParse::Value(*Params, TEXT("Backends="), BackendsStr);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	const bool bCompile = !FParse::Param(*Params, TEXT("NoCompile"));
+
+	TArray<FString> Sizes;
+	TArray<FString> Scenarios;
+	TArray<FString> Backends;
+	SizesStr.ParseIntoArray(Sizes, TEXT(","));
+	ScenariosStr.ParseIntoArray(Scenarios, TEXT(","));
+	BackendsStr.ParseIntoArray(Backends, TEXT(","));
+
+	FMGFXBenchmarkReport Report;
+	Report.EngineVersion = FEngineVersion::Current().ToString();
+	Report.Timestamp = FDateTime::UtcNow().ToIso8601();
+
+	// materials are notified separately, so that generating doesn't include any compile work
+	FMGFXMaterialGenerator Generator;
+	Generator.bNotifyMaterialWhenFinished = false;
+
+	for (const FString& BackendName : Backends)
+	{
+		const int64 BackendValue = StaticEnum<EMGFXMaterialGeneratorBackend>()->GetValueByNameString(BackendName);
+		if (BackendValue == INDEX_NONE)
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("Unknown generator backend: %s"), *BackendName);
+			return 1;
+		}
+		const EMGFXMaterialGeneratorBackend Backend = static_cast<EMGFXMaterialGeneratorBackend>(BackendValue);
+
+		for (const FString& Scenario : Scenarios)
+		{
+			for (const FString& Size : Sizes)
+			{
+				const int32 NumLayers = FCString::Atoi(*Size);
+
+				UMGFXMaterial* MGFXMaterial = CreateScenarioMaterial(Scenario, NumLayers, Backend);
+				if (!MGFXMaterial)
+				{
+					UE_LOG(LogMGFXEditor, Error, TEXT("Unknown benchmark scenario: %s"), *Scenario);
+					return 1;
+				}
+
+				FMGFXBenchmarkResult& Result = Report.Results.Add_GetRef(RunBenchmark(Generator, MGFXMaterial, bCompile));
+				Result.Scenario = Scenario;
+				Result.Backend = BackendName;
+
+				UE_LOG(LogMGFXEditor, Display, TEXT("%s %s %d layers (depth %d): %d expressions, %.2fms generate (%.2fms creating expressions), "
+					       "%.2fms regenerate, %.2fms translate, %.2fms compile"),
+				       *BackendName, *Scenario, Result.NumLayers, Result.MaxDepth, Result.NumExpressions,
+				       Result.GenerateMs, Result.CreateExpressionsMs, Result.RegenerateMs, Result.TranslateMs, Result.CompileMs);
+
+				// don't keep the generated expressions of every material around
+				Generator.ClearGeneratedCache();
+				CollectGarbage(RF_NoFlags);
+			}
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(Report.ToJson(), *OutputPath))
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("Failed to write benchmark results to %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("Wrote benchmark results to %s"), *OutputPath);
+	return 0;
+}
+
+UMGFXMaterial* UMGFXBenchmarkCommandlet::CreateScenarioMaterial(const FString& Scenario, int32 NumLayers, EMGFXMaterialGeneratorBackend Backend)
+{
+	const bool bFlat = Scenario == TEXT("Flat");
+	const bool bNested = Scenario == TEXT("Nested");
+	const bool bAllShapes = Scenario == TEXT("AllShapes");
+	const bool bMixedMerge = Scenario == TEXT("MixedMerge");
+	if (!bFlat && !bNested && !bAllShapes && !bMixedMerge)
+	{
+		return nullptr;
+	}
+
+	UMGFXMaterial* MGFXMaterial = NewObject<UMGFXMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+	MGFXMaterial->GeneratorBackend = Backend;
+
+	// find every concrete shape type
+	TArray<UClass*> ShapeClasses;
+	if (bAllShapes)
+	{
+		for (TObjectIterator<UClass> It; It; ++It)
+		{
+			if (It->IsChildOf(UMGFXMaterialShape::StaticClass()) &&
+				!It->HasAnyClassFlags(CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists))
+			{
+				ShapeClasses.Add(*It);
+			}
+		}
+		ShapeClasses.Sort([](const UClass& A, const UClass& B) { return A.GetName() < B.GetName(); });
+	}
+
+	const UEnum* MergeEnum = StaticEnum<EMGFXLayerMergeOperation>();
+	const int32 NumMergeOperations = MergeEnum->NumEnums() - 1;
+	const int32 NumShapeMergeOperations = StaticEnum<EMGFXShapeMergeOperation>()->NumEnums() - 1;
+	const int32 MaxNestedDepth = GetMaxNestedDepth(Backend);
+
+	IMGFXMaterialLayerParentInterface* Container = MGFXMaterial;
+	for (int32 Idx = 0; Idx < NumLayers; ++Idx)
+	{
+		// nested layers are only split into separate chains where the backend can't nest them any deeper
+		if (bNested && Idx % MaxNestedDepth == 0)
+		{
+			Container = MGFXMaterial;
+		}
+
+		UClass* ShapeClass = bAllShapes && !ShapeClasses.IsEmpty()
+			                     ? ShapeClasses[Idx % ShapeClasses.Num()]
+			                     : UMGFXMaterialShape_Rect::StaticClass();
+
+		UMGFXMaterialLayer* Layer = NewObject<UMGFXMaterialLayer>(MGFXMaterial, NAME_None, RF_Transient);
+		Layer->Name = FString::Printf(TEXT("Layer%d"), Idx);
+		Layer->Transform.Location = FVector2f(Idx % 16, Idx / 16 % 16) * 16.f;
+		Layer->Shape = NewObject<UMGFXMaterialShape>(Layer, ShapeClass, NAME_None, RF_Transient);
+		Layer->Shape->AddDefaultVisual();
+
+		if (bMixedMerge)
+		{
+			Layer->MergeOperation = static_cast<EMGFXLayerMergeOperation>(MergeEnum->GetValueByIndex(Idx % NumMergeOperations));
+			Layer->Shape->ShapeMergeOperation = static_cast<EMGFXShapeMergeOperation>(Idx % NumShapeMergeOperations);
+			Layer->Shape->ShapeMergeSmoothness = Idx % 2 == 0 ? 4.f : 0.f;
+		}
+
+		Container->AddLayer(Layer);
+
+		if (bNested)
+		{
+			Container = Layer;
+		}
+	}
+
+	return MGFXMaterial;
+}
+
+FMGFXBenchmarkResult UMGFXBenchmarkCommandlet::RunBenchmark(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, bool bCompile)
+{
+	FMGFXBenchmarkResult Result;
+
+	TArray<UMGFXMaterialLayer*> AllLayers;
+	MGFXMaterial->GetAllLayers(AllLayers);
+	Result.NumLayers = AllLayers.Num();
+
+	for (const UMGFXMaterialLayer* Layer : AllLayers)
+	{
+		int32 Depth = 1;
+		for (const UMGFXMaterialLayer* Parent = Layer->GetParentLayer(); Parent; Parent = Parent->GetParentLayer())
+		{
+			++Depth;
+		}
+		Result.MaxDepth = FMath::Max(Result.MaxDepth, Depth);
+	}
+
+	// the generator doesn't notify the material when finished, so it isn't compiled until timed separately
+	UMaterial* Material = NewObject<UMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+
+	double StartTime = FPlatformTime::Seconds();
+	Generator.Generate(MGFXMaterial, Material, false, false);
+	Result.GenerateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	Result.CreateExpressionsMs = Generator.LastCreateExpressionsMs;
+	Result.NumExpressions = Material->GetExpressionCollection().Expressions.Num();
+
+	StartTime = FPlatformTime::Seconds();
+	Generator.Generate(MGFXMaterial, Material, false, false);
+	Result.RegenerateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	if (bCompile)
+	{
+		// notifying the material caches its shader maps, which submits compile jobs that run asynchronously
+		StartTime = FPlatformTime::Seconds();
+		Material->PostEditChange();
+		if (GShaderCompilingManager)
+		{
+			GShaderCompilingManager->FinishAllCompilation();
+		}
+		Result.CompileMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		// translate explicitly, since caching shader maps skips translating when they're found in the ddc
+		if (FMaterialResource* MaterialResource = Material->GetMaterialResource(GMaxRHIFeatureLevel))
+		{
+			FString Source;
+			StartTime = FPlatformTime::Seconds();
+			MaterialResource->GetMaterialExpressionSource(Source);
+			Result.TranslateMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		}
+	}
+
+	return Result;
+}
+
+int32 UMGFXBenchmarkCommandlet::GetMaxNestedDepth(EMGFXMaterialGeneratorBackend Backend)
+{
+	if (Backend == EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		// deeper layers are skipped when packing, excluding the root
+		return FMGFXPackedLayers::MaxDepth - 1;
+	}
+
+	// the graph and hlsl generators recurse once per level of nesting, so thousands of levels would overflow the stack
+	return MaxRecursiveNestedDepth;
+}
@@ -0,0 +1,255 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "Commandlets/MGFXRegenerateMaterialsCommandlet.h"
+
+#include "MGFXEditorModule.h"
+#include "MGFXMaterial.h"
+#include "MGFXMaterialEditorUtils.h"
+#include "MGFXMaterialGenerator.h"
+#include "ShaderCompiler.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/Texture2D.h"
+#include "HAL/FileManager.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "Misc/PackageName.h"
+#include "UObject/SavePackage.h"
+
+
+UMGFXRegenerateMaterialsCommandlet::UMGFXRegenerateMaterialsCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UMGFXRegenerateMaterialsCommandlet::Main(const FString& Params)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FString Path;
+	FParse::Value(*Params, TEXT("Path="), Path);
+	const bool bForce = FParse::Param(*Params, TEXT("Force"));
+	const bool bDryRun = FParse::Param(*Params, TEXT("DryRun"));
+	const bool bSave = !FParse::Param(*Params, TEXT("NoSave"));
+
+	// find all mgfx materials
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UMGFXMaterial::StaticClass()->GetClassPathName());
+	Filter.bRecursiveClasses = true;
+	if (!Path.IsEmpty())
+	{
+		Filter.PackagePaths.Add(FName(Path));
+		Filter.bRecursivePaths = true;
+	}
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("Found %d MGFX materials."), Assets.Num());
+
+	FMGFXMaterialGenerator Generator;
+	TArray<UMaterial*> RegeneratedMaterials;
+	TArray<UObject*> UpdatedAssets;
+	int32 NumUpToDate = 0;
+	int32 NumSkipped = 0;
+	int32 NumFailed = 0;
+	int32 NumExpressions = 0;
+
+	// regenerate all out of date materials
+	const double GenerateStartTime = FPlatformTime::Seconds();
+	for (const FAssetData& AssetData : Assets)
+	{
+		UMGFXMaterial* MGFXMaterial = Cast<UMGFXMaterial>(AssetData.GetAsset());
+		if (!MGFXMaterial)
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("Failed to load %s"), *AssetData.GetObjectPathString());
+			++NumFailed;
+			continue;
+		}
+
+		UMaterial* Material = MGFXMaterial->Material;
+		if (!Material)
+		{
+			// target materials are created by the editor, so the user can choose where they go
+			UE_LOG(LogMGFXEditor, Warning, TEXT("%s has no target material, open and apply it in the editor to create one."), *GetNameSafe(MGFXMaterial));
+			++NumSkipped;
+			continue;
+		}
+
+		if (!MGFXMaterial->UsesSharedMaterial() && FMGFXMaterialGenerator::IsSharedMaterial(Material))
+		{
+			// regenerating would replace a material used by other mgfx materials with this material's values
+			UE_LOG(LogMGFXEditor, Warning, TEXT("%s no longer uses a shared material, apply it in the editor to create its own material."),
+			       *GetNameSafe(MGFXMaterial));
+			++NumSkipped;
+			continue;
+		}
+
+		if (RegeneratedMaterials.Contains(Material))
+		{
+			// a shared material that was already regenerated for another mgfx material, only the instance needs updating
+			UpdateMaterialInstance(Generator, MGFXMaterial, Material, UpdatedAssets);
+			++NumUpToDate;
+			continue;
+		}
+
+		if (!bForce && FMGFXMaterialGenerator::IsMaterialUpToDate(MGFXMaterial, Material, false))
+		{
+			UE_LOG(LogMGFXEditor, Verbose, TEXT("%s is up to date."), *GetNameSafe(Material));
+			++NumUpToDate;
+			continue;
+		}
+
+		// when only the generator version changed, shared materials are regenerated in place
+		if (MGFXMaterial->UsesSharedMaterial() && !FMGFXMaterialGenerator::HasSameContent(MGFXMaterial, Material, false))
+		{
+			// regenerating would change the structure of a material used by other mgfx materials
+			UE_LOG(LogMGFXEditor, Warning, TEXT("%s has changed structure since %s was generated, apply it in the editor to switch shared materials."),
+			       *GetNameSafe(MGFXMaterial), *GetNameSafe(Material));
+			++NumSkipped;
+			continue;
+		}
+
+		if (bDryRun)
+		{
+			UE_LOG(LogMGFXEditor, Display, TEXT("%s is out of date."), *GetNameSafe(Material));
+			continue;
+		}
+
+		// the interpreted material references the layer data texture, which is out of date along with it
+		if (MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted)
+		{
+			UpdatePackedLayersTexture(MGFXMaterial, UpdatedAssets);
+		}
+
+		// don't wait for the compile, so that all materials compile in parallel
+		Material->Modify();
+		Generator.Generate(MGFXMaterial, Material, false, false);
+		RegeneratedMaterials.Add(Material);
+
+		const int32 NumMaterialExpressions = Material->GetExpressionCollection().Expressions.Num();
+		NumExpressions += NumMaterialExpressions;
+
+		UE_LOG(LogMGFXEditor, Display, TEXT("Regenerated %s (%d expressions)"), *GetNameSafe(Material), NumMaterialExpressions);
+
+		if (MGFXMaterial->UsesSharedMaterial())
+		{
+			UpdateMaterialInstance(Generator, MGFXMaterial, Material, UpdatedAssets);
+		}
+	}
+	const double GenerateTime = FPlatformTime::Seconds() - GenerateStartTime;
+
+	// the generated expressions aren't needed anymore
+	Generator.ClearGeneratedCache();
+
+	// each generate has already submitted its shader compile, wait for them all to finish
+	const double CompileStartTime = FPlatformTime::Seconds();
+	if (GShaderCompilingManager)
+	{
+		GShaderCompilingManager->FinishAllCompilation();
+	}
+	const double CompileTime = FPlatformTime::Seconds() - CompileStartTime;
+
+	const double SaveStartTime = FPlatformTime::Seconds();
+	if (bSave)
+	{
+		for (UMaterial* Material : RegeneratedMaterials)
+		{
+			if (!SaveAssetPackage(Material))
+			{
+				++NumFailed;
+			}
+		}
+		for (UObject* Asset : UpdatedAssets)
+		{
+			if (!SaveAssetPackage(Asset))
+			{
+				++NumFailed;
+			}
+		}
+	}
+	const double SaveTime = FPlatformTime::Seconds() - SaveStartTime;
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("MGFX materials: %d regenerated, %d up to date, %d skipped, %d failed, %d other assets updated."),
+	       RegeneratedMaterials.Num(), NumUpToDate, NumSkipped, NumFailed, UpdatedAssets.Num());
+	UE_LOG(LogMGFXEditor, Display, TEXT("Expressions: %d total, %.1f average."),
+	       NumExpressions, RegeneratedMaterials.Num() > 0 ? static_cast<float>(NumExpressions) / RegeneratedMaterials.Num() : 0.f);
+	UE_LOG(LogMGFXEditor, Display, TEXT("Time: %.2fs generate, %.2fs compile, %.2fs save, %.2fs total."),
+	       GenerateTime, CompileTime, SaveTime, FPlatformTime::Seconds() - StartTime);
+
+	return NumFailed > 0 ? 1 : 0;
+}
+
+void UMGFXRegenerateMaterialsCommandlet::UpdateMaterialInstance(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, UMaterial* SharedMaterial,
+                                                                TArray<UObject*>& UpdatedAssets)
+{
+	const bool bHadMaterialInstance = MGFXMaterial->MaterialInstance != nullptr;
+
+	UMaterialInstanceConstant* MaterialInstance = FMGFXMaterialEditorUtils::UpdateMaterialInstance(Generator, MGFXMaterial, SharedMaterial);
+	if (!MaterialInstance)
+	{
+		return;
+	}
+
+	UpdatedAssets.AddUnique(MaterialInstance);
+
+	// the mgfx material references the instance that was just created
+	if (!bHadMaterialInstance)
+	{
+		UpdatedAssets.AddUnique(MGFXMaterial);
+	}
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("Updated %s"), *GetNameSafe(MaterialInstance));
+}
+
+void UMGFXRegenerateMaterialsCommandlet::UpdatePackedLayersTexture(UMGFXMaterial* MGFXMaterial, TArray<UObject*>& UpdatedAssets)
+{
+	const bool bHadPackedLayersTexture = MGFXMaterial->PackedLayersTexture != nullptr;
+
+	UTexture2D* Texture = FMGFXMaterialEditorUtils::UpdatePackedLayersTexture(MGFXMaterial);
+	if (!Texture)
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("Failed to update the layer data texture of %s"), *GetNameSafe(MGFXMaterial));
+		return;
+	}
+
+	UpdatedAssets.AddUnique(Texture);
+
+	// the mgfx material references the texture that was just created
+	if (!bHadPackedLayersTexture)
+	{
+		UpdatedAssets.AddUnique(MGFXMaterial);
+	}
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("Updated %s"), *GetNameSafe(Texture));
+}
+
+bool UMGFXRegenerateMaterialsCommandlet::SaveAssetPackage(UObject* Asset)
+{
+	UPackage* Package = Asset->GetPackage();
+	const FString Filename = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+
+	if (IFileManager::Get().IsReadOnly(*Filename))
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("Failed to save %s, the file is read only."), *Filename);
+		return false;
+	}
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.Error = GWarn;
+	if (!UPackage::SavePackage(Package, nullptr, *Filename, SaveArgs))
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("Failed to save %s"), *Filename);
+		return false;
+	}
+
+	return true;
+}
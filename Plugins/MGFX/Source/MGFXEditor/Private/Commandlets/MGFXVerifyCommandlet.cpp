@@ -0,0 +1,473 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "Commandlets/MGFXVerifyCommandlet.h"
+
+#include "Editor.h"
+#include "MaterialDomain.h"
+#include "MGFXEditorModule.h"
+#include "MGFXMaterial.h"
+#include "MGFXMaterialEvaluator.h"
+#include "MGFXMaterialGenerator.h"
+#include "MGFXPackedLayers.h"
+#include "ShaderCompiler.h"
+#include "TextureResource.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Kismet/KismetRenderingLibrary.h"
+#include "Materials/Material.h"
+#include "Misc/App.h"
+#include "Shapes/MGFXMaterialShape.h"
+#include "Shapes/MGFXMaterialShape_Arc.h"
+#include "Shapes/MGFXMaterialShape_Circle.h"
+#include "Shapes/MGFXMaterialShape_Cross.h"
+#include "Shapes/MGFXMaterialShape_GridDots.h"
+#include "Shapes/MGFXMaterialShape_Line.h"
+#include "Shapes/MGFXMaterialShape_Pie.h"
+#include "Shapes/MGFXMaterialShape_Rect.h"
+#include "Shapes/MGFXMaterialShape_Triangle.h"
+#include "Shapes/MGFXMaterialShapeVisual.h"
+
+
+UMGFXVerifyCommandlet::UMGFXVerifyCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UMGFXVerifyCommandlet::Main(const FString& Params)
+{
+	FString Path;
+	FString BackendsStr = TEXT("Graph,HLSL,Interpreted");
+	FParse::Value(*Params, TEXT("Path="), Path);
+	FParse::Value(*Params, TEXT("Backends="), BackendsStr);
+	FParse::Value(*Params, TEXT("MaxSize="), MaxSize);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	bRender = !FParse::Param(*Params, TEXT("NoRender"));
+	const bool bShapes = FParse::Param(*Params, TEXT("Shapes"));
+
+	if (bRender && !FApp::CanEverRender())
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("Rendering MGFX materials requires a renderer, use -NoRender to run without one."));
+		return 1;
+	}
+
+	TArray<FString> BackendNames;
+	BackendsStr.ParseIntoArray(BackendNames, TEXT(","));
+
+	Backends.Reset();
+	for (const FString& BackendName : BackendNames)
+	{
+		const int64 BackendValue = StaticEnum<EMGFXMaterialGeneratorBackend>()->GetValueByNameString(BackendName);
+		if (BackendValue == INDEX_NONE)
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("Unknown generator backend: %s"), *BackendName);
+			return 1;
+		}
+		Backends.Add(static_cast<EMGFXMaterialGeneratorBackend>(BackendValue));
+	}
+
+	FMGFXMaterialGenerator Generator;
+	int32 NumPassed = 0;
+	int32 NumFailed = 0;
+	int32 NumSkipped = 0;
+
+	const auto CountResult = [&](EResult Result)
+	{
+		switch (Result)
+		{
+		case EResult::Passed:
+			++NumPassed;
+			break;
+		case EResult::Failed:
+			++NumFailed;
+			break;
+		case EResult::Skipped:
+			++NumSkipped;
+			break;
+		}
+
+		// don't keep the generated expressions and render targets of every material around
+		Generator.ClearGeneratedCache();
+		CollectGarbage(RF_NoFlags);
+	};
+
+	if (bShapes)
+	{
+		// the graph backend uses the shape material functions and the hlsl backend uses MGFXShapes.ush,
+		// so comparing them checks that both use the same conventions for every builtin shape
+		const TArray<TStrongObjectPtr<UMGFXMaterial>> ShapeMaterials = CreateShapeMaterials();
+		UE_LOG(LogMGFXEditor, Display, TEXT("Created %d builtin shape materials."), ShapeMaterials.Num());
+
+		for (const TStrongObjectPtr<UMGFXMaterial>& ShapeMaterial : ShapeMaterials)
+		{
+			CountResult(VerifyMaterial(Generator, ShapeMaterial.Get()));
+		}
+	}
+	else
+	{
+		// find all mgfx materials
+		IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		AssetRegistry.SearchAllAssets(true);
+
+		FARFilter Filter;
+		Filter.ClassPaths.Add(UMGFXMaterial::StaticClass()->GetClassPathName());
+		Filter.bRecursiveClasses = true;
+		if (!Path.IsEmpty())
+		{
+			Filter.PackagePaths.Add(FName(Path));
+			Filter.bRecursivePaths = true;
+		}
+
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+
+		UE_LOG(LogMGFXEditor, Display, TEXT("Found %d MGFX materials."), Assets.Num());
+
+		for (const FAssetData& AssetData : Assets)
+		{
+			const UMGFXMaterial* MGFXMaterial = Cast<UMGFXMaterial>(AssetData.GetAsset());
+			if (!MGFXMaterial)
+			{
+				UE_LOG(LogMGFXEditor, Error, TEXT("Failed to load %s"), *AssetData.GetObjectPathString());
+				++NumFailed;
+				continue;
+			}
+
+			CountResult(VerifyMaterial(Generator, MGFXMaterial));
+		}
+	}
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("MGFX materials: %d passed, %d failed, %d skipped."), NumPassed, NumFailed, NumSkipped);
+
+	return NumFailed > 0 ? 1 : 0;
+}
+
+UMGFXVerifyCommandlet::EResult UMGFXVerifyCommandlet::VerifyMaterial(FMGFXMaterialGenerator& Generator, const UMGFXMaterial* MGFXMaterial) const
+{
+	const FString Name = GetNameSafe(MGFXMaterial);
+	const FIntPoint Size = GetImageSize(MGFXMaterial);
+
+	const FMGFXMaterialEvaluator Evaluator(MGFXMaterial);
+	if (!Evaluator.CanEvaluateAllShapes())
+	{
+		// shapes without an sdf are skipped by the evaluator, but not by the generated material
+		UE_LOG(LogMGFXEditor, Display, TEXT("%s has shapes that can't be evaluated on the CPU, skipping."), *Name);
+		return EResult::Skipped;
+	}
+
+	TArray<FVector2f> Points;
+	float PixelSize = 1.f;
+	GetPixelCenters(MGFXMaterial->BaseCanvasSize, Size, Points, PixelSize);
+
+	TArray<FLinearColor> EvaluatedColors;
+	EvaluatedColors.SetNumUninitialized(Points.Num());
+	Evaluator.Evaluate(Points, PixelSize, EvaluatedColors);
+	Premultiply(EvaluatedColors);
+
+	bool bPassed = true;
+
+	// packed layers are interpreted the same way on the CPU and by the interpreted backend
+	FMGFXPackedLayers PackedLayers;
+	FMGFXLayerPacker::Pack(MGFXMaterial, PackedLayers);
+	if (!PackedLayers.bIsComplete)
+	{
+		UE_LOG(LogMGFXEditor, Display, TEXT("%s has layers that can't be interpreted, skipping the interpreter."), *Name);
+	}
+	else if (FMGFXPackedLayersInterpreter::CanInterpret(PackedLayers))
+	{
+		TArray<FLinearColor> InterpretedColors;
+		InterpretedColors.SetNumUninitialized(Points.Num());
+		FMGFXPackedLayersInterpreter::Evaluate(PackedLayers, Points, PixelSize, InterpretedColors);
+		Premultiply(InterpretedColors);
+
+		const FImageDiff Diff = Compare(InterpretedColors, EvaluatedColors, Size);
+		bPassed &= LogDiff(Name, TEXT("interpreter vs evaluator"), Diff, Size);
+	}
+
+	// the first backend rendered, that every other backend is also compared against directly
+	FString FirstBackendName;
+	TArray<FLinearColor> FirstRenderedColors;
+
+	for (const EMGFXMaterialGeneratorBackend Backend : Backends)
+	{
+		if (!bRender || (Backend == EMGFXMaterialGeneratorBackend::Interpreted && !PackedLayers.bIsComplete))
+		{
+			continue;
+		}
+
+		const FString BackendName = StaticEnum<EMGFXMaterialGeneratorBackend>()->GetNameStringByValue(static_cast<int64>(Backend));
+
+		UMGFXMaterial* RenderableMaterial = CreateRenderableMaterial(MGFXMaterial, Backend, PackedLayers);
+		TArray<FLinearColor> RenderedColors;
+		if (!RenderPixels(Generator, RenderableMaterial, Size, RenderedColors))
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("Failed to render %s using the %s backend."), *Name, *BackendName);
+			bPassed = false;
+			continue;
+		}
+
+		const FImageDiff Diff = Compare(RenderedColors, EvaluatedColors, Size);
+		bPassed &= LogDiff(Name, FString::Printf(TEXT("%s backend vs evaluator"), *BackendName), Diff, Size);
+
+		if (FirstRenderedColors.IsEmpty())
+		{
+			FirstBackendName = BackendName;
+			FirstRenderedColors = MoveTemp(RenderedColors);
+		}
+		else
+		{
+			const FImageDiff BackendDiff = Compare(RenderedColors, FirstRenderedColors, Size);
+			bPassed &= LogDiff(Name, FString::Printf(TEXT("%s backend vs %s backend"), *BackendName, *FirstBackendName), BackendDiff, Size);
+		}
+	}
+
+	return bPassed ? EResult::Passed : EResult::Failed;
+}
+
+TArray<TStrongObjectPtr<UMGFXMaterial>> UMGFXVerifyCommandlet::CreateShapeMaterials()
+{
+	TArray<TStrongObjectPtr<UMGFXMaterial>> ShapeMaterials;
+
+	// large enough for every shape and its stroke, centered on the canvas
+	const FVector2f CanvasSize(160.f, 160.f);
+
+	const auto AddShapeMaterial = [&ShapeMaterials, &CanvasSize](const FString& Name, UClass* ShapeClass, TFunctionRef<void(UMGFXMaterialShape*)> InitShape)
+	{
+		UMGFXMaterial* MGFXMaterial = NewObject<UMGFXMaterial>(GetTransientPackage(), FName(TEXT("MGFX_") + Name), RF_Transient);
+		MGFXMaterial->BaseCanvasSize = CanvasSize;
+
+		UMGFXMaterialLayer* Layer = NewObject<UMGFXMaterialLayer>(MGFXMaterial, NAME_None, RF_Transient);
+		Layer->Name = Name;
+		Layer->Transform.Location = CanvasSize * 0.5f;
+		Layer->Shape = NewObject<UMGFXMaterialShape>(Layer, ShapeClass, NAME_None, RF_Transient);
+		InitShape(Layer->Shape);
+
+		// a wide stroke over a translucent fill checks the distances around each edge, not just which side of it pixels are on
+		UMGFXMaterialShapeFill* Fill = NewObject<UMGFXMaterialShapeFill>(Layer->Shape, NAME_None, RF_Transient);
+		Fill->Color = FLinearColor(1.f, 0.5f, 0.f, 0.5f);
+		Layer->Shape->Visuals.Add(Fill);
+
+		UMGFXMaterialShapeStroke* Stroke = NewObject<UMGFXMaterialShapeStroke>(Layer->Shape, NAME_None, RF_Transient);
+		Stroke->Color = FLinearColor(0.f, 0.5f, 1.f, 0.75f);
+		Stroke->StrokeWidth = 12.f;
+		Layer->Shape->Visuals.Add(Stroke);
+
+		MGFXMaterial->AddLayer(Layer);
+		ShapeMaterials.Emplace(MGFXMaterial);
+	};
+
+	AddShapeMaterial(TEXT("Circle"), UMGFXMaterialShape_Circle::StaticClass(), [](UMGFXMaterialShape*) {});
+	AddShapeMaterial(TEXT("Cross"), UMGFXMaterialShape_Cross::StaticClass(), [](UMGFXMaterialShape*) {});
+	AddShapeMaterial(TEXT("GridDots"), UMGFXMaterialShape_GridDots::StaticClass(), [](UMGFXMaterialShape* Shape)
+	{
+		UMGFXMaterialShape_GridDots* GridDots = CastChecked<UMGFXMaterialShape_GridDots>(Shape);
+		GridDots->Spacing = FVector2f(24.f, 16.f);
+		GridDots->Size = 6.f;
+	});
+	AddShapeMaterial(TEXT("Line"), UMGFXMaterialShape_Line::StaticClass(), [](UMGFXMaterialShape* Shape)
+	{
+		UMGFXMaterialShape_Line* Line = CastChecked<UMGFXMaterialShape_Line>(Shape);
+		Line->PointA = FVector2f(-40.f, -30.f);
+		Line->PointB = FVector2f(45.f, 20.f);
+	});
+
+	for (const float CornerRadius : {0.f, 16.f})
+	{
+		const FString Suffix = FString::Printf(TEXT("_Corner%d"), FMath::RoundToInt(CornerRadius));
+
+		AddShapeMaterial(TEXT("Rect") + Suffix, UMGFXMaterialShape_Rect::StaticClass(), [CornerRadius](UMGFXMaterialShape* Shape)
+		{
+			UMGFXMaterialShape_Rect* Rect = CastChecked<UMGFXMaterialShape_Rect>(Shape);
+			Rect->Size = FVector2f(100.f, 60.f);
+			Rect->CornerRadius = CornerRadius;
+		});
+		AddShapeMaterial(TEXT("Triangle") + Suffix, UMGFXMaterialShape_Triangle::StaticClass(), [CornerRadius](UMGFXMaterialShape* Shape)
+		{
+			UMGFXMaterialShape_Triangle* Triangle = CastChecked<UMGFXMaterialShape_Triangle>(Shape);
+			Triangle->CornerRadius = CornerRadius;
+		});
+	}
+
+	// the sweep and orientation of arcs and pies are the easiest to get wrong, so cover the whole range
+	for (const float Sweep : {0.1f, 0.25f, 0.5f, 0.75f, 0.9f, 1.f})
+	{
+		const FString Suffix = FString::Printf(TEXT("_Sweep%d"), FMath::RoundToInt(Sweep * 100.f));
+
+		AddShapeMaterial(TEXT("Arc") + Suffix, UMGFXMaterialShape_Arc::StaticClass(), [Sweep](UMGFXMaterialShape* Shape)
+		{
+			UMGFXMaterialShape_Arc* Arc = CastChecked<UMGFXMaterialShape_Arc>(Shape);
+			Arc->Width = 16.f;
+			Arc->Sweep = Sweep;
+		});
+
+		for (const float CornerRadius : {0.f, 8.f})
+		{
+			AddShapeMaterial(FString::Printf(TEXT("Pie%s_Corner%d"), *Suffix, FMath::RoundToInt(CornerRadius)), UMGFXMaterialShape_Pie::StaticClass(),
+			                 [Sweep, CornerRadius](UMGFXMaterialShape* Shape)
+			                 {
+				                 UMGFXMaterialShape_Pie* Pie = CastChecked<UMGFXMaterialShape_Pie>(Shape);
+				                 Pie->Sweep = Sweep;
+				                 Pie->CornerRadius = CornerRadius;
+			                 });
+		}
+	}
+
+	return ShapeMaterials;
+}
+
+FIntPoint UMGFXVerifyCommandlet::GetImageSize(const UMGFXMaterial* MGFXMaterial) const
+{
+	const FVector2f CanvasSize = MGFXMaterial->BaseCanvasSize;
+	const float Scale = FMath::Min(1.f, MaxSize / FMath::Max3(CanvasSize.X, CanvasSize.Y, 1.f));
+	return FIntPoint(FMath::Max(FMath::CeilToInt(CanvasSize.X * Scale), 1), FMath::Max(FMath::CeilToInt(CanvasSize.Y * Scale), 1));
+}
+
+UMGFXMaterial* UMGFXVerifyCommandlet::CreateRenderableMaterial(const UMGFXMaterial* MGFXMaterial, EMGFXMaterialGeneratorBackend Backend,
+                                                               const FMGFXPackedLayers& PackedLayers)
+{
+	UMGFXMaterial* RenderableMaterial = DuplicateObject<UMGFXMaterial>(MGFXMaterial, GetTransientPackage());
+	RenderableMaterial->SetFlags(RF_Transient);
+	RenderableMaterial->GeneratorBackend = Backend;
+	RenderableMaterial->bUseSharedMaterial = false;
+	RenderableMaterial->Material = nullptr;
+	RenderableMaterial->MaterialInstance = nullptr;
+
+	// the interpreted material uses the layer data texture as its default, which may not exist or be up to date
+	if (Backend == EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		RenderableMaterial->PackedLayersTexture = FMGFXLayerPacker::CreateTransientTexture(PackedLayers);
+	}
+
+	// canvas tiles can't draw ui materials, so render a translucent surface material instead
+	RenderableMaterial->MaterialDomain = MD_Surface;
+	RenderableMaterial->BlendMode = BLEND_Translucent;
+	RenderableMaterial->OutputProperty = MP_EmissiveColor;
+
+	// the evaluator doesn't animate, so render the static values
+	TArray<UMGFXMaterialLayer*> AllLayers;
+	RenderableMaterial->GetAllLayers(AllLayers);
+	for (UMGFXMaterialLayer* Layer : AllLayers)
+	{
+		Layer->Animations.Reset();
+	}
+
+	return RenderableMaterial;
+}
+
+void UMGFXVerifyCommandlet::GetPixelCenters(const FVector2f& CanvasSize, FIntPoint Size, TArray<FVector2f>& OutPoints, float& OutPixelSize)
+{
+	// sample the center of each pixel, like FMGFXMaterialBaker
+	const FVector2f PixelScale = CanvasSize / FVector2f(Size);
+	OutPixelSize = FMath::Max(PixelScale.X, PixelScale.Y);
+
+	OutPoints.SetNumUninitialized(Size.X * Size.Y);
+	for (int32 Y = 0; Y < Size.Y; ++Y)
+	{
+		for (int32 X = 0; X < Size.X; ++X)
+		{
+			OutPoints[Y * Size.X + X] = FVector2f(X + 0.5f, Y + 0.5f) * PixelScale;
+		}
+	}
+}
+
+void UMGFXVerifyCommandlet::Premultiply(TArrayView<FLinearColor> Colors)
+{
+	for (FLinearColor& Color : Colors)
+	{
+		Color = FLinearColor(Color.R * Color.A, Color.G * Color.A, Color.B * Color.A, Color.A);
+	}
+}
+
+bool UMGFXVerifyCommandlet::RenderPixels(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, FIntPoint Size, TArray<FLinearColor>& OutColors)
+{
+	UWorld* World = GEditor ? GEditor->GetEditorWorldContext().World() : nullptr;
+	if (!World)
+	{
+		return false;
+	}
+
+	UMaterial* Material = NewObject<UMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+	Material->SetShadingModel(MSM_Unlit);
+	Generator.Generate(MGFXMaterial, Material, true, false);
+	if (GShaderCompilingManager)
+	{
+		GShaderCompilingManager->FinishAllCompilation();
+	}
+
+	UTextureRenderTarget2D* RenderTarget = UKismetRenderingLibrary::CreateRenderTarget2D(World, Size.X, Size.Y, RTF_RGBA32f);
+	if (!RenderTarget)
+	{
+		return false;
+	}
+
+	// the alpha channel of translucent canvas tiles isn't reliable, so render over black and white,
+	// and recover the premultiplied color and opacity from the difference
+	TArray<FLinearColor> BlackColors;
+	TArray<FLinearColor> WhiteColors;
+	const FReadSurfaceDataFlags ReadFlags(RCM_MinMax);
+
+	UKismetRenderingLibrary::ClearRenderTarget2D(World, RenderTarget, FLinearColor::Black);
+	UKismetRenderingLibrary::DrawMaterialToRenderTarget(World, RenderTarget, Material);
+	RenderTarget->GameThread_GetRenderTargetResource()->ReadLinearColorPixels(BlackColors, ReadFlags);
+
+	UKismetRenderingLibrary::ClearRenderTarget2D(World, RenderTarget, FLinearColor::White);
+	UKismetRenderingLibrary::DrawMaterialToRenderTarget(World, RenderTarget, Material);
+	RenderTarget->GameThread_GetRenderTargetResource()->ReadLinearColorPixels(WhiteColors, ReadFlags);
+
+	if (BlackColors.Num() != Size.X * Size.Y || WhiteColors.Num() != BlackColors.Num())
+	{
+		return false;
+	}
+
+	OutColors.SetNumUninitialized(BlackColors.Num());
+	for (int32 Idx = 0; Idx < BlackColors.Num(); ++Idx)
+	{
+		const FLinearColor& Black = BlackColors[Idx];
+		const FLinearColor& White = WhiteColors[Idx];
+		const float Alpha = 1.f - ((White.R - Black.R) + (White.G - Black.G) + (White.B - Black.B)) / 3.f;
+		OutColors[Idx] = FLinearColor(Black.R, Black.G, Black.B, Alpha);
+	}
+
+	return true;
+}
+
+UMGFXVerifyCommandlet::FImageDiff UMGFXVerifyCommandlet::Compare(TConstArrayView<FLinearColor> ColorsA, TConstArrayView<FLinearColor> ColorsB,
+                                                                 FIntPoint Size) const
+{
+	check(ColorsA.Num() == ColorsB.Num());
+
+	FImageDiff Diff;
+	for (int32 Idx = 0; Idx < ColorsA.Num(); ++Idx)
+	{
+		const FLinearColor Delta = ColorsA[Idx] - ColorsB[Idx];
+		const float Error = FMath::Max(FMath::Max(FMath::Abs(Delta.R), FMath::Abs(Delta.G)), FMath::Max(FMath::Abs(Delta.B), FMath::Abs(Delta.A)));
+		if (Error > Tolerance)
+		{
+			++Diff.NumMismatched;
+		}
+		if (Error > Diff.MaxError)
+		{
+			Diff.MaxError = Error;
+			Diff.MaxErrorPixel = FIntPoint(Idx % Size.X, Idx / Size.X);
+		}
+	}
+
+	return Diff;
+}
+
+bool UMGFXVerifyCommandlet::LogDiff(const FString& Name, const FString& Description, const FImageDiff& Diff, FIntPoint Size) const
+{
+	if (Diff.NumMismatched > 0)
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("%s %s: %d of %d pixels differ by more than %.4f, max error %.4f at (%d, %d)."),
+		       *Name, *Description, Diff.NumMismatched, Size.X * Size.Y, Tolerance, Diff.MaxError, Diff.MaxErrorPixel.X, Diff.MaxErrorPixel.Y);
+		return false;
+	}
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("%s %s: max error %.4f."), *Name, *Description, Diff.MaxError);
+	return true;
+}
@@ -17,6 +17,106 @@
 #include "UObject/PropertyAccessUtil.h"
 
 
+EPropertyAccessChangeNotifyMode MGFXPropertyAccess::NotifyMode = EPropertyAccessChangeNotifyMode::Default;
+
+
+// FMGFXMaterialExpressionPool
+// ---------------------------
+
+UMaterialExpression* FMGFXMaterialExpressionPool::Take(const UMaterial* Material, const UClass* ExpressionClass)
+{
+	TMap<const UClass*, TArray<TObjectPtr<UMaterialExpression>>>* MaterialPool = Expressions.Find(Material);
+	if (!MaterialPool)
+	{
+		return nullptr;
+	}
+
+	TArray<TObjectPtr<UMaterialExpression>>* ClassPool = MaterialPool->Find(ExpressionClass);
+	if (!ClassPool || ClassPool->IsEmpty())
+	{
+		return nullptr;
+	}
+
+	return ClassPool->Pop();
+}
+
+void FMGFXMaterialExpressionPool::Release(const UMaterial* Material, UMaterialExpression* Expression)
+{
+	if (Material && Expression)
+	{
+		Expressions.FindOrAdd(Material).FindOrAdd(Expression->GetClass()).Add(Expression);
+	}
+}
+
+void FMGFXMaterialExpressionPool::RemoveUsedExpressions(const UMaterial* Material)
+{
+	TMap<const UClass*, TArray<TObjectPtr<UMaterialExpression>>>* MaterialPool = Expressions.Find(Material);
+	if (!MaterialPool)
+	{
+		return;
+	}
+
+	const FMaterialExpressionCollection& ExpressionCollection = Material->GetExpressionCollection();
+	TSet<const UMaterialExpression*> UsedExpressions;
+	for (const TObjectPtr<UMaterialExpression>& Expression : ExpressionCollection.Expressions)
+	{
+		UsedExpressions.Add(Expression);
+	}
+	for (const TObjectPtr<UMaterialExpressionComment>& CommentExp : ExpressionCollection.EditorComments)
+	{
+		UsedExpressions.Add(CommentExp);
+	}
+
+	for (auto& Elem : *MaterialPool)
+	{
+		Elem.Value.RemoveAll([&UsedExpressions](const TObjectPtr<UMaterialExpression>& Expression)
+		{
+			return UsedExpressions.Contains(Expression);
+		});
+	}
+}
+
+int32 FMGFXMaterialExpressionPool::Num(const UMaterial* Material) const
+{
+	int32 Result = 0;
+	if (const TMap<const UClass*, TArray<TObjectPtr<UMaterialExpression>>>* MaterialPool = Expressions.Find(Material))
+	{
+		for (const auto& Elem : *MaterialPool)
+		{
+			Result += Elem.Value.Num();
+		}
+	}
+	return Result;
+}
+
+void FMGFXMaterialExpressionPool::Reset()
+{
+	Expressions.Reset();
+}
+
+void FMGFXMaterialExpressionPool::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	// expressions of materials that no longer exist don't need to be kept
+	for (auto It = Expressions.CreateIterator(); It; ++It)
+	{
+		if (!It->Key.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		for (auto& Elem : It->Value)
+		{
+			Collector.AddReferencedObjects(Elem.Value);
+		}
+	}
+}
+
+
+// FMGFXMaterialBuilder
+// --------------------
+
+
 FMGFXMaterialBuilder::FMGFXMaterialBuilder()
 {
 }
@@ -49,34 +149,101 @@ void FMGFXMaterialBuilder::SetMaterial(UMaterial* InMaterial, bool bInBlockPostE
 		Material->bIsPreviewMaterial = true;
 		Material->PreEditChange(nullptr);
 	}
+
+	// expressions may have been restored by an undo since they were pooled
+	ExpressionPool.RemoveUsedExpressions(Material);
+
+	RebuildNameIndex();
 }
 
-void FMGFXMaterialBuilder::Reset()
+void FMGFXMaterialBuilder::Reset(bool bNotifyMaterial)
 {
 	if (Material && bBlockPostEditChange)
 	{
 		Material->bIsPreviewMaterial = bWasPreviewMaterial;
-		Material->PostEditChange();
+		if (bNotifyMaterial)
+		{
+			Material->PostEditChange();
+		}
 	}
 
 	Material = nullptr;
 	bWasPreviewMaterial = false;
+	RecordedExpressions = nullptr;
+	NamedReroutes.Reset();
+	NamedParameters.Reset();
 }
 
 UMaterialExpression* FMGFXMaterialBuilder::Create(TSubclassOf<UMaterialExpression> ExpressionClass, const FVector2D& NodePos) const
 {
-	UMaterialExpression* NewExp = UMaterialEditingLibrary::CreateMaterialExpression(Material, ExpressionClass, NodePos.X, NodePos.Y);
+	UMaterialExpression* NewExp = nullptr;
 
-	// UMaterialEditingLibrary doesn't add comments to the correct collection, fix it
-	if (UMaterialExpressionComment* CommentExp = Cast<UMaterialExpressionComment>(NewExp))
+	// materials open in the material editor also need a graph node for each expression, so only recycle for other materials
+	if (!Material->MaterialGraph)
 	{
-		Material->GetExpressionCollection().RemoveExpression(CommentExp);
-		Material->GetExpressionCollection().AddComment(CommentExp);
+		if (UMaterialExpression* PooledExp = ExpressionPool.Take(Material, ExpressionClass))
+		{
+			NewExp = RecycleExpression(PooledExp, NodePos);
+		}
+	}
+
+	if (!NewExp)
+	{
+		NewExp = UMaterialEditingLibrary::CreateMaterialExpression(Material, ExpressionClass, NodePos.X, NodePos.Y);
+
+		// UMaterialEditingLibrary doesn't add comments to the correct collection, fix it
+		if (UMaterialExpressionComment* CommentExp = Cast<UMaterialExpressionComment>(NewExp))
+		{
+			Material->GetExpressionCollection().RemoveExpression(CommentExp);
+			Material->GetExpressionCollection().AddComment(CommentExp);
+		}
+	}
+
+	if (RecordedExpressions && NewExp)
+	{
+		RecordedExpressions->Add(NewExp);
 	}
 
 	return NewExp;
 }
 
+UMaterialExpression* FMGFXMaterialBuilder::RecycleExpression(UMaterialExpression* Expression, const FVector2D& NodePos) const
+{
+	check(Expression);
+
+	// pooled expressions were removed from the material within the same transaction, so record their state for undo
+	Expression->Modify();
+
+	// restore all properties, including inputs, so the expression is identical to a new one
+	const UClass* ExpressionClass = Expression->GetClass();
+	const UObject* DefaultExp = ExpressionClass->GetDefaultObject();
+	for (TFieldIterator<FProperty> It(ExpressionClass); It; ++It)
+	{
+		It->CopyCompleteValue_InContainer(Expression, DefaultExp);
+	}
+
+	// match UMaterialEditingLibrary::CreateMaterialExpression
+	Expression->Material = Material;
+	Expression->MaterialExpressionEditorX = NodePos.X;
+	Expression->MaterialExpressionEditorY = NodePos.Y;
+	Expression->UpdateMaterialExpressionGuid(true, true);
+	if (Expression->HasAParameterName())
+	{
+		Expression->UpdateParameterGuid(true, true);
+	}
+
+	if (UMaterialExpressionComment* CommentExp = Cast<UMaterialExpressionComment>(Expression))
+	{
+		Material->GetExpressionCollection().AddComment(CommentExp);
+	}
+	else
+	{
+		Material->GetExpressionCollection().AddExpression(Expression);
+	}
+
+	return Expression;
+}
+
 UMaterialExpressionComponentMask* FMGFXMaterialBuilder::CreateComponentMask(const FVector2D& NodePos, uint32 R, uint32 G, uint32 B, uint32 A) const
 {
 	UMaterialExpressionComponentMask* ComponentMaskExp = Create<UMaterialExpressionComponentMask>(NodePos);
@@ -105,6 +272,28 @@ UMaterialExpressionAppendVector* FMGFXMaterialBuilder::CreateAppend(const FVecto
 	return AppendExp;
 }
 
+UMaterialExpressionCustom* FMGFXMaterialBuilder::CreateCustom(const FVector2D& NodePos, const FString& Code, ECustomMaterialOutputType OutputType,
+                                                              const TArray<FName>& InputNames, const FString& Description,
+                                                              const TArray<FString>& IncludeFilePaths) const
+{
+	UMaterialExpressionCustom* CustomExp = Create<UMaterialExpressionCustom>(NodePos);
+	CustomExp->Inputs.Reset();
+	for (const FName& InputName : InputNames)
+	{
+		CustomExp->Inputs.AddDefaulted_GetRef().InputName = InputName;
+	}
+	CustomExp->OutputType = OutputType;
+	CustomExp->Description = Description;
+	CustomExp->IncludeFilePaths = IncludeFilePaths;
+	// set code last, so the expression outputs are rebuilt with all other properties in place.
+	// always notify, even while generating without notifications, since the outputs depend on it
+	{
+		FMGFXScopedPropertyNotifyMode NotifyModeScope(EPropertyAccessChangeNotifyMode::Default);
+		SET_PROP(CustomExp, Code, Code);
+	}
+	return CustomExp;
+}
+
 UMaterialExpressionScalarParameter* FMGFXMaterialBuilder::CreateScalarParam(const FVector2D& NodePos, FName ParameterName, FName Group,
                                                                             int32 SortPriority) const
 {
@@ -117,6 +306,13 @@ UMaterialExpressionNamedRerouteDeclaration* FMGFXMaterialBuilder::CreateNamedRer
 {
 	UMaterialExpressionNamedRerouteDeclaration* RerouteExp = Create<UMaterialExpressionNamedRerouteDeclaration>(NodePos);
 	SET_PROP(RerouteExp, Name, Name);
+
+	// keep the first reroute with each name that still exists, to match RebuildNameIndex
+	TWeakObjectPtr<UMaterialExpressionNamedRerouteDeclaration>& IndexedExp = NamedReroutes.FindOrAdd(Name);
+	if (!IndexedExp.IsValid())
+	{
+		IndexedExp = RerouteExp;
+	}
 	return RerouteExp;
 }
 
@@ -150,30 +346,44 @@ UMaterialExpressionNamedRerouteUsage* FMGFXMaterialBuilder::CreateNamedRerouteUs
 
 UMaterialExpressionNamedRerouteDeclaration* FMGFXMaterialBuilder::FindNamedReroute(const FName Name) const
 {
-	for (TObjectPtr<UMaterialExpression> Expression : Material->GetExpressionCollection().Expressions)
-	{
-		UMaterialExpressionNamedRerouteDeclaration* Declaration = Cast<UMaterialExpressionNamedRerouteDeclaration>(Expression);
-		if (Declaration && Declaration->Name.IsEqual(Name))
-		{
-			return Declaration;
-		}
-	}
-	return nullptr;
+	const TWeakObjectPtr<UMaterialExpressionNamedRerouteDeclaration>* Declaration = NamedReroutes.Find(Name);
+	return Declaration ? Declaration->Get() : nullptr;
 }
 
 UMaterialExpressionParameter* FMGFXMaterialBuilder::FindNamedParameter(const FName ParameterName) const
 {
-	for (TObjectPtr<UMaterialExpression> Expression : Material->GetExpressions())
+	const TWeakObjectPtr<UMaterialExpressionParameter>* ParamExp = NamedParameters.Find(ParameterName);
+	return ParamExp ? ParamExp->Get() : nullptr;
+}
+
+void FMGFXMaterialBuilder::RebuildNameIndex()
+{
+	NamedReroutes.Reset();
+	NamedParameters.Reset();
+
+	if (!Material)
+	{
+		return;
+	}
+
+	// keep the first expression with each name, to match a linear search
+	for (const TObjectPtr<UMaterialExpression>& Expression : Material->GetExpressionCollection().Expressions)
 	{
-		if (UMaterialExpressionParameter* ParamExp = Cast<UMaterialExpressionParameter>(Expression))
+		if (UMaterialExpressionNamedRerouteDeclaration* Declaration = Cast<UMaterialExpressionNamedRerouteDeclaration>(Expression))
 		{
-			if (ParamExp->GetParameterName().IsEqual(ParameterName))
+			if (!NamedReroutes.Contains(Declaration->Name))
 			{
-				return ParamExp;
+				NamedReroutes.Add(Declaration->Name, Declaration);
+			}
+		}
+		else if (UMaterialExpressionParameter* ParamExp = Cast<UMaterialExpressionParameter>(Expression))
+		{
+			if (!NamedParameters.Contains(ParamExp->GetParameterName()))
+			{
+				NamedParameters.Add(ParamExp->GetParameterName(), ParamExp);
 			}
 		}
 	}
-	return nullptr;
 }
 
 UMaterialExpressionComment* FMGFXMaterialBuilder::CreateComment(const FVector2D& NodePos, const FString& Text, FLinearColor Color) const
@@ -192,6 +402,8 @@ UMaterialExpressionMaterialFunctionCall* FMGFXMaterialBuilder::CreateFunction(co
 	UMaterialExpressionMaterialFunctionCall* FunctionExp = Create<UMaterialExpressionMaterialFunctionCall>(NodePos);
 	if (Function)
 	{
+		// always notify, even when fast building, so the function inputs and outputs are created
+		FMGFXScopedPropertyNotifyMode NotifyModeScope(EPropertyAccessChangeNotifyMode::Default);
 		SET_PROP(FunctionExp, MaterialFunction, Function);
 	}
 	return FunctionExp;
@@ -247,6 +459,13 @@ void FMGFXMaterialBuilder::ConfigureParameter(UMaterialExpressionParameter* Para
 	SET_PROP(ParameterExp, ParameterName, ParameterName);
 	SET_PROP(ParameterExp, Group, Group);
 	SET_PROP(ParameterExp, SortPriority, SortPriority);
+
+	// keep the first parameter with each name that still exists, to match RebuildNameIndex
+	TWeakObjectPtr<UMaterialExpressionParameter>& IndexedExp = NamedParameters.FindOrAdd(ParameterName);
+	if (!IndexedExp.IsValid())
+	{
+		IndexedExp = ParameterExp;
+	}
 }
 
 void FMGFXMaterialBuilder::RecompileMaterial()
@@ -255,6 +474,16 @@ void FMGFXMaterialBuilder::RecompileMaterial()
 }
 
 void FMGFXMaterialBuilder::DeleteAll()
+{
+	DeleteAllExcept(TSet<UMaterialExpression*>());
+}
+
+void FMGFXMaterialBuilder::ClearExpressionPool()
+{
+	ExpressionPool.Reset();
+}
+
+void FMGFXMaterialBuilder::DeleteAllExcept(const TSet<UMaterialExpression*>& KeepExpressions)
 {
 	UMaterialEditorOnlyData* MaterialEditorOnly = Material->GetEditorOnlyData();
 
@@ -271,5 +500,184 @@ void FMGFXMaterialBuilder::DeleteAll()
 	MaterialEditorOnly->ClearCoatRoughness.Expression = nullptr;
 	MaterialEditorOnly->Normal.Expression = nullptr;
 
-	Material->GetExpressionCollection().Empty();
+	FMaterialExpressionCollection& ExpressionCollection = Material->GetExpressionCollection();
+
+	for (const TObjectPtr<UMaterialExpressionComment>& CommentExp : ExpressionCollection.EditorComments)
+	{
+		ExpressionPool.Release(Material, CommentExp);
+	}
+
+	if (KeepExpressions.IsEmpty())
+	{
+		for (const TObjectPtr<UMaterialExpression>& Expression : ExpressionCollection.Expressions)
+		{
+			ExpressionPool.Release(Material, Expression);
+		}
+
+		ExpressionCollection.Empty();
+		NamedReroutes.Reset();
+		NamedParameters.Reset();
+		return;
+	}
+
+	ExpressionCollection.Expressions.RemoveAll([this, &KeepExpressions](const TObjectPtr<UMaterialExpression>& Expression)
+	{
+		if (KeepExpressions.Contains(Expression))
+		{
+			return false;
+		}
+		ExpressionPool.Release(Material, Expression);
+		return true;
+	});
+	ExpressionCollection.EditorComments.Empty();
+
+	RebuildNameIndex();
+}
+
+int32 FMGFXMaterialBuilder::EliminateCommonSubexpressions(TMap<UMaterialExpression*, UMaterialExpression*>* OutMergedExpressions)
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialBuilder_EliminateCommonSubexpressions, FColor::Green);
+
+	FMaterialExpressionCollection& ExpressionCollection = Material->GetExpressionCollection();
+
+	// the expression that replaces each expression, which is itself if it's unique
+	TMap<UMaterialExpression*, UMaterialExpression*> Replacements;
+	TMap<FString, UMaterialExpression*> ExpressionsByKey;
+
+	// merge inputs first, so that identical chains of expressions are merged all the way down
+	TFunction<UMaterialExpression*(UMaterialExpression*)> MergeExpression = [&](UMaterialExpression* Expression) -> UMaterialExpression*
+	{
+		if (UMaterialExpression** Replacement = Replacements.Find(Expression))
+		{
+			return *Replacement;
+		}
+
+		// add before visiting inputs in case of cycles
+		Replacements.Add(Expression, Expression);
+
+		for (FExpressionInputIterator It{Expression}; It; ++It)
+		{
+			if (It->Expression)
+			{
+				It->Expression = MergeExpression(It->Expression);
+			}
+		}
+
+		if (!CanEliminateExpression(Expression))
+		{
+			return Expression;
+		}
+
+		const FString Key = GetExpressionKey(Expression);
+		if (UMaterialExpression** ExistingExpression = ExpressionsByKey.Find(Key))
+		{
+			Replacements.Add(Expression, *ExistingExpression);
+			return *ExistingExpression;
+		}
+
+		ExpressionsByKey.Add(Key, Expression);
+		return Expression;
+	};
+
+	// visit in creation order, so the earliest of any identical expressions is kept
+	for (const TObjectPtr<UMaterialExpression>& Expression : ExpressionCollection.Expressions)
+	{
+		MergeExpression(Expression);
+	}
+
+	// redirect material outputs
+	for (int32 PropertyIdx = 0; PropertyIdx < MP_MAX; ++PropertyIdx)
+	{
+		FExpressionInput* Input = Material->GetExpressionInputForProperty(static_cast<EMaterialProperty>(PropertyIdx));
+		if (Input && Input->Expression)
+		{
+			if (UMaterialExpression** Replacement = Replacements.Find(Input->Expression))
+			{
+				Input->Expression = *Replacement;
+			}
+		}
+	}
+
+	const int32 NumRemoved = ExpressionCollection.Expressions.RemoveAll([&](const TObjectPtr<UMaterialExpression>& Expression)
+	{
+		UMaterialExpression* const* Replacement = Replacements.Find(Expression);
+		if (Replacement && *Replacement != Expression)
+		{
+			if (OutMergedExpressions)
+			{
+				OutMergedExpressions->Add(Expression, *Replacement);
+			}
+			ExpressionPool.Release(Material, Expression);
+			return true;
+		}
+		return false;
+	});
+
+	UE_LOG(LogMGFXEditor, Verbose, TEXT("Removed %d duplicate expressions from %s"), NumRemoved, *GetNameSafe(Material));
+
+	// merged parameters may have been removed
+	if (NumRemoved > 0)
+	{
+		RebuildNameIndex();
+	}
+
+	return NumRemoved;
+}
+
+bool FMGFXMaterialBuilder::CanEliminateExpression(const UMaterialExpression* Expression)
+{
+	// declarations are found by name, and comments are only for display
+	return Expression &&
+		!Expression->IsA<UMaterialExpressionNamedRerouteDeclaration>() &&
+		!Expression->IsA<UMaterialExpressionComment>();
+}
+
+FString FMGFXMaterialBuilder::GetExpressionKey(const UMaterialExpression* Expression)
+{
+	check(Expression);
+
+	FString Key = Expression->GetClass()->GetPathName();
+
+	for (TFieldIterator<FProperty> It(Expression->GetClass()); It; ++It)
+	{
+		const FProperty* Property = *It;
+
+		// skip node position, description, and other editor state of the base class,
+		// as well as guids that are unique to each expression
+		if (Property->GetOwnerClass() == UMaterialExpression::StaticClass() || Property->HasAnyPropertyFlags(CPF_Transient))
+		{
+			continue;
+		}
+		const FStructProperty* StructProperty = CastField<FStructProperty>(Property);
+		if (StructProperty && StructProperty->Struct == TBaseStructure<FGuid>::Get())
+		{
+			continue;
+		}
+
+		// inputs are included as the path of each connected expression
+		Key += Property->GetName();
+		Key += TEXT("=");
+		Property->ExportTextItem_InContainer(Key, Expression, nullptr, nullptr, PPF_None);
+		Key += TEXT(";");
+	}
+
+	return Key;
+}
+
+void FMGFXMaterialBuilder::MoveExpression(UMaterialExpression* Expression, const FVector2D& Offset) const
+{
+	check(Expression);
+	Expression->MaterialExpressionEditorX += FMath::RoundToInt(Offset.X);
+	Expression->MaterialExpressionEditorY += FMath::RoundToInt(Offset.Y);
+}
+
+void FMGFXMaterialBuilder::BeginRecording(TArray<TWeakObjectPtr<UMaterialExpression>>& OutExpressions)
+{
+	check(!RecordedExpressions);
+	RecordedExpressions = &OutExpressions;
+}
+
+void FMGFXMaterialBuilder::EndRecording()
+{
+	RecordedExpressions = nullptr;
 }
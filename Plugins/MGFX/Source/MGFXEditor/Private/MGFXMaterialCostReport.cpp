@@ -0,0 +1,117 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "MGFXMaterialCostReport.h"
+
+#include "JsonObjectConverter.h"
+#include "Materials/MaterialExpressionAppendVector.h"
+#include "Materials/MaterialExpressionComment.h"
+#include "Materials/MaterialExpressionComponentMask.h"
+#include "Materials/MaterialExpressionConstant.h"
+#include "Materials/MaterialExpressionConstant2Vector.h"
+#include "Materials/MaterialExpressionConstant3Vector.h"
+#include "Materials/MaterialExpressionConstant4Vector.h"
+#include "Materials/MaterialExpressionCustom.h"
+#include "Materials/MaterialExpressionFunctionInput.h"
+#include "Materials/MaterialExpressionFunctionOutput.h"
+#include "Materials/MaterialExpressionMaterialFunctionCall.h"
+#include "Materials/MaterialExpressionNamedReroute.h"
+#include "Materials/MaterialExpressionParameter.h"
+#include "Materials/MaterialExpressionReroute.h"
+#include "Materials/MaterialExpressionStaticBool.h"
+#include "Materials/MaterialExpressionTextureCoordinate.h"
+#include "Materials/MaterialFunctionInterface.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(MGFXMaterialCostReport)
+
+
+// FMGFXMaterialCost
+// -----------------
+
+void FMGFXMaterialCost::AddExpression(const UMaterialExpression* Expression)
+{
+	if (!Expression || Expression->IsA<UMaterialExpressionComment>())
+	{
+		return;
+	}
+
+	++NumExpressions;
+	NumOperations += GetExpressionOperations(Expression);
+
+	if (Expression->IsA<UMaterialExpressionParameter>())
+	{
+		++NumParameters;
+	}
+	else if (Expression->IsA<UMaterialExpressionMaterialFunctionCall>())
+	{
+		++NumFunctionCalls;
+	}
+	else if (const UMaterialExpressionCustom* CustomExp = Cast<UMaterialExpressionCustom>(Expression))
+	{
+		NumFunctionCalls += CountHLSLFunctionCalls(CustomExp->Code);
+	}
+}
+
+int32 FMGFXMaterialCost::GetExpressionOperations(const UMaterialExpression* Expression)
+{
+	if (const UMaterialExpressionMaterialFunctionCall* FunctionCallExp = Cast<UMaterialExpressionMaterialFunctionCall>(Expression))
+	{
+		// count everything inside the function
+		int32 Result = 0;
+		if (FunctionCallExp->MaterialFunction)
+		{
+			for (const TObjectPtr<UMaterialExpression>& FunctionExpression : FunctionCallExp->MaterialFunction->GetExpressions())
+			{
+				Result += GetExpressionOperations(FunctionExpression);
+			}
+		}
+		return FMath::Max(Result, 1);
+	}
+
+	if (const UMaterialExpressionCustom* CustomExp = Cast<UMaterialExpressionCustom>(Expression))
+	{
+		// generated HLSL is made almost entirely of MGFX function calls
+		return FMath::Max(CountHLSLFunctionCalls(CustomExp->Code), 1);
+	}
+
+	const bool bIsFree = !Expression ||
+		Expression->IsA<UMaterialExpressionParameter>() ||
+		Expression->IsA<UMaterialExpressionConstant>() ||
+		Expression->IsA<UMaterialExpressionConstant2Vector>() ||
+		Expression->IsA<UMaterialExpressionConstant3Vector>() ||
+		Expression->IsA<UMaterialExpressionConstant4Vector>() ||
+		Expression->IsA<UMaterialExpressionStaticBool>() ||
+		Expression->IsA<UMaterialExpressionTextureCoordinate>() ||
+		Expression->IsA<UMaterialExpressionComponentMask>() ||
+		Expression->IsA<UMaterialExpressionAppendVector>() ||
+		Expression->IsA<UMaterialExpressionNamedRerouteBase>() ||
+		Expression->IsA<UMaterialExpressionReroute>() ||
+		Expression->IsA<UMaterialExpressionFunctionInput>() ||
+		Expression->IsA<UMaterialExpressionFunctionOutput>() ||
+		Expression->IsA<UMaterialExpressionComment>();
+
+	return bIsFree ? 0 : 1;
+}
+
+int32 FMGFXMaterialCost::CountHLSLFunctionCalls(const FString& Code)
+{
+	int32 Result = 0;
+	int32 SearchIdx = Code.Find(TEXT("MGFX_"), ESearchCase::CaseSensitive);
+	while (SearchIdx != INDEX_NONE)
+	{
+		++Result;
+		SearchIdx = Code.Find(TEXT("MGFX_"), ESearchCase::CaseSensitive, ESearchDir::FromStart, SearchIdx + 5);
+	}
+	return Result;
+}
+
+
+// FMGFXMaterialCostReport
+// -----------------------
+
+FString FMGFXMaterialCostReport::ToJson() const
+{
+	FString Result;
+	FJsonObjectConverter::UStructToJsonObjectString(*this, Result);
+	return Result;
+}
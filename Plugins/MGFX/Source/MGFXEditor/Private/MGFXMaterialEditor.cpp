@@ -7,20 +7,25 @@
 #include "IMaterialEditor.h"
 #include "MGFXEditorModule.h"
 #include "MGFXMaterial.h"
+#include "MGFXMaterialBaker.h"
 #include "MGFXMaterialEditorCommands.h"
 #include "MGFXMaterialEditorUtils.h"
 #include "MGFXMaterialGenerator.h"
 #include "MGFXMaterialLayer.h"
+#include "MGFXPackedLayers.h"
 #include "ObjectEditorUtils.h"
 #include "PropertyEditorModule.h"
 #include "ScopedTransaction.h"
 #include "SMGFXMaterialEditorCanvas.h"
+#include "SMGFXMaterialEditorCostReport.h"
 #include "SMGFXMaterialEditorLayers.h"
+#include "Engine/Texture2D.h"
 #include "Factories/MaterialFactoryNew.h"
 #include "Framework/Commands/GenericCommands.h"
 #include "HAL/PlatformApplicationMisc.h"
 #include "MaterialEditor/PreviewMaterial.h"
 #include "MaterialGraph/MaterialGraph.h"
+#include "Materials/MaterialInstanceConstant.h"
 #include "Materials/MaterialInstanceDynamic.h"
 #include "Misc/TransactionObjectEvent.h"
 #include "Shapes/MGFXMaterialShape.h"
@@ -39,6 +44,7 @@ constexpr auto NotifyMode = EPropertyAccessChangeNotifyMode::Default;
 const FName FMGFXMaterialEditor::CanvasTabId(TEXT("MGFXMaterialEditorCanvasTab"));
 const FName FMGFXMaterialEditor::LayersTabId(TEXT("MGFXMaterialEditorLayersTab"));
 const FName FMGFXMaterialEditor::DetailsTabId(TEXT("MGFXMaterialEditorDetailsTab"));
+const FName FMGFXMaterialEditor::CostReportTabId(TEXT("MGFXMaterialEditorCostReportTab"));
 
 
 FMGFXMaterialEditor::FMGFXMaterialEditor()
@@ -60,6 +66,7 @@ void FMGFXMaterialEditor::InitMGFXMaterialEditor(const EToolkitMode::Type Mode,
 	CreatePreviewMaterials();
 
 	Generator = MakeShared<FMGFXMaterialGenerator>();
+	UpdateLivePreviewLayers();
 
 	FMGFXMaterialEditorCommands::Register();
 	BindCommands();
@@ -78,7 +85,7 @@ void FMGFXMaterialEditor::InitMGFXMaterialEditor(const EToolkitMode::Type Mode,
 	DetailsView->SetIsCustomRowVisibleDelegate(FIsCustomRowVisible::CreateSP(this, &FMGFXMaterialEditor::IsDetailsRowVisible));
 	DetailsView->SetObject(MGFXMaterial);
 
-	const TSharedRef<FTabManager::FLayout> StandaloneDefaultLayout = FTabManager::NewLayout("Standalone_MGFXMaterialEditor_v0.1")
+	const TSharedRef<FTabManager::FLayout> StandaloneDefaultLayout = FTabManager::NewLayout("Standalone_MGFXMaterialEditor_v0.2")
 		->AddArea(
 			FTabManager::NewPrimaryArea()
 			->SetOrientation(Orient_Vertical)
@@ -103,6 +110,7 @@ void FMGFXMaterialEditor::InitMGFXMaterialEditor(const EToolkitMode::Type Mode,
 					FTabManager::NewStack()
 					->SetSizeCoefficient(0.2f)
 					->AddTab(DetailsTabId, ETabState::OpenedTab)
+					->AddTab(CostReportTabId, ETabState::ClosedTab)
 				)
 			)
 		);
@@ -159,6 +167,11 @@ void FMGFXMaterialEditor::RegisterTabSpawners(const TSharedRef<FTabManager>& InT
 	            .SetDisplayName(LOCTEXT("DetailsTabTitle", "Details"))
 	            .SetGroup(WorkspaceMenuCategoryRef)
 	            .SetIcon(FSlateIcon(FAppStyle::GetAppStyleSetName(), "LevelEditor.Tabs.Details"));
+
+	InTabManager->RegisterTabSpawner(CostReportTabId, FOnSpawnTab::CreateSP(this, &FMGFXMaterialEditor::SpawnTab_CostReport))
+	            .SetDisplayName(LOCTEXT("CostReportTabTitle", "Cost Report"))
+	            .SetGroup(WorkspaceMenuCategoryRef)
+	            .SetIcon(FSlateIcon(FAppStyle::GetAppStyleSetName(), "MaterialEditor.ToggleMaterialStats.Tab"));
 }
 
 UMaterial* FMGFXMaterialEditor::GetTargetMaterial() const
@@ -169,24 +182,53 @@ UMaterial* FMGFXMaterialEditor::GetTargetMaterial() const
 
 void FMGFXMaterialEditor::RegeneratePreviewMaterial()
 {
-	PreviewMaterial->Modify();
-	Generator->Generate(MGFXMaterial, PreviewMaterial, true, true);
-
-	// any interactive parameter changes should be cleared now
-	PreviewMID->ClearParameterValues();
-
 	// TODO: use events to keep this up to date
 	// update canvas artboard
 	CanvasWidget->UpdateArtboardSize();
+
+	// skip regenerating and recompiling if nothing has changed, e.g. when parameter changes are undone
+	if (Generator->IsPreviewMaterialUpToDate(MGFXMaterial, PreviewMaterial))
+	{
+		// discard any in-flight compile, which is now out of date
+		bIsPreviewCompiling = false;
+
+		// any interactive parameter changes should be cleared now, since the preview material matches the current content
+		PreviewMID->ClearParameterValues();
+		UpdatePreviewLayerData();
+		return;
+	}
+
+	if (bIsPreviewCompiling && Generator->IsPreviewMaterialUpToDate(MGFXMaterial, PendingPreviewMaterial))
+	{
+		// already compiling the current content
+		return;
+	}
+
+	// generate into the pending material without blocking, the displayed preview is kept until it's ready.
+	// the builder's PostEditChange starts compiling in the background, cancelling the compile of any previous regenerate.
+	PendingPreviewMaterial->Modify();
+	Generator->Generate(MGFXMaterial, PendingPreviewMaterial, false, true);
+	bIsPreviewCompiling = true;
 }
 
 void FMGFXMaterialEditor::Apply()
 {
 	RegeneratePreviewMaterial();
 	RegenerateTargetMaterial();
+
+	if (MGFXMaterial->UsesSharedMaterial())
+	{
+		UpdateMaterialInstance();
+	}
+
+	// keep an open report up to date
+	if (CostReportWidget.IsValid() && TabManager->FindExistingLiveTab(CostReportTabId).IsValid())
+	{
+		UpdateCostReport();
+	}
 }
 
-void FMGFXMaterialEditor::RegenerateTargetMaterial()
+void FMGFXMaterialEditor::RegenerateTargetMaterial(bool bForce)
 {
 	SCOPED_NAMED_EVENT(FMGFXMaterialEditor_RegenerateMaterial, FColor::Green);
 
@@ -194,8 +236,19 @@ void FMGFXMaterialEditor::RegenerateTargetMaterial()
 	// undo/redo for MGFXMaterial changes should not be interrupted by material updates
 	const FScopedTransaction Transaction(LOCTEXT("RegenerateMaterial", "Apply MGFX Material"), false);
 
+	// shared materials are used by other mgfx materials, and are never regenerated with a different structure.
+	// when the structure changes, switch to the shared material for the new structure instead.
 	UMaterial* Material = GetTargetMaterial();
-	if (!Material)
+	if (Material && !MGFXMaterial->UsesSharedMaterial() && FMGFXMaterialGenerator::IsSharedMaterial(Material))
+	{
+		// no longer sharing, so stop using the shared material and its instance, and create a material for this asset only
+		MGFXMaterial->Modify();
+		MGFXMaterial->Material = nullptr;
+		MGFXMaterial->MaterialInstance = nullptr;
+		Material = nullptr;
+	}
+
+	if (!Material || (MGFXMaterial->UsesSharedMaterial() && !FMGFXMaterialGenerator::HasSameContent(MGFXMaterial, Material, false)))
 	{
 		Material = CreateTargetMaterialAsset();
 
@@ -206,6 +259,18 @@ void FMGFXMaterialEditor::RegenerateTargetMaterial()
 		}
 	}
 
+	// the interpreted material doesn't change with the layers, only its layer data
+	if (MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		UpdatePackedLayersTexture();
+	}
+
+	if (!bForce && FMGFXMaterialGenerator::IsMaterialUpToDate(MGFXMaterial, Material, false))
+	{
+		UE_LOG(LogMGFXEditor, Verbose, TEXT("%s is up to date, skipping regenerate."), *GetNameSafe(Material));
+		return;
+	}
+
 	// if MaterialEditor is open, update its preview material as well
 	if (IMaterialEditor* MaterialEditor = FindMaterialEditor(Material))
 	{
@@ -228,20 +293,38 @@ void FMGFXMaterialEditor::RegenerateTargetMaterial()
 
 UMaterial* FMGFXMaterialEditor::CreateTargetMaterialAsset()
 {
-	if (!MGFXMaterial->Material)
+	if (MGFXMaterial->UsesSharedMaterial())
 	{
-		const FAssetToolsModule& AssetToolsModule = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools");
+		return FindOrCreateSharedMaterialAsset();
+	}
 
+	if (!MGFXMaterial->Material)
+	{
 		const FString MGFXMaterialPath = MGFXMaterial->GetPackage()->GetPathName();
 		const FString PackagePath = FPackageName::GetLongPackagePath(MGFXMaterialPath);
 		const FString AssetName = TEXT("M_") + FPackageName::GetShortName(MGFXMaterialPath);
+		const FString ObjectPath = FString::Printf(TEXT("%s/%s.%s"), *PackagePath, *AssetName, *AssetName);
 
-		UMaterialFactoryNew* MaterialFactory = NewObject<UMaterialFactoryNew>();
-		UObject* NewMaterial = AssetToolsModule.Get().CreateAsset(AssetName, PackagePath, UMaterial::StaticClass(), MaterialFactory);
+		// reuse the material this asset used before it was shared
+		UMaterial* NewMaterial = LoadObject<UMaterial>(nullptr, *ObjectPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+		if (NewMaterial && FMGFXMaterialGenerator::IsSharedMaterial(NewMaterial))
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("%s is a shared material, and can't be used as the material of %s"),
+			       *GetNameSafe(NewMaterial), *GetNameSafe(MGFXMaterial));
+			return nullptr;
+		}
+
+		if (!NewMaterial)
+		{
+			const FAssetToolsModule& AssetToolsModule = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools");
+
+			UMaterialFactoryNew* MaterialFactory = NewObject<UMaterialFactoryNew>();
+			NewMaterial = Cast<UMaterial>(AssetToolsModule.Get().CreateAsset(AssetName, PackagePath, UMaterial::StaticClass(), MaterialFactory));
+		}
 
 		if (NewMaterial)
 		{
-			MGFXMaterial->Material = Cast<UMaterial>(NewMaterial);
+			MGFXMaterial->Material = NewMaterial;
 			OnMaterialAssetChanged();
 		}
 	}
@@ -249,6 +332,156 @@ UMaterial* FMGFXMaterialEditor::CreateTargetMaterialAsset()
 	return MGFXMaterial->Material;
 }
 
+UMaterial* FMGFXMaterialEditor::FindOrCreateSharedMaterialAsset()
+{
+	// without a shared directory, materials are only shared with other mgfx materials in the same folder
+	FString PackagePath = MGFXMaterial->SharedMaterialDirectory.Path;
+	if (PackagePath.IsEmpty())
+	{
+		PackagePath = FPackageName::GetLongPackagePath(MGFXMaterial->GetPackage()->GetPathName());
+	}
+
+	// the name only contains a hash of the structure, so a material with a different structure may already use it.
+	// in that case, use the first numbered name whose material has the same structure, or isn't taken.
+	const FString BaseAssetName = FMGFXMaterialGenerator::GetSharedMaterialName(MGFXMaterial);
+	FString AssetName = BaseAssetName;
+	UMaterial* SharedMaterial = nullptr;
+	for (int32 Suffix = 1;; ++Suffix)
+	{
+		const FString ObjectPath = FString::Printf(TEXT("%s/%s.%s"), *PackagePath, *AssetName, *AssetName);
+		UMaterial* ExistingMaterial = LoadObject<UMaterial>(nullptr, *ObjectPath, nullptr, LOAD_NoWarn | LOAD_Quiet);
+		if (!ExistingMaterial || FMGFXMaterialGenerator::CanReuseSharedMaterial(MGFXMaterial, ExistingMaterial))
+		{
+			SharedMaterial = ExistingMaterial;
+			break;
+		}
+
+		UE_LOG(LogMGFXEditor, Warning, TEXT("%s was generated from a different structure than %s, trying another name."),
+		       *GetNameSafe(ExistingMaterial), *GetNameSafe(MGFXMaterial));
+		AssetName = FString::Printf(TEXT("%s_%d"), *BaseAssetName, Suffix);
+	}
+
+	if (!SharedMaterial)
+	{
+		const FAssetToolsModule& AssetToolsModule = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools");
+
+		UMaterialFactoryNew* MaterialFactory = NewObject<UMaterialFactoryNew>();
+		SharedMaterial = Cast<UMaterial>(AssetToolsModule.Get().CreateAsset(AssetName, PackagePath, UMaterial::StaticClass(), MaterialFactory));
+	}
+
+	if (SharedMaterial && SharedMaterial != MGFXMaterial->Material)
+	{
+		MGFXMaterial->Modify();
+		MGFXMaterial->Material = SharedMaterial;
+		OnMaterialAssetChanged();
+	}
+
+	return SharedMaterial;
+}
+
+void FMGFXMaterialEditor::UpdateMaterialInstance()
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialEditor_UpdateMaterialInstance, FColor::Green);
+
+	FMGFXMaterialEditorUtils::UpdateMaterialInstance(*Generator, MGFXMaterial, GetTargetMaterial());
+}
+
+void FMGFXMaterialEditor::UpdateCostReport()
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialEditor_UpdateCostReport, FColor::Green);
+
+	UMaterial* Material = GetTargetMaterial();
+	if (!Material || !Generator->IsGeneratedMaterial(Material))
+	{
+		// the report needs the generated layers, so generate the target material first
+		RegenerateTargetMaterial(true);
+		Material = GetTargetMaterial();
+	}
+
+	if (!Material)
+	{
+		return;
+	}
+
+	CostReport = Generator->CreateCostReport(MGFXMaterial, Material);
+
+	OnCostReportChangedEvent.Broadcast(CostReport);
+}
+
+void FMGFXMaterialEditor::ShowCostReport()
+{
+	TabManager->TryInvokeTab(CostReportTabId);
+	UpdateCostReport();
+}
+
+void FMGFXMaterialEditor::BakeTextures()
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialEditor_BakeTextures, FColor::Green);
+
+	FMGFXBakedImage Image;
+	if (!FMGFXMaterialBaker::Bake(MGFXMaterial, MGFXMaterial->BakeSettings, Image))
+	{
+		UE_LOG(LogMGFXEditor, Error, TEXT("Failed to bake %s, the bake resolution is empty."), *GetNameSafe(MGFXMaterial));
+		return;
+	}
+
+	if (!Image.bIsComplete)
+	{
+		UE_LOG(LogMGFXEditor, Warning, TEXT("%s has shapes that can't be evaluated on the CPU, they will be missing from the baked textures. "
+			       "Only builtin shapes are supported."),
+		       *GetNameSafe(MGFXMaterial));
+	}
+
+	const FScopedTransaction Transaction(LOCTEXT("BakeTextures", "Bake MGFX Material"));
+	MGFXMaterial->Modify();
+
+	const auto UpdateTexture = [&Image](UTexture2D* Texture, ETextureSourceFormat Format, const uint8* Data, bool bIsDistanceField)
+	{
+		Texture->Modify();
+		Texture->PreEditChange(nullptr);
+		Texture->Source.Init(Image.Size.X, Image.Size.Y, 1, 1, Format, Data);
+		Texture->SRGB = !bIsDistanceField;
+		Texture->CompressionSettings = bIsDistanceField ? TC_DistanceFieldFont : TC_Default;
+		Texture->LODGroup = TEXTUREGROUP_UI;
+		Texture->MipGenSettings = TMGS_NoMipmaps;
+		Texture->PostEditChange();
+		Texture->MarkPackageDirty();
+	};
+
+	if (!MGFXMaterial->BakedTexture)
+	{
+		MGFXMaterial->BakedTexture = CreateTextureAsset(FString());
+	}
+	if (MGFXMaterial->BakedTexture)
+	{
+		UpdateTexture(MGFXMaterial->BakedTexture, TSF_BGRA8, reinterpret_cast<const uint8*>(Image.Colors.GetData()), false);
+	}
+
+	if (!Image.DistanceField.IsEmpty())
+	{
+		if (!MGFXMaterial->BakedDistanceFieldTexture)
+		{
+			MGFXMaterial->BakedDistanceFieldTexture = CreateTextureAsset(TEXT("_SDF"));
+		}
+		if (MGFXMaterial->BakedDistanceFieldTexture)
+		{
+			UpdateTexture(MGFXMaterial->BakedDistanceFieldTexture, TSF_G8, Image.DistanceField.GetData(), true);
+		}
+	}
+
+	UE_LOG(LogMGFXEditor, Display, TEXT("Baked %s at %dx%d."), *GetNameSafe(MGFXMaterial), Image.Size.X, Image.Size.Y);
+}
+
+UTexture2D* FMGFXMaterialEditor::CreateTextureAsset(const FString& Suffix)
+{
+	return FMGFXMaterialEditorUtils::CreateTextureAsset(MGFXMaterial, Suffix);
+}
+
+void FMGFXMaterialEditor::UpdatePackedLayersTexture()
+{
+	FMGFXMaterialEditorUtils::UpdatePackedLayersTexture(MGFXMaterial);
+}
+
 FVector2D FMGFXMaterialEditor::GetCanvasSize() const
 {
 	return FVector2D(MGFXMaterial->BaseCanvasSize);
@@ -281,6 +514,13 @@ void FMGFXMaterialEditor::SetSelectedLayers(const TArray<UMGFXMaterialLayer*>& L
 	}
 
 	OnLayerSelectionChangedEvent.Broadcast(SelectedLayers);
+
+	// newly selected layers become live, and deselected layers are optimized again, compiled in the background
+	if (MGFXMaterial->bOptimizePreview)
+	{
+		UpdateLivePreviewLayers();
+		RegeneratePreviewMaterial();
+	}
 }
 
 void FMGFXMaterialEditor::ClearSelectedLayers()
@@ -357,6 +597,8 @@ void FMGFXMaterialEditor::AddReferencedObjects(FReferenceCollector& Collector)
 	Collector.AddReferencedObject(MGFXMaterial);
 	Collector.AddReferencedObject(PreviewMaterial);
 	Collector.AddReferencedObject(PreviewMID);
+	Collector.AddReferencedObject(PendingPreviewMaterial);
+	Collector.AddReferencedObject(PreviewLayerDataTexture);
 }
 
 void FMGFXMaterialEditor::NotifyPreChange(FProperty* PropertyAboutToChange)
@@ -381,10 +623,25 @@ void FMGFXMaterialEditor::NotifyPostChange(const FPropertyChangedEvent& Property
 	}
 	else if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, DesignerBackground) ||
 		MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, bOverrideDesignerBackground) ||
-		MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, bAllAnimatable))
+		MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, bAllAnimatable) ||
+		MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, SharedMaterialDirectory) ||
+		MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, MaterialInstance))
 	{
 		return;
 	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterial, bOptimizePreview))
+	{
+		RecentlyEditedLayers.Reset();
+		UpdateLivePreviewLayers();
+		RegeneratePreviewMaterial();
+		return;
+	}
+	else if (MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		// the interpreted preview has no layer parameters, and doesn't need to be regenerated for layer changes
+		RegeneratePreviewMaterial();
+		return;
+	}
 
 	// handle material parameter properties
 
@@ -392,142 +649,69 @@ void FMGFXMaterialEditor::NotifyPostChange(const FPropertyChangedEvent& Property
 	// but it's not perfect, and flickering occurs. Instead, we modify the MID which has perfect responsiveness
 	// during Interactive property changes and then update the Material during ValueSet changes.
 
-	// the preview material is always generated without optimization, so all params will be available
+	// the preview material is generated without optimization for live layers, so all their params will be available.
+	// edited layers that were optimized become live, and must be regenerated before their params exist.
 	const bool bInteractive = PropertyChangedEvent.ChangeType == EPropertyChangeType::Interactive;
 	bool bIsParameterChange = false;
+	bool bHasNewLiveLayers = false;
+
+	// parameter names are resolved by the generator, so no strings are built during interactive changes
+	const FName ParameterPropertyName = GetParameterPropertyName(MemberPropertyName, PropertyThatChanged);
 
 	for (int32 Idx = 0; Idx < PropertyChangedEvent.GetNumObjectsBeingEdited(); ++Idx)
 	{
 		const UObject* EditedObject = PropertyChangedEvent.GetObjectBeingEdited(Idx);
-		if (const UMGFXMaterialLayer* EditedLayer = Cast<UMGFXMaterialLayer>(EditedObject))
+		if (!EditedObject)
+		{
+			continue;
+		}
+
+		const UMGFXMaterialLayer* EditedLayer = Cast<UMGFXMaterialLayer>(EditedObject);
+		bHasNewLiveLayers |= AddRecentlyEditedLayer(EditedLayer ? EditedLayer : EditedObject->GetTypedOuter<UMGFXMaterialLayer>());
+
+		const FMGFXPropertyParameters* Parameters = Generator->FindPropertyParameters(PreviewMaterial, EditedObject, ParameterPropertyName);
+		if (!Parameters)
 		{
-			const FString ParamPrefix = EditedLayer->Name + ".";
+			continue;
+		}
 
+		FLinearColor Value;
+		if (EditedLayer)
+		{
 			// editing a layer transform
-			if (MemberPropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterialLayer, Transform))
+			if (ParameterPropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location))
 			{
-				if (TDoubleLinkedList<FProperty*>::TDoubleLinkedListNode* ParentNode = PropertyThatChanged->GetActiveNode()->GetPrevNode())
-				{
-					const FName ParentPropertyName = ParentNode->GetValue()->GetFName();
-					if (PropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location))
-					{
-						// setting Location
-						SetMaterialScalarParameterValue(FName(ParamPrefix + Generator->Param_LocationX), EditedLayer->Transform.Location.X, bInteractive);
-						SetMaterialScalarParameterValue(FName(ParamPrefix + Generator->Param_LocationY), EditedLayer->Transform.Location.Y, bInteractive);
-						bIsParameterChange = true;
-					}
-					else if (PropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation))
-					{
-						// setting Rotation
-						const float NewValue = EditedLayer->Transform.Rotation;
-						const FString ParamName = Generator->Param_Rotation;
-
-						SetMaterialScalarParameterValue(FName(ParamPrefix + ParamName), NewValue, bInteractive);
-						bIsParameterChange = true;
-					}
-					else if (PropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale))
-					{
-						// setting Scale
-						SetMaterialScalarParameterValue(FName(ParamPrefix + Generator->Param_ScaleX), EditedLayer->Transform.Scale.X, bInteractive);
-						SetMaterialScalarParameterValue(FName(ParamPrefix + Generator->Param_ScaleY), EditedLayer->Transform.Scale.Y, bInteractive);
-						bIsParameterChange = true;
-					}
-					else if (ParentPropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location))
-					{
-						// setting X or Y of Location
-						const bool bIsX = PropertyName == GET_MEMBER_NAME_CHECKED(FVector2f, X);
-						const float NewValue = bIsX ? EditedLayer->Transform.Location.X : EditedLayer->Transform.Location.Y;
-						const FString ParamName = bIsX ? Generator->Param_LocationX : Generator->Param_LocationY;
-
-						SetMaterialScalarParameterValue(FName(ParamPrefix + ParamName), NewValue, bInteractive);
-						bIsParameterChange = true;
-					}
-					else if (ParentPropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale))
-					{
-						// setting X or Y of Scale
-						const bool bIsX = PropertyName == GET_MEMBER_NAME_CHECKED(FVector2f, X);
-						const float NewValue = bIsX ? EditedLayer->Transform.Scale.X : EditedLayer->Transform.Scale.Y;
-						const FString ParamName = bIsX ? Generator->Param_ScaleX : Generator->Param_ScaleY;
-
-						SetMaterialScalarParameterValue(FName(ParamPrefix + ParamName), NewValue, bInteractive);
-						bIsParameterChange = true;
-					}
-				}
+				Value = FLinearColor(EditedLayer->Transform.Location.X, EditedLayer->Transform.Location.Y, 0.f, 0.f);
 			}
-		}
-		else if (const UMGFXMaterialShape* EditedShape = Cast<UMGFXMaterialShape>(EditedObject))
-		{
-			if (const UMGFXMaterialLayer* OwningLayer = Cast<UMGFXMaterialLayer>(EditedShape->GetOuter()))
+			else if (ParameterPropertyName == GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation))
 			{
-				const FString ParamPrefix = OwningLayer->Name + ".";
-
-				// editing a shape
-				for (const FMGFXMaterialShapeInput& Input : EditedShape->GetInputs())
-				{
-					// member property name is all that matters, the entire parameter will be updated
-					if (MemberPropertyName == Input.Name)
-					{
-						switch (Input.Type)
-						{
-						case EMGFXMaterialShapeInputType::Float:
-							SetMaterialScalarParameterValue(FName(ParamPrefix + Input.Name), Input.Value.R, bInteractive);
-							bIsParameterChange = true;
-							break;
-						case EMGFXMaterialShapeInputType::Vector2:
-							SetMaterialScalarParameterValue(FName(ParamPrefix + Input.Name + "X"), Input.Value.R, bInteractive);
-							SetMaterialScalarParameterValue(FName(ParamPrefix + Input.Name + "Y"), Input.Value.G, bInteractive);
-							bIsParameterChange = true;
-							break;
-						case EMGFXMaterialShapeInputType::Vector3:
-						case EMGFXMaterialShapeInputType::Vector4:
-							SetMaterialVectorParameterValue(FName(ParamPrefix + Input.Name), Input.Value, bInteractive);
-							bIsParameterChange = true;
-							break;
-						default: ;
-						}
-					}
-				}
+				// rotation is packed into a vector parameter
+				Value = FMGFXShapeTransform2D::GetRotationParameterValue(EditedLayer->Transform.Rotation);
 			}
-		}
-		else if (const UMGFXMaterialShapeFill* EditedFill = Cast<UMGFXMaterialShapeFill>(EditedObject))
-		{
-			// editing fill visual
-			if (const UMGFXMaterialLayer* OwningLayer = Cast<UMGFXMaterialLayer>(EditedFill->GetOuter()->GetOuter()))
+			else
 			{
-				const FString ParamPrefix = OwningLayer->Name + ".";
-
-				if (PropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeFill, Color))
-				{
-					SetMaterialVectorParameterValue(FName(ParamPrefix + "Color"), EditedFill->Color, bInteractive);
-					bIsParameterChange = true;
-				}
+				Value = FLinearColor(EditedLayer->Transform.Scale.X, EditedLayer->Transform.Scale.Y, 0.f, 0.f);
 			}
 		}
-		else if (const UMGFXMaterialShapeStroke* EditedStroke = Cast<UMGFXMaterialShapeStroke>(EditedObject))
+		else if (!Parameters->GetValue(EditedObject, Value))
 		{
-			if (const UMGFXMaterialLayer* OwningLayer = Cast<UMGFXMaterialLayer>(EditedStroke->GetOuter()->GetOuter()))
-			{
-				const FString ParamPrefix = OwningLayer->Name + ".";
-
-				// editing stroke visual
-				if (PropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, Color))
-				{
-					SetMaterialVectorParameterValue(FName(ParamPrefix + "Color"), EditedStroke->Color, bInteractive);
-					bIsParameterChange = true;
-				}
-				else if (PropertyName == GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, StrokeWidth))
-				{
-					SetMaterialScalarParameterValue(FName(ParamPrefix + "StrokeWidth"), EditedStroke->StrokeWidth, bInteractive);
-					bIsParameterChange = true;
-				}
-			}
+			continue;
 		}
+
+		// editing a layer transform, shape input, or visual
+		SetPropertyParameterValue(*Parameters, Value, bInteractive);
+		bIsParameterChange = true;
+	}
+
+	if (bHasNewLiveLayers)
+	{
+		UpdateLivePreviewLayers();
 	}
 
-	if (!bInteractive)
+	if (!bInteractive || bHasNewLiveLayers)
 	{
 		// TODO: more accurate filtering of properties that should cause regenerate
-		const bool bShouldRegenerate = !bIsParameterChange;
+		const bool bShouldRegenerate = !bIsParameterChange || bHasNewLiveLayers;
 
 		if (bShouldRegenerate)
 		{
@@ -536,8 +720,59 @@ void FMGFXMaterialEditor::NotifyPostChange(const FPropertyChangedEvent& Property
 	}
 }
 
+FName FMGFXMaterialEditor::GetParameterPropertyName(FName MemberPropertyName, FEditPropertyChain* PropertyThatChanged)
+{
+	if (MemberPropertyName != GET_MEMBER_NAME_CHECKED(UMGFXMaterialLayer, Transform))
+	{
+		return MemberPropertyName;
+	}
+
+	// find the property directly within the transform, e.g. Location when setting Location.X
+	for (auto* Node = PropertyThatChanged->GetActiveNode(); Node && Node->GetPrevNode(); Node = Node->GetPrevNode())
+	{
+		if (Node->GetPrevNode()->GetValue()->GetFName() == MemberPropertyName)
+		{
+			return Node->GetValue()->GetFName();
+		}
+	}
+
+	return NAME_None;
+}
+
+void FMGFXMaterialEditor::SetPropertyParameterValue(const FMGFXPropertyParameters& Parameters, const FLinearColor& Value, bool bInteractive) const
+{
+	switch (Parameters.Type)
+	{
+	case EMGFXMaterialShapeInputType::Float:
+		SetMaterialScalarParameterValue(Parameters.ParameterNames[0], Value.R, bInteractive);
+		break;
+	case EMGFXMaterialShapeInputType::Vector2:
+		// Vector2's are represented by 2 scalar params
+		SetMaterialScalarParameterValue(Parameters.ParameterNames[0], Value.R, bInteractive);
+		SetMaterialScalarParameterValue(Parameters.ParameterNames[1], Value.G, bInteractive);
+		break;
+	case EMGFXMaterialShapeInputType::Vector3:
+	case EMGFXMaterialShapeInputType::Vector4:
+		SetMaterialVectorParameterValue(Parameters.ParameterNames[0], Value, bInteractive);
+		break;
+	default: ;
+	}
+}
+
 void FMGFXMaterialEditor::SetMaterialScalarParameterValue(FName ParameterName, float Value, bool bInteractive) const
 {
+	if (const FMGFXPackedParameterSlot* PackedSlot = Generator->FindPackedParameter(PreviewMaterial, ParameterName))
+	{
+		// update only the channel of the vector parameter the scalar was packed into
+		FLinearColor PackedValue;
+		PreviewMID->GetVectorParameterValue(FHashedMaterialParameterInfo(PackedSlot->ParameterName), PackedValue);
+		PackedValue.Component(PackedSlot->Channel) = Value;
+
+		PreviewMID->Modify();
+		PreviewMID->SetVectorParameterValue(PackedSlot->ParameterName, PackedValue);
+		return;
+	}
+
 	PreviewMID->Modify();
 	PreviewMID->SetScalarParameterValue(ParameterName, Value);
 }
@@ -595,6 +830,14 @@ void FMGFXMaterialEditor::BindCommands()
 		Commands.Apply,
 		FExecuteAction::CreateSP(this, &FMGFXMaterialEditor::Apply));
 
+	UICommandList->MapAction(
+		Commands.CostReport,
+		FExecuteAction::CreateSP(this, &FMGFXMaterialEditor::ShowCostReport));
+
+	UICommandList->MapAction(
+		Commands.Bake,
+		FExecuteAction::CreateSP(this, &FMGFXMaterialEditor::BakeTextures));
+
 	UICommandList->MapAction(
 		FGenericCommands::Get().Delete,
 		FExecuteAction::CreateSP(this, &FMGFXMaterialEditor::DeleteSelectedLayers),
@@ -641,6 +884,8 @@ void FMGFXMaterialEditor::RegisterToolbar()
 	{
 		FToolMenuSection& Section = ToolBar->AddSection("MGFXToolbar", TAttribute<FText>(), InsertAfterAssetSection);
 		Section.AddEntry(FToolMenuEntry::InitToolBarButton(MGFXEditorCommands.Apply));
+		Section.AddEntry(FToolMenuEntry::InitToolBarButton(MGFXEditorCommands.CostReport));
+		Section.AddEntry(FToolMenuEntry::InitToolBarButton(MGFXEditorCommands.Bake));
 	}
 }
 
@@ -673,17 +918,39 @@ TSharedRef<SDockTab> FMGFXMaterialEditor::SpawnTab_Details(const FSpawnTabArgs&
 		];
 }
 
+TSharedRef<SDockTab> FMGFXMaterialEditor::SpawnTab_CostReport(const FSpawnTabArgs& Args)
+{
+	return SNew(SDockTab)
+		[
+			SAssignNew(CostReportWidget, SMGFXMaterialEditorCostReport)
+			.MGFXMaterialEditor(SharedThis(this))
+		];
+}
+
 void FMGFXMaterialEditor::OnMaterialAssetChanged()
 {
 	OnMaterialChangedEvent.Broadcast(MGFXMaterial->Material);
 }
 
 void FMGFXMaterialEditor::CreatePreviewMaterials()
+{
+	PreviewMaterial = CreatePreviewMaterial();
+	PendingPreviewMaterial = CreatePreviewMaterial();
+	bIsPreviewCompiling = false;
+
+	// create an MID of the preview for interactive parameter changes
+	PreviewMID = UMaterialInstanceDynamic::Create(PreviewMaterial, nullptr);
+	PreviewMID->SetFlags(RF_Transactional | RF_Transient);
+	UpdatePreviewLayerData();
+	OnPreviewMaterialChangedEvent.Broadcast(PreviewMID);
+}
+
+UPreviewMaterial* FMGFXMaterialEditor::CreatePreviewMaterial()
 {
 	UMaterialFactoryNew* MaterialFactory = NewObject<UMaterialFactoryNew>();
 	check(MaterialFactory);
 
-	PreviewMaterial = Cast<UPreviewMaterial>(MaterialFactory->FactoryCreateNew(
+	UPreviewMaterial* NewPreviewMaterial = Cast<UPreviewMaterial>(MaterialFactory->FactoryCreateNew(
 		UPreviewMaterial::StaticClass(),
 		GetTransientPackage(),
 		NAME_None,
@@ -692,14 +959,110 @@ void FMGFXMaterialEditor::CreatePreviewMaterials()
 		GWarn
 	));
 
-	PreviewMaterial->bIsPreviewMaterial = true;
+	NewPreviewMaterial->bIsPreviewMaterial = true;
 
-	// create an MID of the preview for interactive parameter changes
-	PreviewMID = UMaterialInstanceDynamic::Create(PreviewMaterial, nullptr);
-	PreviewMID->SetFlags(RF_Transactional | RF_Transient);
+	return NewPreviewMaterial;
+}
+
+void FMGFXMaterialEditor::FinishPendingPreviewMaterial()
+{
+	bIsPreviewCompiling = false;
+
+	// swap the materials, so the next regenerate reuses the previously displayed one
+	Swap(PreviewMaterial, PendingPreviewMaterial);
+
+	UMaterialInstanceDynamic* NewPreviewMID = UMaterialInstanceDynamic::Create(PreviewMaterial, nullptr);
+	NewPreviewMID->SetFlags(RF_Transactional | RF_Transient);
+
+	// keep any interactive parameter changes made while compiling
+	if (!Generator->IsPreviewMaterialUpToDate(MGFXMaterial, PreviewMaterial))
+	{
+		NewPreviewMID->CopyParameterOverrides(PreviewMID);
+	}
+
+	PreviewMID = NewPreviewMID;
+	UpdatePreviewLayerData();
 	OnPreviewMaterialChangedEvent.Broadcast(PreviewMID);
 }
 
+void FMGFXMaterialEditor::UpdatePreviewLayerData()
+{
+	if (MGFXMaterial->GeneratorBackend != EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		return;
+	}
+
+	// layer data is small, so it's repacked for every change, including interactive ones
+	FMGFXPackedLayers PackedLayers;
+	if (!PreviewMID || !FMGFXLayerPacker::Pack(MGFXMaterial, PackedLayers))
+	{
+		return;
+	}
+
+	// the texture is updated in place, and only recreated when the layer data no longer fits
+	if (!FMGFXLayerPacker::UpdateTransientTexture(PreviewLayerDataTexture, PackedLayers))
+	{
+		PreviewLayerDataTexture = FMGFXLayerPacker::CreateTransientTexture(PackedLayers);
+	}
+	PreviewMID->SetTextureParameterValue(FMGFXLayerPacker::LayerDataParameterName, PreviewLayerDataTexture);
+}
+
+void FMGFXMaterialEditor::UpdateLivePreviewLayers()
+{
+	if (!MGFXMaterial->bOptimizePreview)
+	{
+		Generator->ClearLivePreviewLayers();
+		return;
+	}
+
+	TArray<const UMGFXMaterialLayer*> LiveLayers;
+	for (const UMGFXMaterialLayer* Layer : SelectedLayers)
+	{
+		LiveLayers.Add(Layer);
+	}
+	for (const TWeakObjectPtr<const UMGFXMaterialLayer>& Layer : RecentlyEditedLayers)
+	{
+		if (Layer.IsValid())
+		{
+			LiveLayers.AddUnique(Layer.Get());
+		}
+	}
+
+	Generator->SetLivePreviewLayers(LiveLayers);
+}
+
+bool FMGFXMaterialEditor::AddRecentlyEditedLayer(const UMGFXMaterialLayer* Layer)
+{
+	if (!Layer || !MGFXMaterial->bOptimizePreview)
+	{
+		return false;
+	}
+
+	const bool bWasLive = Generator->IsLivePreviewLayer(Layer);
+
+	RecentlyEditedLayers.Remove(Layer);
+	RecentlyEditedLayers.Add(Layer);
+	if (RecentlyEditedLayers.Num() > MaxRecentlyEditedLayers)
+	{
+		RecentlyEditedLayers.RemoveAt(0);
+	}
+
+	return !bWasLive;
+}
+
+void FMGFXMaterialEditor::Tick(float DeltaTime)
+{
+	if (bIsPreviewCompiling && !PendingPreviewMaterial->IsCompiling())
+	{
+		FinishPendingPreviewMaterial();
+	}
+}
+
+TStatId FMGFXMaterialEditor::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FMGFXMaterialEditor, STATGROUP_Tickables);
+}
+
 IMaterialEditor* FMGFXMaterialEditor::FindMaterialEditor(UMaterial* Material)
 {
 	UAssetEditorSubsystem* AssetEditorSubsystem = GEditor->GetEditorSubsystem<UAssetEditorSubsystem>();
@@ -5,17 +5,22 @@
 #include "CoreMinimal.h"
 #include "EditorUndoClient.h"
 #include "IMGFXMaterialEditor.h"
+#include "MGFXMaterialCostReport.h"
 #include "MGFXMaterialTypes.h"
 #include "MaterialEditor/PreviewMaterial.h"
 #include "Misc/NotifyHook.h"
+#include "TickableEditorObject.h"
 
 class FMGFXMaterialGenerator;
+struct FMGFXPropertyParameters;
 class IMaterialEditor;
 class SMGFXMaterialEditorCanvas;
+class SMGFXMaterialEditorCostReport;
 class SMGFXMaterialEditorLayers;
 class UMGFXMaterial;
 class UMGFXMaterialLayer;
 class UPreviewMaterial;
+class UTexture2D;
 
 #define GENERATOR_REFACTOR 1
 
@@ -26,7 +31,8 @@ class UPreviewMaterial;
 class MGFXEDITOR_API FMGFXMaterialEditor : public IMGFXMaterialEditor,
                                            public FGCObject,
                                            public FNotifyHook,
-                                           public FEditorUndoClient
+                                           public FEditorUndoClient,
+                                           public FTickableEditorObject
 {
 public:
 	FMGFXMaterialEditor();
@@ -56,18 +62,49 @@ public:
 	/** Return the MID of the preview material that supports fast interactive parameter-only changes. */
 	UMaterialInstanceDynamic* GetPreviewMID() const { return PreviewMID; }
 
-	/** Regenerate the preview material, called whenever structural changes occur. */
+	/**
+	 * Regenerate the preview material, called whenever structural changes occur. Skipped if the preview material is up to date.
+	 * The new preview compiles in the background, and the last preview is displayed until it's ready.
+	 * Regenerating again while compiling supersedes the in-flight compile.
+	 */
 	void RegeneratePreviewMaterial();
 
+	/** Return true if a regenerated preview material is compiling, and the displayed preview is out of date. */
+	bool IsPreviewMaterialCompiling() const { return bIsPreviewCompiling; }
+
 	/** Apply changes to the target material, regenerating it and recompiling. */
 	void Apply();
 
-	/** Fully regenerate the target material. */
-	void RegenerateTargetMaterial();
+	/** Fully regenerate the target material. Does nothing if the material is up to date, unless bForce is true. */
+	void RegenerateTargetMaterial(bool bForce = false);
 
-	/** Create a new material asset for the MGFX material. */
+	/** Create a new material asset for the MGFX material, or find the shared material for its structure. */
 	UMaterial* CreateTargetMaterialAsset();
 
+	/** Find the shared material for the current structure of the MGFX material, creating it if it doesn't exist. */
+	UMaterial* FindOrCreateSharedMaterialAsset();
+
+	/** Set every value of the MGFX material on its instance of the shared material, creating the instance if needed. */
+	void UpdateMaterialInstance();
+
+	/** Return the last cost report of the target material. */
+	const FMGFXMaterialCostReport& GetCostReport() const { return CostReport; }
+
+	/** Compile the target material and update the cost report, applying changes first if the material hasn't been generated. */
+	void UpdateCostReport();
+
+	/** Update the cost report and show it. */
+	void ShowCostReport();
+
+	/** Rasterize the material into its baked texture assets, creating them if needed. */
+	void BakeTextures();
+
+	/** Create a new texture asset next to the MGFX material, named after it with a suffix. */
+	UTexture2D* CreateTextureAsset(const FString& Suffix);
+
+	/** Pack the layers into the packed layers texture asset used by the interpreted material, creating it if needed. */
+	void UpdatePackedLayersTexture();
+
 	FVector2D GetCanvasSize() const;
 
 	TArray<TObjectPtr<UMGFXMaterialLayer>> GetSelectedLayers() const;
@@ -78,6 +115,9 @@ public:
 
 	void OnLayerSelectionChanged(TArray<TObjectPtr<UMGFXMaterialLayer>> TreeSelectedLayers);
 
+	/** The number of recently edited layers that remain live in an optimized preview after they are deselected. */
+	static constexpr int32 MaxRecentlyEditedLayers = 8;
+
 	bool IsDetailsPropertyVisible(const FPropertyAndParent& PropertyAndParent);
 
 	bool IsDetailsRowVisible(FName InRowName, FName InParentName);
@@ -96,6 +136,15 @@ public:
 	virtual void NotifyPreChange(FProperty* PropertyAboutToChange) override;
 	virtual void NotifyPostChange(const FPropertyChangedEvent& PropertyChangedEvent, FEditPropertyChain* PropertyThatChanged) override;
 
+	/**
+	 * Return the name of an edited property used to find its generated parameters.
+	 * This is the member property, except for layer transforms, where it's the property within the transform.
+	 */
+	static FName GetParameterPropertyName(FName MemberPropertyName, FEditPropertyChain* PropertyThatChanged);
+
+	/** Set the values of the generated parameters of an edited property. */
+	void SetPropertyParameterValue(const FMGFXPropertyParameters& Parameters, const FLinearColor& Value, bool bInteractive) const;
+
 	/** Set a scalar parameter value, either on the preview material if interactive, or directly on the generated material expressions. */
 	void SetMaterialScalarParameterValue(FName ParameterName, float Value, bool bInteractive) const;
 
@@ -108,6 +157,11 @@ public:
 	virtual void PostUndo(bool bSuccess) override;
 	virtual void PostRedo(bool bSuccess) override;
 
+	// FTickableEditorObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return bIsPreviewCompiling; }
+	virtual TStatId GetStatId() const override;
+
 	DECLARE_MULTICAST_DELEGATE_OneParam(FMaterialChangedDelegate, UMaterialInterface* /*NewMaterial*/);
 
 	/** Called when the material asset has been set or changed. */
@@ -126,6 +180,11 @@ public:
 	/** Called when a layer is added, removed, or reparented. */
 	FLayersChangedDelegate OnLayersChangedEvent;
 
+	DECLARE_MULTICAST_DELEGATE_OneParam(FCostReportChangedDelegate, const FMGFXMaterialCostReport& /*CostReport*/);
+
+	/** Called when the cost report has been updated. */
+	FCostReportChangedDelegate OnCostReportChangedEvent;
+
 private:
 	TSharedPtr<SMGFXMaterialEditorCanvas> CanvasWidget;
 
@@ -133,6 +192,8 @@ private:
 
 	TSharedPtr<IDetailsView> DetailsView;
 
+	TSharedPtr<SMGFXMaterialEditorCostReport> CostReportWidget;
+
 	/** The generator used to build a UMaterial from a UMGFXMaterial. */
 	TSharedPtr<FMGFXMaterialGenerator> Generator;
 
@@ -145,15 +206,31 @@ private:
 	/** The dynamic preview material to display in the editor, is updated interactively for parameter-value-only changes. */
 	TObjectPtr<UMaterialInstanceDynamic> PreviewMID;
 
+	/** The regenerated preview material that compiles in the background, and replaces the preview material once ready. */
+	TObjectPtr<UPreviewMaterial> PendingPreviewMaterial;
+
+	/** The transient layer data of the preview when using the interpreted backend, updated in place as layers change. */
+	TObjectPtr<UTexture2D> PreviewLayerDataTexture;
+
+	/** Is the pending preview material compiling? */
+	bool bIsPreviewCompiling = false;
+
 	/** The currently selected layers. */
 	TArray<TObjectPtr<UMGFXMaterialLayer>> SelectedLayers;
 
+	/** The most recently edited layers, most recent last. */
+	TArray<TWeakObjectPtr<const UMGFXMaterialLayer>> RecentlyEditedLayers;
+
+	/** The last cost report of the target material. */
+	FMGFXMaterialCostReport CostReport;
+
 	void BindCommands();
 	void RegisterToolbar();
 
 	TSharedRef<SDockTab> SpawnTab_Canvas(const FSpawnTabArgs& Args);
 	TSharedRef<SDockTab> SpawnTab_Layers(const FSpawnTabArgs& Args);
 	TSharedRef<SDockTab> SpawnTab_Details(const FSpawnTabArgs& Args);
+	TSharedRef<SDockTab> SpawnTab_CostReport(const FSpawnTabArgs& Args);
 
 	/** Called when the material asset of the MGFX material has changed to a new asset. */
 	void OnMaterialAssetChanged();
@@ -161,6 +238,24 @@ private:
 	/** Create or recreate the preview material instance dynamic. */
 	void CreatePreviewMaterials();
 
+	/** Create a new transient preview material. */
+	static UPreviewMaterial* CreatePreviewMaterial();
+
+	/** Display the pending preview material once it has finished compiling, and recreate the preview MID. */
+	void FinishPendingPreviewMaterial();
+
+	/** Pack the current layers into the preview MID, if the preview is interpreted. */
+	void UpdatePreviewLayerData();
+
+	/**
+	 * Update which layers are generated with live parameters in the preview material.
+	 * When the preview is optimized, only selected and recently edited layers are live. Does not regenerate the preview.
+	 */
+	void UpdateLivePreviewLayers();
+
+	/** Mark a layer as recently edited, returning true if it wasn't live in the preview material until now. */
+	bool AddRecentlyEditedLayer(const UMGFXMaterialLayer* Layer);
+
 	/** Find an open material editor for a material. */
 	static IMaterialEditor* FindMaterialEditor(UMaterial* Material);
 
@@ -182,4 +277,5 @@ public:
 	static const FName CanvasTabId;
 	static const FName LayersTabId;
 	static const FName DetailsTabId;
+	static const FName CostReportTabId;
 };
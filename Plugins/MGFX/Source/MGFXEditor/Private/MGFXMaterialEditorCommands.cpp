@@ -10,6 +10,12 @@ void FMGFXMaterialEditorCommands::RegisterCommands()
 	UI_COMMAND(Apply, "Apply", "Apply changes to the target material",
 	           EUserInterfaceActionType::Button, FInputChord());
 
+	UI_COMMAND(CostReport, "Cost Report", "Compile the target material and show the estimated cost of each layer",
+	           EUserInterfaceActionType::Button, FInputChord());
+
+	UI_COMMAND(Bake, "Bake", "Rasterize the material into texture assets using the bake settings, for static designs",
+	           EUserInterfaceActionType::Button, FInputChord());
+
 	UI_COMMAND(ZoomTo50, "50%", "Zoom to 50%", EUserInterfaceActionType::Button, FInputChord());
 	UI_COMMAND(ZoomTo100, "100%", "Zoom to 100%", EUserInterfaceActionType::Button, FInputChord());
 	UI_COMMAND(ZoomTo200, "200%", "Zoom to 200%", EUserInterfaceActionType::Button, FInputChord());
@@ -3,11 +3,20 @@
 
 #include "MGFXMaterialEditorUtils.h"
 
+#include "AssetToolsModule.h"
+#include "MGFXEditorModule.h"
 #include "MGFXMaterial.h"
+#include "MGFXMaterialGenerator.h"
 #include "MGFXMaterialLayer.h"
+#include "MGFXPackedLayers.h"
 #include "UnrealExporter.h"
+#include "Engine/Texture2D.h"
 #include "Exporters/Exporter.h"
+#include "Factories/MaterialInstanceConstantFactoryNew.h"
+#include "Factories/Texture2dFactoryNew.h"
 #include "Internationalization/TextPackageNamespaceUtil.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstanceConstant.h"
 #include "UObject/Package.h"
 
 
@@ -215,6 +224,99 @@ TArray<UMGFXMaterialLayer*> FMGFXMaterialEditorUtils::GetTopmostLayers(const TAr
 	return Result;
 }
 
+UMaterialInstanceConstant* FMGFXMaterialEditorUtils::UpdateMaterialInstance(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial,
+                                                                           UMaterial* SharedMaterial)
+{
+	if (!MGFXMaterial || !SharedMaterial)
+	{
+		return nullptr;
+	}
+
+	if (!MGFXMaterial->MaterialInstance)
+	{
+		const FAssetToolsModule& AssetToolsModule = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools");
+
+		const FString MGFXMaterialPath = MGFXMaterial->GetPackage()->GetPathName();
+		const FString PackagePath = FPackageName::GetLongPackagePath(MGFXMaterialPath);
+		const FString AssetName = TEXT("MI_") + FPackageName::GetShortName(MGFXMaterialPath);
+
+		UMaterialInstanceConstantFactoryNew* InstanceFactory = NewObject<UMaterialInstanceConstantFactoryNew>();
+		InstanceFactory->InitialParent = SharedMaterial;
+		UObject* NewInstance = AssetToolsModule.Get().CreateAsset(AssetName, PackagePath, UMaterialInstanceConstant::StaticClass(), InstanceFactory);
+
+		if (!NewInstance)
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("Failed to create Material Instance for %s"), *GetNameSafe(MGFXMaterial));
+			return nullptr;
+		}
+
+		MGFXMaterial->Modify();
+		MGFXMaterial->MaterialInstance = Cast<UMaterialInstanceConstant>(NewInstance);
+	}
+
+	// the shared material may have been generated from another mgfx material, so every value is set on the instance
+	TMap<FName, float> ScalarValues;
+	TMap<FName, FLinearColor> VectorValues;
+	Generator.GetParameterValues(MGFXMaterial, ScalarValues, VectorValues);
+
+	UMaterialInstanceConstant* MaterialInstance = MGFXMaterial->MaterialInstance;
+	MaterialInstance->Modify();
+	MaterialInstance->PreEditChange(nullptr);
+	MaterialInstance->SetParentEditorOnly(SharedMaterial);
+	MaterialInstance->ClearParameterValuesEditorOnly();
+	for (const TPair<FName, float>& Value : ScalarValues)
+	{
+		MaterialInstance->SetScalarParameterValueEditorOnly(FMaterialParameterInfo(Value.Key), Value.Value);
+	}
+	for (const TPair<FName, FLinearColor>& Value : VectorValues)
+	{
+		MaterialInstance->SetVectorParameterValueEditorOnly(FMaterialParameterInfo(Value.Key), Value.Value);
+	}
+	MaterialInstance->PostEditChange();
+	MaterialInstance->MarkPackageDirty();
+
+	return MaterialInstance;
+}
+
+UTexture2D* FMGFXMaterialEditorUtils::CreateTextureAsset(UMGFXMaterial* MGFXMaterial, const FString& Suffix)
+{
+	const FAssetToolsModule& AssetToolsModule = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools");
+
+	const FString MGFXMaterialPath = MGFXMaterial->GetPackage()->GetPathName();
+	const FString PackagePath = FPackageName::GetLongPackagePath(MGFXMaterialPath);
+	const FString AssetName = TEXT("T_") + FPackageName::GetShortName(MGFXMaterialPath) + Suffix;
+
+	UTexture2DFactoryNew* TextureFactory = NewObject<UTexture2DFactoryNew>();
+	UObject* NewTexture = AssetToolsModule.Get().CreateAsset(AssetName, PackagePath, UTexture2D::StaticClass(), TextureFactory);
+
+	return Cast<UTexture2D>(NewTexture);
+}
+
+UTexture2D* FMGFXMaterialEditorUtils::UpdatePackedLayersTexture(UMGFXMaterial* MGFXMaterial)
+{
+	FMGFXPackedLayers PackedLayers;
+	if (!FMGFXLayerPacker::Pack(MGFXMaterial, PackedLayers))
+	{
+		return nullptr;
+	}
+
+	if (!PackedLayers.bIsComplete)
+	{
+		UE_LOG(LogMGFXEditor, Warning, TEXT("%s has layers that can't be interpreted, they will be skipped. "
+			       "Only builtin shapes and up to %d levels of nesting are supported."),
+		       *GetNameSafe(MGFXMaterial), FMGFXPackedLayers::MaxDepth - 1);
+	}
+
+	if (!MGFXMaterial->PackedLayersTexture)
+	{
+		MGFXMaterial->Modify();
+		MGFXMaterial->PackedLayersTexture = CreateTextureAsset(MGFXMaterial, TEXT("_Layers"));
+	}
+
+	FMGFXLayerPacker::SetTextureSource(MGFXMaterial->PackedLayersTexture, PackedLayers);
+	return MGFXMaterial->PackedLayersTexture;
+}
+
 FName FMGFXMaterialEditorUtils::GetUniqueName(UObject* Outer, const FName& Name)
 {
 	int32 Number = Name.GetNumber();
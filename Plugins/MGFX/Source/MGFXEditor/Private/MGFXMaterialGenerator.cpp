@@ -3,9 +3,15 @@
 
 #include "MGFXMaterialGenerator.h"
 
+#include "MGFXEditorModule.h"
+#include "MGFXGeneratedMaterialUserData.h"
 #include "MGFXMaterial.h"
 #include "MGFXMaterialFunctionHelpers.h"
+#include "MGFXPackedLayers.h"
 #include "MGFXPropertyMacros.h"
+#include "Engine/Texture2D.h"
+#include "MaterialEditingLibrary.h"
+#include "Materials/MaterialExpressionAdd.h"
 #include "Materials/MaterialExpressionAppendVector.h"
 #include "Materials/MaterialExpressionComponentMask.h"
 #include "Materials/MaterialExpressionConstant.h"
@@ -20,11 +26,90 @@
 #include "Materials/MaterialExpressionStaticBool.h"
 #include "Materials/MaterialExpressionSubtract.h"
 #include "Materials/MaterialExpressionTextureCoordinate.h"
+#include "Materials/MaterialExpressionTextureObjectParameter.h"
+#include "Materials/MaterialExpressionTime.h"
 #include "Materials/MaterialExpressionVectorParameter.h"
 #include "Shapes/MGFXMaterialShape.h"
 #include "Shapes/MGFXMaterialShapeVisual.h"
 
 
+// FMGFXPropertyParameters
+// -----------------------
+
+bool FMGFXPropertyParameters::GetValue(const UObject* Object, FLinearColor& OutValue) const
+{
+	if (!Object || !ValueProperty)
+	{
+		return false;
+	}
+
+	const void* ValuePtr = ValueProperty->ContainerPtrToValuePtr<void>(Object);
+
+	if (const FFloatProperty* FloatProperty = CastField<FFloatProperty>(ValueProperty))
+	{
+		OutValue = FLinearColor(FloatProperty->GetPropertyValue(ValuePtr), 0.f, 0.f, 0.f);
+		return true;
+	}
+
+	const UScriptStruct* Struct = CastFieldChecked<FStructProperty>(ValueProperty)->Struct;
+	if (Struct == TVariantStructure<FVector2f>::Get())
+	{
+		const FVector2f& Value = *static_cast<const FVector2f*>(ValuePtr);
+		OutValue = FLinearColor(Value.X, Value.Y, 0.f, 0.f);
+	}
+	else if (Struct == TVariantStructure<FVector3f>::Get())
+	{
+		const FVector3f& Value = *static_cast<const FVector3f*>(ValuePtr);
+		OutValue = FLinearColor(Value.X, Value.Y, Value.Z, 0.f);
+	}
+	else if (Struct == TVariantStructure<FVector4f>::Get())
+	{
+		const FVector4f& Value = *static_cast<const FVector4f*>(ValuePtr);
+		OutValue = FLinearColor(Value.X, Value.Y, Value.Z, Value.W);
+	}
+	else
+	{
+		OutValue = *static_cast<const FLinearColor*>(ValuePtr);
+	}
+	return true;
+}
+
+bool FMGFXPropertyParameters::IsValidValueProperty(const FProperty* Property)
+{
+	if (CastField<FFloatProperty>(Property))
+	{
+		return true;
+	}
+
+	const FStructProperty* StructProperty = CastField<FStructProperty>(Property);
+	return StructProperty && (
+		StructProperty->Struct == TVariantStructure<FVector2f>::Get() ||
+		StructProperty->Struct == TVariantStructure<FVector3f>::Get() ||
+		StructProperty->Struct == TVariantStructure<FVector4f>::Get() ||
+		StructProperty->Struct == TBaseStructure<FLinearColor>::Get());
+}
+
+
+// FMGFXGeneratedExpressionGroup
+// -----------------------------
+
+bool FMGFXGeneratedExpressionGroup::IsValid(const TSet<UMaterialExpression*>& MaterialExpressions) const
+{
+	for (const TWeakObjectPtr<UMaterialExpression>& Expression : Expressions)
+	{
+		if (!Expression.IsValid() || !MaterialExpressions.Contains(Expression.Get()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// FMGFXMaterialGenerator
+// ----------------------
+
+
 FMGFXMaterialGenerator::FMGFXMaterialGenerator()
 	: NodePosBaselineLeft(GridSize * -64),
 	  Reroute_CanvasUVs(TEXT("CanvasUVs")),
@@ -32,9 +117,10 @@ FMGFXMaterialGenerator::FMGFXMaterialGenerator()
 	  Reroute_LayersOutput(TEXT("LayersOutput")),
 	  Param_LocationX(TEXT("LocationX")),
 	  Param_LocationY(TEXT("LocationY")),
-	  Param_Rotation(TEXT("Rotation")),
+	  Param_RotationAxis(TEXT("RotationAxis")),
 	  Param_ScaleX(TEXT("ScaleX")),
-	  Param_ScaleY(TEXT("ScaleY"))
+	  Param_ScaleY(TEXT("ScaleY")),
+	  Param_AnimationTime(TEXT("AnimationTime"))
 {
 }
 
@@ -45,20 +131,38 @@ void FMGFXMaterialGenerator::Generate(UMGFXMaterial* InMGFXMaterial, UMaterial*
 	check(InMGFXMaterial);
 	check(OutputMaterial);
 
+	// the material is notified once when finished, so expressions don't need to notify it of each property change
+	FMGFXScopedPropertyNotifyMode NotifyModeScope(EPropertyAccessChangeNotifyMode::Never);
+
 	MGFXMaterial = InMGFXMaterial;
 	bIsPreviewMaterial = bInIsPreviewMaterial;
 	Builder.SetMaterial(OutputMaterial, true);
 	Pos = FVector2D::ZeroVector;
+	ResetPackedParameter();
 
 	OutputMaterial->MaterialDomain = MGFXMaterial->MaterialDomain;
 	OutputMaterial->BlendMode = MGFXMaterial->BlendMode;
 
-	Builder.DeleteAll();
+	// delete everything except expressions for unchanged layers
+	PrepareReusableExpressions(OutputMaterial);
+
+	const double CreateExpressionsStartTime = FPlatformTime::Seconds();
 
 	AddWarningComment();
-	AddUVsBoilerplate();
 
-	GenerateLayers();
+	if (MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::HLSL)
+	{
+		GenerateLayersHLSL();
+	}
+	else if (MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		GenerateLayersInterpreted();
+	}
+	else
+	{
+		AddUVsBoilerplate();
+		GenerateLayers();
+	}
 
 	// build final output
 	Pos = FVector2D(GridSize * -31, 0);
@@ -90,664 +194,2577 @@ void FMGFXMaterialGenerator::Generate(UMGFXMaterial* InMGFXMaterial, UMaterial*
 		Builder.ConnectProperty(OutputUsageExp, "", MGFXMaterial->OutputProperty);
 	}
 
+	LastCreateExpressionsMs = (FPlatformTime::Seconds() - CreateExpressionsStartTime) * 1000.0;
+
+	// merge identical expressions from different layers, e.g. filter widths of siblings with the same transform.
+	// skipped for preview materials, to keep interactive regenerates fast.
+	if (!bIsPreviewMaterial)
+	{
+		TMap<UMaterialExpression*, UMaterialExpression*> MergedExpressions;
+		if (Builder.EliminateCommonSubexpressions(&MergedExpressions) > 0)
+		{
+			RemapMergedExpressions(MergedExpressions);
+		}
+	}
+
 	if (bRecompile)
 	{
 		SCOPED_NAMED_EVENT(FMGFXMaterialGenerator_Generate_Recompile, FColor::Green);
 		Builder.RecompileMaterial();
 	}
 
+	BuildPropertyParameters();
+
+	// store what the material was generated from, so it's not regenerated until something changes
+	SetStoredContentHash(OutputMaterial, bIsPreviewMaterial ? GetPreviewContentHash(MGFXMaterial) : GetContentHash(MGFXMaterial, false));
+	SetStoredSharedMaterialHashes(OutputMaterial, MGFXMaterial, !bIsPreviewMaterial && MGFXMaterial->UsesSharedMaterial());
+
+	// store the generated expressions so they can be reused next time
+	LastGenerated = nullptr;
+	GeneratedMaterials.Add(OutputMaterial, MoveTemp(NewGenerated));
+	NewGenerated = FMGFXGeneratedMaterial();
+	ReusableLayers.Reset();
+	bReuseBoilerplate = false;
+
 	// clear material references when finished
 	MGFXMaterial = nullptr;
-	Builder.Reset();
+	Builder.Reset(bNotifyMaterialWhenFinished);
 }
 
-void FMGFXMaterialGenerator::AddWarningComment()
+void FMGFXMaterialGenerator::ClearGeneratedCache()
 {
-	const FString Text = FString::Printf(TEXT("Generated by %s\nDo not edit manually"), *GetNameSafe(MGFXMaterial));
-
-	Pos = FVector2D(GridSize * -20, GridSize * -10);
-	UMaterialExpressionComment* CommentExp = Builder.CreateComment(Pos, Text, CommentColor);
+	GeneratedMaterials.Reset();
+	Builder.ClearExpressionPool();
 }
 
-void FMGFXMaterialGenerator::AddUVsBoilerplate()
+void FMGFXMaterialGenerator::GetParameterValues(UMGFXMaterial* InMGFXMaterial, TMap<FName, float>& OutScalarValues,
+                                                TMap<FName, FLinearColor>& OutVectorValues)
 {
-	Pos = FVector2D(GridSize * -64, GridSize * 30);
-
-	// create CanvasWidth and CanvasHeight scalar parameters
-	const FName ParamGroup("Canvas");
-	auto* CanvasAppendExp = GenerateVector2Parameter(MGFXMaterial->BaseCanvasSize,
-	                                                 FString(), ParamGroup, 0, "CanvasWidth", "CanvasHeight");
-
-	Pos.X += GridSize * 15;
+	check(InMGFXMaterial);
 
-	// create canvas tex cords with default UVs (for UI these will be 9-sliced)
-	UMaterialExpressionTextureCoordinate* TexCoordExp = Builder.Create<UMaterialExpressionTextureCoordinate>(Pos + FVector2D(0, GridSize * 8));
+	// generate without compiling, the parameter defaults are the values of the mgfx material
+	UMaterial* TransientMaterial = NewObject<UMaterial>(GetTransientPackage(), NAME_None, RF_Transient);
+	Generate(InMGFXMaterial, TransientMaterial, false, false);
 
-	Pos.X += GridSize * 15;
+	for (const TObjectPtr<UMaterialExpression>& Expression : TransientMaterial->GetExpressionCollection().Expressions)
+	{
+		if (const UMaterialExpressionScalarParameter* ScalarExp = Cast<UMaterialExpressionScalarParameter>(Expression))
+		{
+			OutScalarValues.Add(ScalarExp->ParameterName, ScalarExp->DefaultValue);
+		}
+		else if (const UMaterialExpressionVectorParameter* VectorExp = Cast<UMaterialExpressionVectorParameter>(Expression))
+		{
+			OutVectorValues.Add(VectorExp->ParameterName, VectorExp->DefaultValue);
+		}
+	}
 
-	// scale UVs to canvas size so all shapes can operate in canvas-dimensions
-	UMaterialExpressionMultiply* MultiplyExp = Builder.Create<UMaterialExpressionMultiply>(Pos);
-	Builder.Connect(CanvasAppendExp, "", MultiplyExp, "A");
-	Builder.Connect(TexCoordExp, "", MultiplyExp, "B");
+	GeneratedMaterials.Remove(TransientMaterial);
+}
 
-	Pos.X += GridSize * 15;
+void FMGFXMaterialGenerator::SetLivePreviewLayers(const TArray<const UMGFXMaterialLayer*>& Layers)
+{
+	bLimitLivePreviewLayers = true;
+	LivePreviewLayers.Reset();
+	for (const UMGFXMaterialLayer* Layer : Layers)
+	{
+		LivePreviewLayers.Add(Layer);
+	}
+}
 
-	// output to canvas UVs reroute
-	UMaterialExpressionNamedRerouteDeclaration* OutputRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_CanvasUVs);
-	Builder.Connect(MultiplyExp, OutputRerouteExp);
+void FMGFXMaterialGenerator::ClearLivePreviewLayers()
+{
+	bLimitLivePreviewLayers = false;
+	LivePreviewLayers.Reset();
+}
 
-	Pos.X += GridSize * 15;
+bool FMGFXMaterialGenerator::IsLivePreviewLayer(const UMGFXMaterialLayer* Layer) const
+{
+	return !bLimitLivePreviewLayers || LivePreviewLayers.Contains(Layer);
+}
 
-	// compute a reusable filter width based on canvas resolution
-	UMaterialExpression* FilterWidthExp;
+uint32 FMGFXMaterialGenerator::GetPreviewContentHash(const UMGFXMaterial* InMGFXMaterial) const
+{
+	uint32 Hash = GetContentHash(InMGFXMaterial, true);
 
-	if (MGFXMaterial->bComputeFilterWidth)
+	// the interpreted material is the same for all layers, live or not
+	if (bLimitLivePreviewLayers && InMGFXMaterial->GeneratorBackend != EMGFXMaterialGeneratorBackend::Interpreted)
 	{
-		// create filter width func
-		UMaterialExpressionMaterialFunctionCall* FilterWidthFuncExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("FilterWidth"));
-		Builder.Connect(OutputRerouteExp, FilterWidthFuncExp);
-
-		Pos.X += GridSize * 15;
-
-		FilterWidthExp = FilterWidthFuncExp;
+		TArray<UMGFXMaterialLayer*> AllLayers;
+		InMGFXMaterial->GetAllLayers(AllLayers);
+		for (const UMGFXMaterialLayer* Layer : AllLayers)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(IsLivePreviewLayer(Layer)));
+		}
 	}
-	else
-	{
-		UMaterialExpressionConstant* FilterWidthConstExp = Builder.Create<UMaterialExpressionConstant>(Pos);
-		SET_PROP(FilterWidthConstExp, R, MGFXMaterial->FixedFilterWidth);
+	return Hash;
+}
 
-		Pos.X += GridSize * 15;
+bool FMGFXMaterialGenerator::IsPreviewMaterialUpToDate(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material) const
+{
+	const uint32 StoredHash = GetStoredContentHash(Material);
+	return StoredHash != 0 && StoredHash == GetPreviewContentHash(InMGFXMaterial) && IsGeneratorVersionCurrent(Material);
+}
 
-		FilterWidthExp = FilterWidthConstExp;
-	}
+const FMGFXPackedParameterSlot* FMGFXMaterialGenerator::FindPackedParameter(UMaterial* Material, FName ParameterName) const
+{
+	const FMGFXGeneratedMaterial* Generated = GeneratedMaterials.Find(Material);
+	return Generated ? Generated->PackedParameters.Find(ParameterName) : nullptr;
+}
 
-	// add filter width reroute
-	UMaterialExpressionNamedRerouteDeclaration* FilterWidthRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_CanvasFilterWidth);
-	Builder.Connect(FilterWidthExp, FilterWidthRerouteExp);
+const FMGFXPropertyParameters* FMGFXMaterialGenerator::FindPropertyParameters(UMaterial* Material, const UObject* Object, FName PropertyName) const
+{
+	const FMGFXGeneratedMaterial* Generated = GeneratedMaterials.Find(Material);
+	return Generated ? Generated->PropertyParameters.Find(TPair<FObjectKey, FName>(Object, PropertyName)) : nullptr;
 }
 
-void FMGFXMaterialGenerator::GenerateLayers()
+void FMGFXMaterialGenerator::BuildPropertyParameters()
 {
-	Pos = FVector2D(NodePosBaselineLeft, GridSize * 80);
+	SCOPED_NAMED_EVENT(FMGFXMaterialGenerator_BuildPropertyParameters, FColor::Green);
 
-	// create base UVs
-	UMaterialExpressionNamedRerouteDeclaration* CanvasUVsDeclaration = Builder.FindNamedReroute(Reroute_CanvasUVs);
-	UMaterialExpressionNamedRerouteDeclaration* CanvasFilterWidthDeclaration = Builder.FindNamedReroute(Reroute_CanvasFilterWidth);
-	check(CanvasUVsDeclaration);
-	check(CanvasFilterWidthDeclaration);
+	// the interpreted material has no layer parameters, all values are in its layer data
+	if (MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted)
+	{
+		return;
+	}
 
-	const FMGFXMaterialUVsAndFilterWidth CanvasUVs(CanvasUVsDeclaration, CanvasFilterWidthDeclaration);
+	TArray<UMGFXMaterialLayer*> AllLayers;
+	MGFXMaterial->GetAllLayers(AllLayers);
 
-	// generate all layers recursively
-	FMGFXMaterialLayerOutputs LayerOutputs = FMGFXMaterialLayerOutputs();
-	for (int32 Idx = MGFXMaterial->RootLayers.Num() - 1; Idx >= 0; --Idx)
+	for (const UMGFXMaterialLayer* Layer : AllLayers)
 	{
-		const UMGFXMaterialLayer* ChildLayer = MGFXMaterial->RootLayers[Idx];
+		const FString ParamPrefix = GetLayerParamPrefix(Layer);
 
-		LayerOutputs = GenerateLayer(ChildLayer, CanvasUVs, LayerOutputs);
-	}
+		// static transforms are baked without parameters, and animated components are evaluated from their keys.
+		// the graph also skips identity components unless every value is parameterized, see GenerateTransformUVs.
+		// transform values are read from the layer, since rotation is converted before being set
+		if (IsTransformParameterized(Layer))
+		{
+			const FMGFXShapeTransform2D& Transform = Layer->Transform;
+			const bool bParameterizeIdentity = MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::HLSL ||
+				Transform.bAnimatable || ShouldParameterizeAllValues() || IsLayerLive(Layer);
 
-	Pos.X += GridSize * 15;
+			if (!FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location)) &&
+				(bParameterizeIdentity || !Transform.Location.IsZero()))
+			{
+				AddPropertyParameters(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location), EMGFXMaterialShapeInputType::Vector2,
+				                      ParamPrefix + Param_LocationX, ParamPrefix + Param_LocationY);
+			}
+			if (!FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation)) &&
+				(bParameterizeIdentity || !FMath::IsNearlyZero(Transform.Rotation)))
+			{
+				AddPropertyParameters(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation), EMGFXMaterialShapeInputType::Vector4,
+				                      ParamPrefix + Param_RotationAxis);
+			}
+			if (!FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale)) &&
+				(bParameterizeIdentity || Transform.Scale != FVector2f::One()))
+			{
+				AddPropertyParameters(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale), EMGFXMaterialShapeInputType::Vector2,
+				                      ParamPrefix + Param_ScaleX, ParamPrefix + Param_ScaleY);
+			}
+		}
 
-	// unpremult after all merges
-	UMaterialExpressionMaterialFunctionCall* UnpremultExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetUtil("Unpremult"));
-	Builder.Connect(LayerOutputs.VisualExp, UnpremultExp);
+		const UMGFXMaterialShape* Shape = Layer->Shape;
+		if (!Shape)
+		{
+			continue;
+		}
 
-	Pos.X += GridSize * 15;
+		for (const FMGFXMaterialShapeInput& Input : Shape->GetInputs())
+		{
+			if (Input.Type == EMGFXMaterialShapeInputType::Vector2)
+			{
+				AddPropertyParameters(Shape, FName(Input.Name), Input.Type, ParamPrefix + Input.Name + "X", ParamPrefix + Input.Name + "Y");
+			}
+			else
+			{
+				AddPropertyParameters(Shape, FName(Input.Name), Input.Type, ParamPrefix + Input.Name);
+			}
+		}
 
-	// connect to layers output reroute
-	UMaterialExpressionNamedRerouteDeclaration* OutputRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_LayersOutput, RGBARerouteColor);
-	Builder.Connect(UnpremultExp, OutputRerouteExp);
+		for (const UMGFXMaterialShapeVisual* Visual : Shape->Visuals)
+		{
+			const FString VisualParamPrefix = GetVisualParamPrefix(ParamPrefix, Visual);
+
+			if (Cast<UMGFXMaterialShapeFill>(Visual))
+			{
+				AddPropertyParameters(Visual, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeFill, Color), EMGFXMaterialShapeInputType::Vector4,
+				                      VisualParamPrefix + "Color");
+			}
+			else if (Cast<UMGFXMaterialShapeStroke>(Visual))
+			{
+				AddPropertyParameters(Visual, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, Color), EMGFXMaterialShapeInputType::Vector4,
+				                      VisualParamPrefix + "Color");
+				AddPropertyParameters(Visual, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, StrokeWidth), EMGFXMaterialShapeInputType::Float,
+				                      VisualParamPrefix + "StrokeWidth");
+			}
+		}
+	}
 }
 
-FMGFXMaterialLayerOutputs FMGFXMaterialGenerator::GenerateLayer(const UMGFXMaterialLayer* Layer,
-                                                                const FMGFXMaterialUVsAndFilterWidth& UVs, const FMGFXMaterialLayerOutputs& PrevOutputs)
+FMGFXPropertyParameters& FMGFXMaterialGenerator::AddPropertyParameters(const UObject* Object, FName PropertyName, EMGFXMaterialShapeInputType Type,
+                                                                       const FString& ParamName, const FString& ParamNameY)
 {
-	// collect expressions for this layers output
-	FMGFXMaterialLayerOutputs LayerOutputs;
+	FMGFXPropertyParameters& Parameters = NewGenerated.PropertyParameters.Add(TPair<FObjectKey, FName>(Object, PropertyName));
+	Parameters.Type = Type;
+	Parameters.ParameterNames[0] = FName(ParamName);
+	Parameters.ParameterNames[1] = ParamNameY.IsEmpty() ? NAME_None : FName(ParamNameY);
 
-	const FString LayerName = Layer->Name.IsEmpty() ? Layer->GetName() : Layer->Name;
-	const FString ParamPrefix = LayerName + ".";
-	const FName ParamGroup = FName(FString::Printf(TEXT("%s"), *LayerName));
+	// layer properties are nested in the transform, and are read by the editor instead
+	if (!Object->IsA<UMGFXMaterialLayer>())
+	{
+		const FProperty* Property = FindFProperty<FProperty>(Object->GetClass(), PropertyName);
+		Parameters.ValueProperty = FMGFXPropertyParameters::IsValidValueProperty(Property) ? Property : nullptr;
+	}
 
-	// reset baseline and move to new line
-	Pos.X = NodePosBaselineLeft;
-	Pos.Y += GridSize * 40;
+	return Parameters;
+}
 
+FMGFXMaterialCostReport FMGFXMaterialGenerator::CreateCostReport(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material) const
+{
+	SCOPED_NAMED_EVENT(FMGFXMaterialGenerator_CreateCostReport, FColor::Green);
 
-	// generate transform uvs
-	UMaterialExpressionNamedRerouteUsage* ParentUVsUsageExp = Builder.CreateNamedRerouteUsage(Pos, UVs.UVsExp);
+	check(InMGFXMaterial);
+	check(Material);
 
-	Pos.X += GridSize * 15;
+	FMGFXMaterialCostReport Report;
+	Report.MaterialName = Material->GetPathName();
+	Report.Backend = StaticEnum<EMGFXMaterialGeneratorBackend>()->GetNameStringByValue(static_cast<int64>(InMGFXMaterial->GeneratorBackend));
 
-	// apply layer transform. this may just return the parent uvs if optimized out
-	UMaterialExpression* UVsExp = GenerateTransformUVs(Layer->Transform, ParentUVsUsageExp, ParamPrefix, ParamGroup);
+	// this waits for the shaders to finish compiling
+	const FMaterialStatistics Statistics = UMaterialEditingLibrary::GetStatistics(Material);
+	Report.Total.NumInstructions = Statistics.NumPixelShaderInstructions;
+	Report.NumVertexShaderInstructions = Statistics.NumVertexShaderInstructions;
+	Report.NumSamplers = Statistics.NumSamplers;
 
-	// store as a reroute for any children
-	const bool bCreateReroute = Layer->HasLayers();
-	if (bCreateReroute)
+	for (const TObjectPtr<UMaterialExpression>& Expression : Material->GetExpressionCollection().Expressions)
 	{
-		// output to named reroute
-		LayerOutputs.UVs.UVsExp = Builder.CreateNamedReroute(Pos, FName(ParamPrefix + "UVs"));
-		Builder.Connect(UVsExp, "", LayerOutputs.UVs.UVsExp, "");
-		// treat this as the uvs expression for layer
-		UVsExp = LayerOutputs.UVs.UVsExp;
-
-		Pos.X += GridSize * 15;
+		Report.Total.AddExpression(Expression);
 	}
-	else
+
+	const FMGFXGeneratedMaterial* Generated = GeneratedMaterials.Find(Material);
+	if (!Generated)
 	{
-		// reuse parent UVs
-		LayerOutputs.UVs.UVsExp = UVs.UVsExp;
+		UE_LOG(LogMGFXEditor, Warning, TEXT("%s was not generated by this generator, layer costs are unknown."), *GetNameSafe(Material));
+		return Report;
 	}
 
-	// recalculate filter width to use for these uvs if the SDF gradient can ever be scaled
-	const bool bNoOptimization = Layer->Transform.bAnimatable || MGFXMaterial->bAllAnimatable || bIsPreviewMaterial;
-	const bool bHasModifiedScale = !(Layer->Transform.Scale - FVector2f::One()).IsNearlyZero();
-	if (MGFXMaterial->bComputeFilterWidth && (bNoOptimization || bHasModifiedScale))
-	{
-		UMaterialExpressionMaterialFunctionCall* UVFilterFuncExp = Builder.CreateFunction(
-			Pos + FVector2D(0, GridSize * 8), FMGFXMaterialFunctions::GetVisual("FilterWidth"));
+	AddLayerCosts(InMGFXMaterial->RootLayers, 0, Generated, Report);
 
-		Builder.Connect(UVsExp, "", UVFilterFuncExp, "");
+	// instructions can only be measured for the whole material, so attribute them to each layer by the number of operations
+	for (FMGFXMaterialLayerCost& LayerCost : Report.Layers)
+	{
+		LayerCost.NumInstructions = Report.Total.NumOperations > 0
+			                            ? FMath::RoundToInt32(static_cast<float>(Report.Total.NumInstructions) *
+				                            LayerCost.NumOperations / Report.Total.NumOperations)
+			                            : 0;
+	}
 
-		Pos.X += GridSize * 15;
+	return Report;
+}
 
-		LayerOutputs.UVs.FilterWidthExp = Builder.CreateNamedReroute(Pos + FVector2D(0, GridSize * 8), FName(ParamPrefix + "FilterWidth"));
-		Builder.Connect(UVFilterFuncExp, "", LayerOutputs.UVs.FilterWidthExp, "");
+uint32 FMGFXMaterialGenerator::GetLayerHash(const UMGFXMaterialLayer* Layer, bool bIncludeValues)
+{
+	check(Layer);
 
-		Pos.X += GridSize * 15;
+	// use case-sensitive hashes for names, since they are used for parameter names.
+	// the object name is only used by unnamed layers, and would prevent sharing materials between assets.
+	uint32 Hash = FCrc::StrCrc32(*Layer->Name);
+	if (bIncludeValues || Layer->Name.IsEmpty())
+	{
+		Hash = HashCombine(Hash, FCrc::StrCrc32(*Layer->GetName()));
 	}
-	else
+	Hash = HashCombine(Hash, GetTypeHash(Layer->MergeOperation));
+	Hash = HashCombine(Hash, GetTypeHash(Layer->HasLayers()));
+	if (bIncludeValues)
 	{
-		// reuse parent filter width
-		LayerOutputs.UVs.FilterWidthExp = UVs.FilterWidthExp;
+		Hash = HashCombine(Hash, GetTypeHash(Layer->Transform.bAnimatable));
+		Hash = HashCombine(Hash, GetTypeHash(Layer->Transform.Location));
+		Hash = HashCombine(Hash, GetTypeHash(Layer->Transform.Rotation));
+		Hash = HashCombine(Hash, GetTypeHash(Layer->Transform.Scale));
 	}
 
-	// generate children layers bottom to top
-	FMGFXMaterialLayerOutputs ChildOutputs = LayerOutputs;
-	for (int32 Idx = Layer->NumLayers() - 1; Idx >= 0; --Idx)
+	// animation keys are baked as constants, so they are always part of the structure
+	for (const FMGFXPropertyAnimation& Animation : Layer->Animations)
 	{
-		const UMGFXMaterialLayer* ChildLayer = Layer->GetLayer(Idx);
+		Hash = HashCombine(Hash, GetTypeHash(Animation.PropertyName));
+		Hash = HashCombine(Hash, GetTypeHash(Animation.VisualIndex));
+		Hash = HashCombine(Hash, GetTypeHash(Animation.bLoop));
+		for (const FMGFXAnimationKey& Key : Animation.Keys)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(Key.Time));
+			Hash = HashCombine(Hash, GetTypeHash(Key.Value));
+			Hash = HashCombine(Hash, GetTypeHash(Key.InterpMode));
+		}
+	}
 
-		ChildOutputs = GenerateLayer(ChildLayer, LayerOutputs.UVs, ChildOutputs);
+	const UMGFXMaterialShape* Shape = Layer->Shape;
+	if (!Shape)
+	{
+		return Hash;
 	}
 
+	Hash = HashCombine(Hash, FCrc::StrCrc32(*Shape->GetMaterialFunctionPtr().ToString()));
+	Hash = HashCombine(Hash, GetTypeHash(Shape->ShapeMergeOperation));
+	Hash = HashCombine(Hash, GetTypeHash(Shape->ShapeMergeSmoothness));
 
-	// generate shape for this layer
-	if (Layer->Shape)
+	for (const FMGFXMaterialShapeInput& Input : Shape->GetInputs())
 	{
-		// the shape, with an SDF output
-		LayerOutputs.ShapeExp = GenerateShape(Layer->Shape, UVsExp, ParamPrefix, ParamGroup);
-
-		// the shape visuals, including all fills and strokes
-		LayerOutputs.VisualExp = GenerateShapeVisuals(Layer->Shape, LayerOutputs.ShapeExp,
-		                                              LayerOutputs.UVs.FilterWidthExp, ParamPrefix, ParamGroup);
+		Hash = HashCombine(Hash, FCrc::StrCrc32(*Input.Name));
+		Hash = HashCombine(Hash, GetTypeHash(Input.Type));
+		if (bIncludeValues)
+		{
+			Hash = HashCombine(Hash, GetTypeHash(Input.Value));
+			Hash = HashCombine(Hash, GetTypeHash(Shape->IsInputExposed(Input.Name)));
+		}
 	}
 
-	// merge this layer with its children
-	if (Layer->HasLayers())
+	for (const UMGFXMaterialShapeVisual* Visual : Shape->Visuals)
 	{
-		if (ChildOutputs.VisualExp && ChildOutputs.VisualExp != LayerOutputs.VisualExp)
+		if (const UMGFXMaterialShapeFill* Fill = Cast<UMGFXMaterialShapeFill>(Visual))
 		{
-			if (LayerOutputs.VisualExp)
+			Hash = HashCombine(Hash, FCrc::StrCrc32(TEXT("Fill")));
+			Hash = HashCombine(Hash, GetTypeHash(Fill->bEnableFilterBias));
+			Hash = HashCombine(Hash, GetTypeHash(Fill->bComputeFilterWidth));
+			if (bIncludeValues)
 			{
-				LayerOutputs.VisualExp = GenerateMergeVisual(LayerOutputs.VisualExp, ChildOutputs.VisualExp,
-				                                             Layer->MergeOperation, ParamPrefix, ParamGroup);
+				Hash = HashCombine(Hash, GetTypeHash(Fill->Color));
 			}
-			else
+		}
+		else if (const UMGFXMaterialShapeStroke* Stroke = Cast<UMGFXMaterialShapeStroke>(Visual))
+		{
+			Hash = HashCombine(Hash, FCrc::StrCrc32(TEXT("Stroke")));
+			if (bIncludeValues)
 			{
-				// pass forward output from previous layer to ensure it makes it to the top
-				LayerOutputs.VisualExp = ChildOutputs.VisualExp;
+				Hash = HashCombine(Hash, GetTypeHash(Stroke->Color));
+				Hash = HashCombine(Hash, GetTypeHash(Stroke->StrokeWidth));
 			}
+			Hash = HashCombine(Hash, GetTypeHash(Stroke->bComputeFilterWidth));
 		}
 	}
 
+	return Hash;
+}
 
-	// merge this layer with the previous sibling
-	if (PrevOutputs.ShapeExp && LayerOutputs.ShapeExp)
-	{
-		// TODO: this is weird, just setup explicit shape merging by layer reference, so the layer structure remains only for visuals
-		LayerOutputs.ShapeExp = GenerateMergeShapes(PrevOutputs.ShapeExp, LayerOutputs.ShapeExp,
-		                                            Layer->Shape->ShapeMergeOperation, ParamPrefix, ParamGroup);
-	}
+uint32 FMGFXMaterialGenerator::GetContentHash(const UMGFXMaterial* InMGFXMaterial, bool bInIsPreviewMaterial)
+{
+	check(InMGFXMaterial);
 
-	if (PrevOutputs.VisualExp)
+	// the generator version isn't included, so that shared materials are regenerated in place when it changes
+	uint32 Hash = GetSettingsHash(InMGFXMaterial, bInIsPreviewMaterial);
+
+	// the interpreted material doesn't depend on the canvas or layers, which are stored in its layer data
+	if (InMGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Interpreted)
 	{
-		if (LayerOutputs.VisualExp)
-		{
-			LayerOutputs.VisualExp = GenerateMergeVisual(LayerOutputs.VisualExp, PrevOutputs.VisualExp,
-			                                             Layer->MergeOperation, ParamPrefix, ParamGroup);
-		}
-		else
+		Hash = HashCombine(Hash, GetTypeHash(GetPathNameSafe(InMGFXMaterial->PackedLayersTexture)));
+
+		// the preview gets its layer data from a dynamic instance, but the layer data texture of the target material
+		// is out of date whenever the packed layers or their format change
+		if (!bInIsPreviewMaterial)
 		{
-			// pass forward output from previous layer to ensure it makes it to the top
-			LayerOutputs.VisualExp = PrevOutputs.VisualExp;
+			FMGFXPackedLayers PackedLayers;
+			FMGFXLayerPacker::Pack(InMGFXMaterial, PackedLayers);
+			Hash = HashCombine(Hash, GetTypeHash(FMGFXPackedLayers::Version));
+			Hash = HashCombine(Hash, PackedLayers.GetTexelsHash());
 		}
+		return Hash;
 	}
 
-	return LayerOutputs;
+	// shared materials only depend on the structure of the layers, their values are set by material instances
+	const bool bIncludeValues = bInIsPreviewMaterial || !InMGFXMaterial->UsesSharedMaterial();
+	Hash = HashCombine(Hash, GetBoilerplateHash(InMGFXMaterial, bIncludeValues));
+	Hash = HashCombine(Hash, GetLayersContentHash(InMGFXMaterial->RootLayers, bIncludeValues));
+	return Hash;
 }
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateTransformUVs(const FMGFXShapeTransform2D& Transform, UMaterialExpression* InUVsExp,
-                                                                  const FString& ParamPrefix, const FName& ParamGroup)
+FString FMGFXMaterialGenerator::GetSharedMaterialName(const UMGFXMaterial* InMGFXMaterial)
 {
-	// points to the last expression from each operation, since some may be skipped due to optimization
-	UMaterialExpression* LastInputExp = InUVsExp;
+	return FString::Printf(TEXT("M_MGFX_%08X"), GetContentHash(InMGFXMaterial, false));
+}
+
+uint32 FMGFXMaterialGenerator::GetStoredContentHash(UMaterial* Material)
+{
+	const UMGFXGeneratedMaterialUserData* UserData = Material ? Material->GetAssetUserData<UMGFXGeneratedMaterialUserData>() : nullptr;
+	return UserData ? UserData->ContentHash : 0;
+}
+
+bool FMGFXMaterialGenerator::IsGeneratorVersionCurrent(UMaterial* Material)
+{
+	const UMGFXGeneratedMaterialUserData* UserData = Material ? Material->GetAssetUserData<UMGFXGeneratedMaterialUserData>() : nullptr;
+	return UserData && UserData->GeneratorVersion == GeneratorVersion;
+}
+
+bool FMGFXMaterialGenerator::HasSameContent(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material, bool bInIsPreviewMaterial)
+{
+	const uint32 StoredHash = GetStoredContentHash(Material);
+	return StoredHash != 0 && StoredHash == GetContentHash(InMGFXMaterial, bInIsPreviewMaterial);
+}
+
+bool FMGFXMaterialGenerator::IsMaterialUpToDate(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material, bool bInIsPreviewMaterial)
+{
+	return HasSameContent(InMGFXMaterial, Material, bInIsPreviewMaterial) && IsGeneratorVersionCurrent(Material);
+}
+
+void FMGFXMaterialGenerator::SetStoredContentHash(UMaterial* Material, uint32 ContentHash)
+{
+	UMGFXGeneratedMaterialUserData* UserData = Material->GetAssetUserData<UMGFXGeneratedMaterialUserData>();
+	if (!UserData)
+	{
+		UserData = NewObject<UMGFXGeneratedMaterialUserData>(Material, NAME_None, RF_Transactional);
+		Material->AddAssetUserData(UserData);
+	}
+
+	UserData->ContentHash = ContentHash;
+	UserData->GeneratorVersion = GeneratorVersion;
+}
+
+void FMGFXMaterialGenerator::SetStoredSharedMaterialHashes(UMaterial* Material, const UMGFXMaterial* InMGFXMaterial, bool bIsShared)
+{
+	UMGFXGeneratedMaterialUserData* UserData = Material->GetAssetUserData<UMGFXGeneratedMaterialUserData>();
+	check(UserData);
+
+	UserData->bIsSharedMaterial = bIsShared;
+	UserData->SettingsHash = bIsShared ? GetSettingsHash(InMGFXMaterial, false) : 0;
+	UserData->BoilerplateHash = bIsShared ? GetBoilerplateHash(InMGFXMaterial, false) : 0;
+	UserData->LayersHash = bIsShared ? GetLayersContentHash(InMGFXMaterial->RootLayers, false) : 0;
+}
+
+bool FMGFXMaterialGenerator::IsSharedMaterial(UMaterial* Material)
+{
+	const UMGFXGeneratedMaterialUserData* UserData = Material ? Material->GetAssetUserData<UMGFXGeneratedMaterialUserData>() : nullptr;
+	return UserData && UserData->bIsSharedMaterial;
+}
+
+bool FMGFXMaterialGenerator::CanReuseSharedMaterial(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material)
+{
+	check(InMGFXMaterial);
+
+	// materials that were created but never generated can be used by any structure
+	const UMGFXGeneratedMaterialUserData* UserData = Material ? Material->GetAssetUserData<UMGFXGeneratedMaterialUserData>() : nullptr;
+	if (!UserData || UserData->ContentHash == 0)
+	{
+		return Material != nullptr;
+	}
+
+	// compare each hash separately, since different structures with the same combined hash also have the same name
+	return UserData->bIsSharedMaterial &&
+		UserData->ContentHash == GetContentHash(InMGFXMaterial, false) &&
+		UserData->SettingsHash == GetSettingsHash(InMGFXMaterial, false) &&
+		UserData->BoilerplateHash == GetBoilerplateHash(InMGFXMaterial, false) &&
+		UserData->LayersHash == GetLayersContentHash(InMGFXMaterial->RootLayers, false);
+}
+
+uint32 FMGFXMaterialGenerator::GetSettingsHash(const UMGFXMaterial* InMGFXMaterial, bool bInIsPreviewMaterial)
+{
+	uint32 Hash = GetTypeHash(bInIsPreviewMaterial);
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->MaterialDomain.GetValue()));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->BlendMode.GetValue()));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->OutputProperty.GetValue()));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->DefaultEmissiveColor));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->GeneratorBackend));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->bAllAnimatable));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->bComputeFilterWidth));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->bEnableBoundsBranching));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->bPackParameters));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->UsesSharedMaterial()));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->AnimationTimeSource));
+	return Hash;
+}
+
+uint32 FMGFXMaterialGenerator::GetBoilerplateHash(const UMGFXMaterial* InMGFXMaterial, bool bIncludeValues)
+{
+	uint32 Hash = bIncludeValues ? GetTypeHash(InMGFXMaterial->BaseCanvasSize) : 0;
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->bComputeFilterWidth));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->FixedFilterWidth));
+	Hash = HashCombine(Hash, GetTypeHash(InMGFXMaterial->bPackParameters));
+	return Hash;
+}
+
+uint32 FMGFXMaterialGenerator::GetLayersContentHash(const TArray<TObjectPtr<UMGFXMaterialLayer>>& Layers, bool bIncludeValues)
+{
+	uint32 Hash = GetTypeHash(Layers.Num());
+	for (const UMGFXMaterialLayer* Layer : Layers)
+	{
+		if (!Layer)
+		{
+			continue;
+		}
+
+		Hash = HashCombine(Hash, GetLayerHash(Layer, bIncludeValues));
+		Hash = HashCombine(Hash, GetLayersContentHash(Layer->GetLayers(), bIncludeValues));
+	}
+	return Hash;
+}
+
+bool FMGFXMaterialGenerator::IsLayerLive(const UMGFXMaterialLayer* Layer) const
+{
+	return bIsPreviewMaterial && IsLivePreviewLayer(Layer);
+}
+
+bool FMGFXMaterialGenerator::IsTransformParameterized(const UMGFXMaterialLayer* Layer) const
+{
+	return Layer->Transform.bAnimatable || Layer->IsTransformAnimated() || ShouldParameterizeAllValues() || IsLayerLive(Layer);
+}
+
+uint32 FMGFXMaterialGenerator::GetGeneratedLayerHash(const UMGFXMaterialLayer* Layer) const
+{
+	// layers that are reparented must be regenerated, since they use the parent layer's uvs.
+	// layers merged with the shape above don't generate visuals, so they must be regenerated when that changes.
+	// layers that become live or optimized in the preview must be regenerated with or without parameters.
+	uint32 Hash = HashCombine(GetLayerHash(Layer), GetTypeHash(Layer->GetParentLayer()));
+	Hash = HashCombine(Hash, GetTypeHash(IsLayerLive(Layer)));
+	return HashCombine(Hash, GetTypeHash(IsShapeMergedWithNext(Layer)));
+}
+
+void FMGFXMaterialGenerator::PrepareReusableExpressions(UMaterial* OutputMaterial)
+{
+	// forget any materials that no longer exist
+	for (auto It = GeneratedMaterials.CreateIterator(); It; ++It)
+	{
+		if (!It->Key.IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	NewGenerated = FMGFXGeneratedMaterial();
+	NewGenerated.SettingsHash = GetSettingsHash(MGFXMaterial, bIsPreviewMaterial);
+	NewGenerated.BoilerplateHash = GetBoilerplateHash(MGFXMaterial);
+	ReusableLayers.Reset();
+	bReuseBoilerplate = false;
+	RelocatedExpressions.Reset();
+
+	TSet<UMaterialExpression*> KeepExpressions;
+
+	// the hlsl backend generates everything in a single expression, so there is nothing to reuse
+	const bool bIsGraphBackend = MGFXMaterial->GeneratorBackend == EMGFXMaterialGeneratorBackend::Graph;
+
+	LastGenerated = GeneratedMaterials.Find(OutputMaterial);
+	if (bIsGraphBackend && LastGenerated && LastGenerated->SettingsHash == NewGenerated.SettingsHash)
+	{
+		// the material may have been modified externally, so only reuse expressions that still exist
+		TSet<UMaterialExpression*> MaterialExpressions;
+		for (const TObjectPtr<UMaterialExpression>& Expression : OutputMaterial->GetExpressionCollection().Expressions)
+		{
+			MaterialExpressions.Add(Expression);
+		}
+
+		// all root layers depend on the boilerplate uvs, so nothing can be reused without it
+		bReuseBoilerplate = LastGenerated->BoilerplateHash == NewGenerated.BoilerplateHash &&
+			LastGenerated->BoilerplateGroup.IsValid(MaterialExpressions);
+
+		if (bReuseBoilerplate)
+		{
+			for (const TWeakObjectPtr<UMaterialExpression>& Expression : LastGenerated->BoilerplateGroup.Expressions)
+			{
+				KeepExpressions.Add(Expression.Get());
+			}
+
+			FindReusableLayers(MGFXMaterial->RootLayers, true, MaterialExpressions, KeepExpressions);
+		}
+	}
+
+	Builder.DeleteAllExcept(KeepExpressions);
+}
+
+void FMGFXMaterialGenerator::FindReusableLayers(const TArray<TObjectPtr<UMGFXMaterialLayer>>& Layers, bool bIsParentReusable,
+                                                const TSet<UMaterialExpression*>& MaterialExpressions, TSet<UMaterialExpression*>& OutKeepExpressions)
+{
+	if (!bIsParentReusable)
+	{
+		// children use the parent uvs, and can't be reused if the parent is regenerated
+		return;
+	}
+
+	for (const UMGFXMaterialLayer* Layer : Layers)
+	{
+		const FMGFXGeneratedLayer* GeneratedLayer = LastGenerated->Layers.Find(Layer);
+
+		// shapes merged with the shape below depend on it, which may be regenerated
+		const bool bIsMergedShape = Layer->Shape && Layer->Shape->ShapeMergeOperation != EMGFXShapeMergeOperation::None;
+
+		const bool bIsReusable = GeneratedLayer && !bIsMergedShape &&
+			GeneratedLayer->Hash == GetGeneratedLayerHash(Layer) &&
+			GeneratedLayer->TransformGroup.IsValid(MaterialExpressions) &&
+			GeneratedLayer->ShapeGroup.IsValid(MaterialExpressions);
+
+		if (bIsReusable)
+		{
+			ReusableLayers.Add(Layer);
+
+			for (const TWeakObjectPtr<UMaterialExpression>& Expression : GeneratedLayer->TransformGroup.Expressions)
+			{
+				OutKeepExpressions.Add(Expression.Get());
+			}
+			for (const TWeakObjectPtr<UMaterialExpression>& Expression : GeneratedLayer->ShapeGroup.Expressions)
+			{
+				OutKeepExpressions.Add(Expression.Get());
+			}
+		}
+
+		FindReusableLayers(Layer->GetLayers(), bIsReusable, MaterialExpressions, OutKeepExpressions);
+	}
+}
+
+void FMGFXMaterialGenerator::RelocateExpressionGroup(FMGFXGeneratedExpressionGroup& Group)
+{
+	const FVector2D Offset = Pos - Group.StartPos;
+	if (!Offset.IsNearlyZero())
+	{
+		for (const TWeakObjectPtr<UMaterialExpression>& Expression : Group.Expressions)
+		{
+			// expressions shared by several groups are only moved with the first
+			bool bIsAlreadyRelocated = false;
+			RelocatedExpressions.Add(Expression.Get(), &bIsAlreadyRelocated);
+			if (!bIsAlreadyRelocated)
+			{
+				Builder.MoveExpression(Expression.Get(), Offset);
+			}
+		}
+	}
+
+	Group.StartPos += Offset;
+	Group.EndPos += Offset;
+	Pos = Group.EndPos;
+
+	NewGenerated.PackedParameters.Append(Group.PackedParameters);
+}
+
+void FMGFXMaterialGenerator::RemapMergedExpressions(const TMap<UMaterialExpression*, UMaterialExpression*>& MergedExpressions)
+{
+	RemapGroupExpressions(NewGenerated.BoilerplateGroup, MergedExpressions);
+
+	for (TPair<TWeakObjectPtr<const UMGFXMaterialLayer>, FMGFXGeneratedLayer>& Elem : NewGenerated.Layers)
+	{
+		FMGFXGeneratedLayer& GeneratedLayer = Elem.Value;
+		RemapGroupExpressions(GeneratedLayer.TransformGroup, MergedExpressions);
+		RemapGroupExpressions(GeneratedLayer.ShapeGroup, MergedExpressions);
+		RemapGroupExpressions(GeneratedLayer.MergeGroup, MergedExpressions);
+
+		// outputs are connected to by reused layers
+		if (UMaterialExpression* const* ShapeExp = MergedExpressions.Find(GeneratedLayer.Outputs.ShapeExp))
+		{
+			GeneratedLayer.Outputs.ShapeExp = *ShapeExp;
+		}
+		if (UMaterialExpression* const* VisualExp = MergedExpressions.Find(GeneratedLayer.Outputs.VisualExp))
+		{
+			GeneratedLayer.Outputs.VisualExp = *VisualExp;
+		}
+	}
+}
+
+void FMGFXMaterialGenerator::RemapGroupExpressions(FMGFXGeneratedExpressionGroup& Group,
+                                                   const TMap<UMaterialExpression*, UMaterialExpression*>& MergedExpressions)
+{
+	TArray<TWeakObjectPtr<UMaterialExpression>> RemappedExpressions;
+	RemappedExpressions.Reserve(Group.Expressions.Num());
+	for (const TWeakObjectPtr<UMaterialExpression>& Expression : Group.Expressions)
+	{
+		UMaterialExpression* const* Replacement = MergedExpressions.Find(Expression.Get());
+		RemappedExpressions.AddUnique(Replacement ? TWeakObjectPtr<UMaterialExpression>(*Replacement) : Expression);
+	}
+	Group.Expressions = MoveTemp(RemappedExpressions);
+}
+
+void FMGFXMaterialGenerator::BeginExpressionGroup(FMGFXGeneratedExpressionGroup& Group)
+{
+	Group.StartPos = Pos;
+	Builder.BeginRecording(Group.Expressions);
+	RecordingGroup = &Group;
+
+	// groups are reused independently, so they can't share packed parameters
+	ResetPackedParameter();
+}
+
+void FMGFXMaterialGenerator::EndExpressionGroup(FMGFXGeneratedExpressionGroup& Group)
+{
+	Builder.EndRecording();
+	Group.EndPos = Pos;
+	RecordingGroup = nullptr;
+	ResetPackedParameter();
+}
+
+void FMGFXMaterialGenerator::AddLayerCosts(const TArray<TObjectPtr<UMGFXMaterialLayer>>& Layers, int32 Depth,
+                                           const FMGFXGeneratedMaterial* Generated, FMGFXMaterialCostReport& Report) const
+{
+	for (const UMGFXMaterialLayer* Layer : Layers)
+	{
+		FMGFXMaterialLayerCost LayerCost;
+		LayerCost.LayerName = GetLayerParamName(Layer);
+		LayerCost.Depth = Depth;
+
+		if (const FMGFXGeneratedLayer* GeneratedLayer = Generated->Layers.Find(Layer))
+		{
+			for (const FMGFXGeneratedExpressionGroup* Group : {&GeneratedLayer->TransformGroup, &GeneratedLayer->ShapeGroup, &GeneratedLayer->MergeGroup})
+			{
+				for (const TWeakObjectPtr<UMaterialExpression>& Expression : Group->Expressions)
+				{
+					LayerCost.AddExpression(Expression.Get());
+				}
+			}
+
+			// generated HLSL is part of a single expression, so count each layer's code separately
+			LayerCost.NumFunctionCalls += GeneratedLayer->NumHLSLFunctionCalls;
+			LayerCost.NumOperations += GeneratedLayer->NumHLSLFunctionCalls;
+		}
+
+		Report.Layers.Add(LayerCost);
+
+		AddLayerCosts(Layer->GetLayers(), Depth + 1, Generated, Report);
+	}
+}
+
+void FMGFXMaterialGenerator::GetInverseTransformRows(const FTransform2D& Transform, FVector2f& OutAxisX, FVector2f& OutAxisY, FVector2f& OutOffset)
+{
+	// shapes are evaluated in local space, so the uvs are transformed by the inverse
+	const FTransform2D InvTransform = Transform.Inverse();
+	OutOffset = FVector2f(InvTransform.TransformPoint(FVector2D::ZeroVector));
+	OutAxisX = FVector2f(InvTransform.TransformPoint(FVector2D(1.f, 0.f))) - OutOffset;
+	OutAxisY = FVector2f(InvTransform.TransformPoint(FVector2D(0.f, 1.f))) - OutOffset;
+}
+
+void FMGFXMaterialGenerator::AddWarningComment()
+{
+	const FString Text = FString::Printf(TEXT("Generated by %s\nDo not edit manually"), *GetNameSafe(MGFXMaterial));
+
+	Pos = FVector2D(GridSize * -20, GridSize * -10);
+	UMaterialExpressionComment* CommentExp = Builder.CreateComment(Pos, Text, CommentColor);
+}
+
+void FMGFXMaterialGenerator::AddUVsBoilerplate()
+{
+	Pos = FVector2D(GridSize * -64, GridSize * 30);
+
+	if (bReuseBoilerplate)
+	{
+		NewGenerated.BoilerplateGroup = LastGenerated->BoilerplateGroup;
+		RelocateExpressionGroup(NewGenerated.BoilerplateGroup);
+		return;
+	}
+
+	BeginExpressionGroup(NewGenerated.BoilerplateGroup);
+
+	// create CanvasWidth and CanvasHeight scalar parameters
+	const FName ParamGroup("Canvas");
+	auto* CanvasAppendExp = GenerateVector2Parameter(MGFXMaterial->BaseCanvasSize,
+	                                                 FString(), ParamGroup, 0, "CanvasWidth", "CanvasHeight");
+
+	Pos.X += GridSize * 15;
+
+	// create canvas tex cords with default UVs (for UI these will be 9-sliced)
+	UMaterialExpressionTextureCoordinate* TexCoordExp = Builder.Create<UMaterialExpressionTextureCoordinate>(Pos + FVector2D(0, GridSize * 8));
+
+	Pos.X += GridSize * 15;
+
+	// scale UVs to canvas size so all shapes can operate in canvas-dimensions
+	UMaterialExpressionMultiply* MultiplyExp = Builder.Create<UMaterialExpressionMultiply>(Pos);
+	Builder.Connect(CanvasAppendExp, "", MultiplyExp, "A");
+	Builder.Connect(TexCoordExp, "", MultiplyExp, "B");
+
+	Pos.X += GridSize * 15;
+
+	// output to canvas UVs reroute
+	UMaterialExpressionNamedRerouteDeclaration* OutputRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_CanvasUVs);
+	Builder.Connect(MultiplyExp, OutputRerouteExp);
+
+	Pos.X += GridSize * 15;
+
+	// compute a reusable filter width based on canvas resolution
+	UMaterialExpression* FilterWidthExp;
+
+	if (MGFXMaterial->bComputeFilterWidth)
+	{
+		// create filter width func
+		UMaterialExpressionMaterialFunctionCall* FilterWidthFuncExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("FilterWidth"));
+		Builder.Connect(OutputRerouteExp, FilterWidthFuncExp);
+
+		Pos.X += GridSize * 15;
+
+		FilterWidthExp = FilterWidthFuncExp;
+	}
+	else
+	{
+		UMaterialExpressionConstant* FilterWidthConstExp = Builder.Create<UMaterialExpressionConstant>(Pos);
+		SET_PROP(FilterWidthConstExp, R, MGFXMaterial->FixedFilterWidth);
+
+		Pos.X += GridSize * 15;
+
+		FilterWidthExp = FilterWidthConstExp;
+	}
+
+	// add filter width reroute
+	UMaterialExpressionNamedRerouteDeclaration* FilterWidthRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_CanvasFilterWidth);
+	Builder.Connect(FilterWidthExp, FilterWidthRerouteExp);
+
+	EndExpressionGroup(NewGenerated.BoilerplateGroup);
+}
+
+void FMGFXMaterialGenerator::GenerateLayers()
+{
+	Pos = FVector2D(NodePosBaselineLeft, GridSize * 80);
+
+	// create base UVs
+	UMaterialExpressionNamedRerouteDeclaration* CanvasUVsDeclaration = Builder.FindNamedReroute(Reroute_CanvasUVs);
+	UMaterialExpressionNamedRerouteDeclaration* CanvasFilterWidthDeclaration = Builder.FindNamedReroute(Reroute_CanvasFilterWidth);
+	check(CanvasUVsDeclaration);
+	check(CanvasFilterWidthDeclaration);
+
+	FMGFXMaterialUVsAndFilterWidth CanvasUVs;
+	CanvasUVs.UVsExp = CanvasUVsDeclaration;
+	CanvasUVs.FilterWidthExp = CanvasFilterWidthDeclaration;
+	CanvasUVs.BaseUVsExp = CanvasUVsDeclaration;
+
+	// generate all layers recursively
+	FMGFXMaterialLayerOutputs LayerOutputs = FMGFXMaterialLayerOutputs();
+	for (int32 Idx = MGFXMaterial->RootLayers.Num() - 1; Idx >= 0; --Idx)
+	{
+		const UMGFXMaterialLayer* ChildLayer = MGFXMaterial->RootLayers[Idx];
+
+		LayerOutputs = GenerateLayer(ChildLayer, CanvasUVs, LayerOutputs);
+	}
+
+	Pos.X += GridSize * 15;
+
+	// unpremult after all merges
+	UMaterialExpressionMaterialFunctionCall* UnpremultExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetUtil("Unpremult"));
+	Builder.Connect(LayerOutputs.VisualExp, UnpremultExp);
+
+	Pos.X += GridSize * 15;
+
+	// connect to layers output reroute
+	UMaterialExpressionNamedRerouteDeclaration* OutputRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_LayersOutput, RGBARerouteColor);
+	Builder.Connect(UnpremultExp, OutputRerouteExp);
+}
+
+FMGFXMaterialLayerOutputs FMGFXMaterialGenerator::GenerateLayer(const UMGFXMaterialLayer* Layer,
+                                                                const FMGFXMaterialUVsAndFilterWidth& UVs, const FMGFXMaterialLayerOutputs& PrevOutputs)
+{
+	// collect expressions for this layers output
+	FMGFXMaterialLayerOutputs LayerOutputs;
+
+	const FString LayerName = GetLayerParamName(Layer);
+	const FString ParamPrefix = GetLayerParamPrefix(Layer);
+	const FName ParamGroup = FName(FString::Printf(TEXT("%s"), *LayerName));
+
+	// reset baseline and move to new line
+	Pos.X = NodePosBaselineLeft;
+	Pos.Y += GridSize * 40;
+
+	// reuse the previously generated expressions if nothing has changed
+	FMGFXGeneratedLayer GeneratedLayer;
+	GeneratedLayer.Hash = GetGeneratedLayerHash(Layer);
+	const FMGFXGeneratedLayer* ReusedLayer = ReusableLayers.Contains(Layer) ? LastGenerated->Layers.Find(Layer) : nullptr;
+
+	// the uvs to use for this layer's shape
+	UMaterialExpression* UVsExp = nullptr;
+
+	if (ReusedLayer)
+	{
+		GeneratedLayer.TransformGroup = ReusedLayer->TransformGroup;
+		RelocateExpressionGroup(GeneratedLayer.TransformGroup);
+		LayerOutputs.UVs = ReusedLayer->Outputs.UVs;
+	}
+	else
+	{
+		BeginExpressionGroup(GeneratedLayer.TransformGroup);
+
+		const bool bIsLive = IsLayerLive(Layer);
+		const bool bNoOptimization = IsTransformParameterized(Layer);
+		if (bNoOptimization)
+		{
+			// generate transform uvs
+			UMaterialExpressionNamedRerouteUsage* ParentUVsUsageExp = Builder.CreateNamedRerouteUsage(Pos, UVs.UVsExp);
+
+			Pos.X += GridSize * 15;
+
+			// apply layer transform using parameters
+			UVsExp = GenerateTransformUVs(Layer->Transform, ParentUVsUsageExp, ParamPrefix, ParamGroup, bIsLive, Layer);
+		}
+		else
+		{
+			// bake the transform of this layer and all static parents into one transform, relative to the nearest animatable uvs
+			LayerOutputs.UVs.BaseUVsExp = UVs.BaseUVsExp;
+			LayerOutputs.UVs.BaseTransform = Layer->Transform.ToTransform2D().Concatenate(UVs.BaseTransform);
+
+			UMaterialExpressionNamedRerouteUsage* BaseUVsUsageExp = Builder.CreateNamedRerouteUsage(Pos, UVs.BaseUVsExp);
+
+			Pos.X += GridSize * 15;
+
+			// this may just return the base uvs if the transform is identity
+			UVsExp = GenerateStaticTransformUVs(LayerOutputs.UVs.BaseTransform, BaseUVsUsageExp);
+		}
+
+		// store as a reroute for any children
+		const bool bCreateReroute = Layer->HasLayers();
+		if (bCreateReroute)
+		{
+			// output to named reroute
+			LayerOutputs.UVs.UVsExp = Builder.CreateNamedReroute(Pos, FName(ParamPrefix + "UVs"));
+			Builder.Connect(UVsExp, "", LayerOutputs.UVs.UVsExp, "");
+			// treat this as the uvs expression for layer
+			UVsExp = LayerOutputs.UVs.UVsExp;
+
+			Pos.X += GridSize * 15;
+		}
+		else
+		{
+			// reuse parent UVs
+			LayerOutputs.UVs.UVsExp = UVs.UVsExp;
+		}
+
+		if (bNoOptimization)
+		{
+			// static children bake their transforms relative to these uvs
+			LayerOutputs.UVs.BaseUVsExp = LayerOutputs.UVs.UVsExp;
+			LayerOutputs.UVs.BaseTransform = FTransform2D();
+		}
+
+		// recalculate filter width to use for these uvs if the SDF gradient can ever be scaled
+		const bool bHasModifiedScale = !(Layer->Transform.Scale - FVector2f::One()).IsNearlyZero();
+		if (MGFXMaterial->bComputeFilterWidth && (bNoOptimization || bHasModifiedScale))
+		{
+			UMaterialExpressionMaterialFunctionCall* UVFilterFuncExp = Builder.CreateFunction(
+				Pos + FVector2D(0, GridSize * 8), FMGFXMaterialFunctions::GetVisual("FilterWidth"));
+
+			Builder.Connect(UVsExp, "", UVFilterFuncExp, "");
+
+			Pos.X += GridSize * 15;
+
+			LayerOutputs.UVs.FilterWidthExp = Builder.CreateNamedReroute(Pos + FVector2D(0, GridSize * 8), FName(ParamPrefix + "FilterWidth"));
+			Builder.Connect(UVFilterFuncExp, "", LayerOutputs.UVs.FilterWidthExp, "");
+
+			Pos.X += GridSize * 15;
+		}
+		else
+		{
+			// reuse parent filter width
+			LayerOutputs.UVs.FilterWidthExp = UVs.FilterWidthExp;
+		}
+
+		EndExpressionGroup(GeneratedLayer.TransformGroup);
+	}
+
+	// generate children layers bottom to top
+	FMGFXMaterialLayerOutputs ChildOutputs = LayerOutputs;
+	for (int32 Idx = Layer->NumLayers() - 1; Idx >= 0; --Idx)
+	{
+		const UMGFXMaterialLayer* ChildLayer = Layer->GetLayer(Idx);
+
+		ChildOutputs = GenerateLayer(ChildLayer, LayerOutputs.UVs, ChildOutputs);
+	}
+
+
+	// generate shape for this layer
+	if (ReusedLayer)
+	{
+		GeneratedLayer.ShapeGroup = ReusedLayer->ShapeGroup;
+		RelocateExpressionGroup(GeneratedLayer.ShapeGroup);
+		LayerOutputs.ShapeExp = ReusedLayer->Outputs.ShapeExp;
+		LayerOutputs.VisualExp = ReusedLayer->Outputs.VisualExp;
+	}
+	else
+	{
+		BeginExpressionGroup(GeneratedLayer.ShapeGroup);
+
+		if (Layer->Shape)
+		{
+			// the shape, with an SDF output
+			LayerOutputs.ShapeExp = GenerateShape(Layer->Shape, UVsExp, ParamPrefix, ParamGroup);
+
+			// merge with the shape below before generating visuals, so that merged shapes share the same visuals
+			if (PrevOutputs.ShapeExp)
+			{
+				LayerOutputs.ShapeExp = GenerateMergeShapes(PrevOutputs.ShapeExp, LayerOutputs.ShapeExp, Layer->Shape->ShapeMergeOperation,
+				                                            Layer->Shape->ShapeMergeSmoothness, ParamPrefix, ParamGroup);
+			}
+
+			// the shape visuals, including all fills and strokes, unless they are generated by the shape above instead
+			if (!IsShapeMergedWithNext(Layer))
+			{
+				LayerOutputs.VisualExp = GenerateShapeVisuals(Layer->Shape, LayerOutputs.ShapeExp,
+				                                              LayerOutputs.UVs.FilterWidthExp, ParamPrefix, ParamGroup);
+			}
+		}
+
+		EndExpressionGroup(GeneratedLayer.ShapeGroup);
+	}
+
+	// store this layer's expressions before merging with any other layers
+	GeneratedLayer.Outputs = LayerOutputs;
+	FMGFXGeneratedLayer& StoredLayer = NewGenerated.Layers.Add(Layer, MoveTemp(GeneratedLayer));
+
+	BeginExpressionGroup(StoredLayer.MergeGroup);
+
+	// merge this layer with its children
+	if (Layer->HasLayers())
+	{
+		if (ChildOutputs.VisualExp && ChildOutputs.VisualExp != LayerOutputs.VisualExp)
+		{
+			if (LayerOutputs.VisualExp)
+			{
+				LayerOutputs.VisualExp = GenerateMergeVisual(LayerOutputs.VisualExp, ChildOutputs.VisualExp,
+				                                             Layer->MergeOperation, ParamPrefix, ParamGroup);
+			}
+			else
+			{
+				// pass forward output from previous layer to ensure it makes it to the top
+				LayerOutputs.VisualExp = ChildOutputs.VisualExp;
+			}
+		}
+	}
+
+
+	// merge this layer with the previous sibling
+	if (PrevOutputs.VisualExp)
+	{
+		if (LayerOutputs.VisualExp)
+		{
+			LayerOutputs.VisualExp = GenerateMergeVisual(LayerOutputs.VisualExp, PrevOutputs.VisualExp,
+			                                             Layer->MergeOperation, ParamPrefix, ParamGroup);
+		}
+		else
+		{
+			// pass forward output from previous layer to ensure it makes it to the top
+			LayerOutputs.VisualExp = PrevOutputs.VisualExp;
+		}
+	}
+
+	EndExpressionGroup(StoredLayer.MergeGroup);
+
+	return LayerOutputs;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateTransformUVs(const FMGFXShapeTransform2D& Transform, UMaterialExpression* InUVsExp,
+                                                                  const FString& ParamPrefix, const FName& ParamGroup, bool bIsLive,
+                                                                  const UMGFXMaterialLayer* Layer)
+{
+	// points to the last expression from each operation, since some may be skipped due to optimization
+	UMaterialExpression* LastInputExp = InUVsExp;
 
 	// temporary offset used to simplify next node positioning
 	FVector2D NodePosOffset = FVector2D::Zero();
 
-	const bool bNoOptimization = Transform.bAnimatable || MGFXMaterial->bAllAnimatable || bIsPreviewMaterial;
+	const bool bNoOptimization = Transform.bAnimatable || ShouldParameterizeAllValues() || bIsLive;
+
+	// animated components are evaluated from their keys instead of parameters
+	const FMGFXPropertyAnimation* LocationAnimation = FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location));
+	const FMGFXPropertyAnimation* RotationAnimation = FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation));
+	const FMGFXPropertyAnimation* ScaleAnimation = FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale));
+
+	// apply translate
+	if (bNoOptimization || LocationAnimation || !Transform.Location.IsZero())
+	{
+		Pos.Y += GridSize * 8;
+
+		UMaterialExpression* TranslateValueExp;
+		if (LocationAnimation)
+		{
+			TranslateValueExp = GenerateAnimation(*LocationAnimation, EMGFXMaterialShapeInputType::Vector2, Pos);
+			Pos.X += GridSize * 30;
+		}
+		else
+		{
+			TranslateValueExp = GenerateVector2Parameter(Transform.Location, ParamPrefix, ParamGroup, 10, Param_LocationX, Param_LocationY);
+		}
+		Pos.Y -= GridSize * 8;
+
+		// subtract so that coordinate space matches UMG, positive offset means going right or down
+		UMaterialExpressionSubtract* TranslateUVsExp = Builder.Create<UMaterialExpressionSubtract>(Pos);
+		Builder.Connect(LastInputExp, "", TranslateUVsExp, "A");
+		Builder.Connect(TranslateValueExp, "", TranslateUVsExp, "B");
+		LastInputExp = TranslateUVsExp;
+
+		Pos.X += GridSize * 15;
+	}
+
+	// apply rotate
+	if (bNoOptimization || RotationAnimation || !FMath::IsNearlyZero(Transform.Rotation))
+	{
+		// rotation is packed as the inverse rotated x-axis, so no degree conversion or trig is needed per pixel
+		// positive rotations are clockwise to match UMG coordinate space
+		NodePosOffset = FVector2D(0, GridSize * 8);
+		UMaterialExpression* RotationExp;
+		if (RotationAnimation)
+		{
+			// animated rotations are keyed in degrees, and converted after interpolating
+			RotationExp = GenerateAnimation(*RotationAnimation, EMGFXMaterialShapeInputType::Float, Pos + NodePosOffset, true);
+			Pos.X += GridSize * 15;
+		}
+		else
+		{
+			UMaterialExpressionVectorParameter* RotationParamExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos + NodePosOffset);
+			Builder.ConfigureParameter(RotationParamExp, FName(ParamPrefix + Param_RotationAxis), ParamGroup, 20);
+			SET_PROP_R(RotationParamExp, DefaultValue, FMGFXShapeTransform2D::GetRotationParameterValue(Transform.Rotation));
+			RotationExp = RotationParamExp;
+		}
+
+		Pos.X += GridSize * 15;
+
+		UMaterialExpressionCustom* RotateUVsExp = Builder.CreateCustom(
+			Pos, TEXT("return float2(UVs.x * Rotation.x - UVs.y * Rotation.y, UVs.x * Rotation.y + UVs.y * Rotation.x);"),
+			CMOT_Float2, {TEXT("UVs"), TEXT("Rotation")}, TEXT("Rotate UVs"));
+		Builder.Connect(LastInputExp, "", RotateUVsExp, "UVs");
+		Builder.Connect(RotationExp, "", RotateUVsExp, "Rotation");
+		LastInputExp = RotateUVsExp;
+
+		Pos.X += GridSize * 15;
+	}
+
+	// apply scale
+	if (bNoOptimization || ScaleAnimation || Transform.Scale != FVector2f::One())
+	{
+		Pos.Y += GridSize * 8;
+		UMaterialExpression* ScaleValueExp;
+		if (ScaleAnimation)
+		{
+			ScaleValueExp = GenerateAnimation(*ScaleAnimation, EMGFXMaterialShapeInputType::Vector2, Pos);
+			Pos.X += GridSize * 30;
+		}
+		else
+		{
+			ScaleValueExp = GenerateVector2Parameter(Transform.Scale, ParamPrefix, ParamGroup, 30, Param_ScaleX, Param_ScaleY);
+		}
+		Pos.Y -= GridSize * 8;
+
+		UMaterialExpressionDivide* ScaleUVsExp = Builder.Create<UMaterialExpressionDivide>(Pos);
+		Builder.Connect(LastInputExp, "", ScaleUVsExp, "A");
+		Builder.Connect(ScaleValueExp, "", ScaleUVsExp, "B");
+		LastInputExp = ScaleUVsExp;
+
+		Pos.X += GridSize * 15;
+	}
+
+	return LastInputExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateStaticTransformUVs(const FTransform2D& Transform, UMaterialExpression* InUVsExp)
+{
+	FVector2f AxisX, AxisY, Offset;
+	GetInverseTransformRows(Transform, AxisX, AxisY, Offset);
+
+	const bool bHasTranslation = !Offset.IsNearlyZero();
+	const bool bHasRotationOrScale = !AxisX.Equals(FVector2f(1.f, 0.f)) || !AxisY.Equals(FVector2f(0.f, 1.f));
+
+	if (!bHasRotationOrScale)
+	{
+		if (!bHasTranslation)
+		{
+			return InUVsExp;
+		}
+
+		// translation only, just add the offset
+		UMaterialExpressionConstant2Vector* OffsetExp = Builder.Create<UMaterialExpressionConstant2Vector>(Pos + FVector2D(0, GridSize * 8));
+		SET_PROP(OffsetExp, R, Offset.X);
+		SET_PROP(OffsetExp, G, Offset.Y);
+
+		Pos.X += GridSize * 15;
+
+		UMaterialExpressionAdd* TranslateUVsExp = Builder.Create<UMaterialExpressionAdd>(Pos);
+		Builder.Connect(InUVsExp, "", TranslateUVsExp, "A");
+		Builder.Connect(OffsetExp, "", TranslateUVsExp, "B");
+
+		Pos.X += GridSize * 15;
+
+		return TranslateUVsExp;
+	}
+
+	// store the 2x3 matrix as two rows
+	UMaterialExpressionConstant3Vector* Row0Exp = Builder.Create<UMaterialExpressionConstant3Vector>(Pos + FVector2D(0, GridSize * 8));
+	SET_PROP_R(Row0Exp, Constant, FLinearColor(AxisX.X, AxisY.X, Offset.X));
+
+	UMaterialExpressionConstant3Vector* Row1Exp = Builder.Create<UMaterialExpressionConstant3Vector>(Pos + FVector2D(0, GridSize * 14));
+	SET_PROP_R(Row1Exp, Constant, FLinearColor(AxisX.Y, AxisY.Y, Offset.Y));
+
+	Pos.X += GridSize * 15;
+
+	UMaterialExpressionCustom* TransformUVsExp = Builder.CreateCustom(
+		Pos, TEXT("return float2(dot(UVs, Row0.xy) + Row0.z, dot(UVs, Row1.xy) + Row1.z);"),
+		CMOT_Float2, {TEXT("UVs"), TEXT("Row0"), TEXT("Row1")}, TEXT("Transform UVs"));
+	Builder.Connect(InUVsExp, "", TransformUVsExp, "UVs");
+	Builder.Connect(Row0Exp, "", TransformUVsExp, "Row0");
+	Builder.Connect(Row1Exp, "", TransformUVsExp, "Row1");
+
+	Pos.X += GridSize * 15;
+
+	return TransformUVsExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateShape(const UMGFXMaterialShape* Shape, UMaterialExpression* InUVsExp,
+                                                           const FString& ParamPrefix, const FName& ParamGroup)
+{
+	check(Shape);
+
+	TArray<FMGFXMaterialShapeInput> Inputs = Shape->GetInputs();
+
+	int32 ParamSortPriority = 50;
+
+	// keep track of original Y so it can be restored after generating inputs
+	const int32 OrigNodePoseY = Pos.Y;
+
+	const bool bNoOptimization = ShouldParameterizeAllValues() || IsLayerLive(Shape->GetTypedOuter<UMGFXMaterialLayer>());
+
+	// create shape inputs
+	TArray<UMaterialExpression*> InputExps;
+	Pos.Y += GridSize * 8;
+	for (const FMGFXMaterialShapeInput& Input : Inputs)
+	{
+		const FLinearColor Value = Input.Value;
+
+		// animated inputs are evaluated from their keys instead of a parameter or constant
+		if (const FMGFXPropertyAnimation* Animation = FindAnimation(Shape, FName(Input.Name)))
+		{
+			InputExps.Add(GenerateAnimation(*Animation, Input.Type, Pos));
+
+			Pos.Y += GridSize * 8;
+			continue;
+		}
+
+		// bake the value as a constant unless it needs to be animated
+		const bool bShouldBeParameter = bNoOptimization || Shape->IsInputExposed(Input.Name);
+
+		if (bShouldBeParameter)
+		{
+			// setup input as scalar params, Vector2's will be represented by 2 scalar params
+			UMaterialExpression* InputExp;
+			switch (Input.Type)
+			{
+			default:
+			case EMGFXMaterialShapeInputType::Float:
+				if (ShouldPackParameters())
+				{
+					InputExp = GeneratePackedParameter(Pos, {Value.R}, {ParamPrefix + Input.Name}, ParamGroup, ParamSortPriority);
+					++ParamSortPriority;
+				}
+				else
+				{
+					InputExp = Builder.Create<UMaterialExpressionScalarParameter>(Pos);
+				}
+				break;
+			case EMGFXMaterialShapeInputType::Vector2:
+				InputExp = GenerateVector2Parameter(FVector2f(Input.Value.R, Input.Value.G),
+				                                    ParamPrefix, ParamGroup, ParamSortPriority, Input.Name + TEXT("X"), Input.Name + TEXT("Y"));
+				++ParamSortPriority;
+				break;
+			case EMGFXMaterialShapeInputType::Vector3:
+			case EMGFXMaterialShapeInputType::Vector4:
+				// its normal to ignore the extra A channel for a Vector3 param
+				InputExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos);
+				break;
+			}
+			check(InputExp);
+
+			InputExps.Add(InputExp);
+
+			// configure parameter
+			// Vector2 and packed params will already be configured, and the InputExp is actually an append or mask.
+			if (UMaterialExpressionParameter* ParamExp = Cast<UMaterialExpressionParameter>(InputExp))
+			{
+				// TODO: include Shape name in the prefix, since there may be multiple shapes
+				Builder.ConfigureParameter(ParamExp, FName(ParamPrefix + Input.Name), ParamGroup, ParamSortPriority);
+				++ParamSortPriority;
+			}
+
+			if (auto* ConstExp = Cast<UMaterialExpressionScalarParameter>(InputExp))
+			{
+				SET_PROP(ConstExp, DefaultValue, Value.R);
+			}
+			else if (auto* Const2Exp = Cast<UMaterialExpressionVectorParameter>(InputExp))
+			{
+				SET_PROP(Const2Exp, DefaultValue, Value);
+			}
+
+			Pos.Y += GridSize * 8;
+		}
+		else
+		{
+			// setup input as constant expressions
+			TSubclassOf<UMaterialExpression> InputExpClass = nullptr;
+			switch (Input.Type)
+			{
+			case EMGFXMaterialShapeInputType::Float:
+				InputExpClass = UMaterialExpressionConstant::StaticClass();
+				break;
+			case EMGFXMaterialShapeInputType::Vector2:
+				InputExpClass = UMaterialExpressionConstant2Vector::StaticClass();
+				break;
+			case EMGFXMaterialShapeInputType::Vector3:
+				InputExpClass = UMaterialExpressionConstant3Vector::StaticClass();
+				break;
+			case EMGFXMaterialShapeInputType::Vector4:
+				InputExpClass = UMaterialExpressionConstant4Vector::StaticClass();
+				break;
+			}
+			check(InputExpClass);
+
+			UMaterialExpression* InputExp = Builder.Create(InputExpClass, Pos);
+			check(InputExp);
+			InputExps.Add(InputExp);
+
+			if (auto* ConstExp = Cast<UMaterialExpressionConstant>(InputExp))
+			{
+				SET_PROP(ConstExp, R, Value.R);
+			}
+			else if (auto* Const2Exp = Cast<UMaterialExpressionConstant2Vector>(InputExp))
+			{
+				SET_PROP(Const2Exp, R, Value.R);
+				SET_PROP(Const2Exp, G, Value.G);
+			}
+			else if (auto* Const3Exp = Cast<UMaterialExpressionConstant3Vector>(InputExp))
+			{
+				SET_PROP(Const3Exp, Constant, Value);
+			}
+			else if (auto* Const4Exp = Cast<UMaterialExpressionConstant4Vector>(InputExp))
+			{
+				SET_PROP(Const4Exp, Constant, Value);
+			}
+
+			Pos.Y += GridSize * 8;
+		}
+	}
+	check(Inputs.Num() == InputExps.Num());
+
+	Pos.X += GridSize * 20;
+	Pos.Y = OrigNodePoseY;
+
+	// create shape function
+	UMaterialExpressionMaterialFunctionCall* ShapeExp = Builder.CreateFunction(Pos, Shape->GetMaterialFunctionPtr());
+
+	// connect uvs
+	if (InUVsExp)
+	{
+		Builder.Connect(InUVsExp, "", ShapeExp, "UVs");
+	}
+
+	// connect inputs
+	for (int32 Idx = 0; Idx < Inputs.Num(); ++Idx)
+	{
+		const FMGFXMaterialShapeInput& Input = Inputs[Idx];
+		UMaterialExpression* InputExp = InputExps[Idx];
+
+		Builder.Connect(InputExp, "", ShapeExp, Input.Name);
+	}
+
+	Pos.X += GridSize * 15;
+
+	return ShapeExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateShapeVisuals(const UMGFXMaterialShape* Shape, UMaterialExpression* ShapeExp,
+                                                                  UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
+                                                                  const FString& ParamPrefix, const FName& ParamGroup)
+{
+	// generate all visuals from the same shape, merging each over the previous ones
+	UMaterialExpression* ResultExp = nullptr;
+	for (const UMGFXMaterialShapeVisual* Visual : Shape->Visuals)
+	{
+		const FString VisualParamPrefix = GetVisualParamPrefix(ParamPrefix, Visual);
+
+		UMaterialExpression* VisualExp = nullptr;
+		if (const UMGFXMaterialShapeFill* Fill = Cast<UMGFXMaterialShapeFill>(Visual))
+		{
+			VisualExp = GenerateShapeFill(Fill, ShapeExp, FilterWidthExp, VisualParamPrefix, ParamGroup);
+		}
+		else if (const UMGFXMaterialShapeStroke* const Stroke = Cast<UMGFXMaterialShapeStroke>(Visual))
+		{
+			VisualExp = GenerateShapeStroke(Stroke, ShapeExp, FilterWidthExp, VisualParamPrefix, ParamGroup);
+		}
+
+		if (VisualExp)
+		{
+			ResultExp = ResultExp ? GenerateMergeVisual(VisualExp, ResultExp, EMGFXLayerMergeOperation::Over, ParamPrefix, ParamGroup) : VisualExp;
+		}
+	}
+
+	return ResultExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateMergeVisual(UMaterialExpression* AExp, UMaterialExpression* BExp, EMGFXLayerMergeOperation Operation,
+                                                                 const FString& ParamPrefix, const FName& ParamGroup)
+{
+	const FString MergeName = GetMergeOperationName(Operation);
+	if (MergeName.IsEmpty())
+	{
+		// no valid merge function
+		return AExp;
+	}
+
+	UMaterialExpressionMaterialFunctionCall* MergeExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetMerge(MergeName));
+	Builder.Connect(AExp, "", MergeExp, "A");
+	Builder.Connect(BExp, "", MergeExp, "B");
+
+	Pos.X += GridSize * 15;
+
+	return MergeExp;
+}
+
+FString FMGFXMaterialGenerator::GetMergeOperationName(EMGFXLayerMergeOperation Operation)
+{
+	switch (Operation)
+	{
+	case EMGFXLayerMergeOperation::Over:
+		return TEXT("Over");
+	case EMGFXLayerMergeOperation::Add:
+		return TEXT("Add");
+	case EMGFXLayerMergeOperation::Subtract:
+		return TEXT("Subtract");
+	case EMGFXLayerMergeOperation::Multiply:
+		return TEXT("Multiply");
+	case EMGFXLayerMergeOperation::In:
+		return TEXT("In");
+	case EMGFXLayerMergeOperation::Out:
+		return TEXT("Out");
+	case EMGFXLayerMergeOperation::Mask:
+		return TEXT("Mask");
+	case EMGFXLayerMergeOperation::Stencil:
+		return TEXT("Stencil");
+	default:
+		return FString();
+	}
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateMergeShapes(UMaterialExpression* AExp, UMaterialExpression* BExp, EMGFXShapeMergeOperation Operation,
+                                                                 float Smoothness, const FString& ParamPrefix, const FName& ParamGroup)
+{
+	const FString MergeName = GetShapeMergeOperationName(Operation);
+	if (MergeName.IsEmpty())
+	{
+		return BExp;
+	}
+
+	// there are no shape merge material functions, use the same functions as the hlsl backend
+	const FString Code = Smoothness > 0.f
+		                     ? FString::Printf(TEXT("return MGFX_SmoothMergeShapes_%s(A, B, %s);"), *MergeName, *ToHLSL(Smoothness))
+		                     : FString::Printf(TEXT("return MGFX_MergeShapes_%s(A, B);"), *MergeName);
+
+	UMaterialExpressionCustom* MergeExp = Builder.CreateCustom(Pos, Code, CMOT_Float1, {TEXT("A"), TEXT("B")},
+	                                                           FString::Printf(TEXT("Merge Shapes (%s)"), *MergeName),
+	                                                           {FMGFXMaterialFunctions::CommonShaderPath});
+	Builder.Connect(AExp, GetShapeOutputName(AExp), MergeExp, "A");
+	Builder.Connect(BExp, GetShapeOutputName(BExp), MergeExp, "B");
+
+	Pos.X += GridSize * 15;
+
+	return MergeExp;
+}
+
+FString FMGFXMaterialGenerator::GetLayerParamName(const UMGFXMaterialLayer* Layer)
+{
+	return Layer->Name.IsEmpty() ? Layer->GetName() : Layer->Name;
+}
+
+FString FMGFXMaterialGenerator::GetLayerParamPrefix(const UMGFXMaterialLayer* Layer)
+{
+	return GetLayerParamName(Layer) + TEXT(".");
+}
+
+FString FMGFXMaterialGenerator::GetVisualParamPrefix(const FString& LayerParamPrefix, const UMGFXMaterialShapeVisual* Visual)
+{
+	const UMGFXMaterialShape* Shape = Visual ? Cast<UMGFXMaterialShape>(Visual->GetOuter()) : nullptr;
+	const int32 VisualIdx = Shape ? Shape->Visuals.IndexOfByKey(Visual) : INDEX_NONE;
+	if (VisualIdx <= 0)
+	{
+		return LayerParamPrefix;
+	}
+
+	return FString::Printf(TEXT("%sVisual%d."), *LayerParamPrefix, VisualIdx);
+}
+
+FString FMGFXMaterialGenerator::GetShapeMergeOperationName(EMGFXShapeMergeOperation Operation)
+{
+	switch (Operation)
+	{
+	case EMGFXShapeMergeOperation::Union:
+		return TEXT("Union");
+	case EMGFXShapeMergeOperation::Subtraction:
+		return TEXT("Subtraction");
+	case EMGFXShapeMergeOperation::Intersection:
+		return TEXT("Intersection");
+	default:
+		return FString();
+	}
+}
+
+FString FMGFXMaterialGenerator::GetShapeOutputName(const UMaterialExpression* ShapeExp)
+{
+	// shape functions output the SDF by name, merged shapes are custom expressions with a single output
+	return ShapeExp && ShapeExp->IsA<UMaterialExpressionMaterialFunctionCall>() ? TEXT("SDF") : FString();
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateVector2Parameter(FVector2f DefaultValue,
+                                                                      const FString& ParamPrefix, const FName& ParamGroup, int32 BaseSortPriority,
+                                                                      const FString& ParamNameX, const FString& ParamNameY)
+{
+	if (ShouldPackParameters())
+	{
+		UMaterialExpression* PackedExp = GeneratePackedParameter(Pos, {DefaultValue.X, DefaultValue.Y},
+		                                                         {ParamPrefix + ParamNameX, ParamPrefix + ParamNameY}, ParamGroup, BaseSortPriority);
+
+		Pos.X += GridSize * 30;
+
+		return PackedExp;
+	}
+
+	UMaterialExpressionScalarParameter* XExp = Builder.CreateScalarParam(
+		Pos, FName(ParamPrefix + ParamNameX), ParamGroup, BaseSortPriority);
+	SET_PROP(XExp, DefaultValue, DefaultValue.X);
+
+	UMaterialExpressionScalarParameter* YExp = Builder.CreateScalarParam(
+		Pos + FVector2D(0, GridSize * 6), FName(ParamPrefix + ParamNameY), ParamGroup, BaseSortPriority + 1);
+	SET_PROP(YExp, DefaultValue, DefaultValue.Y);
+
+	Pos.X += GridSize * 15;
+
+	// append
+	UMaterialExpressionAppendVector* AppendExp = Builder.CreateAppend(Pos, XExp, YExp);
+
+	Pos.X += GridSize * 15;
+
+	return AppendExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GeneratePackedParameter(const FVector2D& NodePos, TConstArrayView<float> Values,
+                                                                     TConstArrayView<FString> ParamNames, const FName& ParamGroup, int32 SortPriority)
+{
+	int32 Channel;
+	UMaterialExpressionVectorParameter* ParamExp = AllocatePackedChannels(NodePos, Values, ParamNames, ParamGroup, SortPriority, Channel);
+
+	// the default output of a vector parameter is RGB, so alpha is unpacked from its own output
+	static const TCHAR* ChannelOutputs[] = {TEXT("R"), TEXT("G"), TEXT("B"), TEXT("A")};
+	const FVector2D UnpackPos = NodePos + FVector2D(GridSize * 15, 0);
+
+	if (Values.Num() == 1)
+	{
+		UMaterialExpressionComponentMask* MaskExp = Builder.CreateComponentMask(UnpackPos, 1, 0, 0, 0);
+		Builder.Connect(ParamExp, ChannelOutputs[Channel], MaskExp, "");
+		return MaskExp;
+	}
+
+	if (Channel + Values.Num() <= 3)
+	{
+		UMaterialExpressionComponentMask* MaskExp = Builder.CreateComponentMask(UnpackPos, Channel == 0, Channel <= 1, Channel >= 1, 0);
+		Builder.Connect(ParamExp, "", MaskExp, "");
+		return MaskExp;
+	}
+
+	// unpack BA
+	check(Values.Num() == 2);
+	UMaterialExpressionAppendVector* AppendExp = Builder.Create<UMaterialExpressionAppendVector>(UnpackPos);
+	Builder.Connect(ParamExp, ChannelOutputs[Channel], AppendExp, "A");
+	Builder.Connect(ParamExp, ChannelOutputs[Channel + 1], AppendExp, "B");
+	return AppendExp;
+}
+
+bool FMGFXMaterialGenerator::ShouldPackParameters() const
+{
+	return MGFXMaterial && MGFXMaterial->bPackParameters;
+}
+
+bool FMGFXMaterialGenerator::ShouldParameterizeAllValues() const
+{
+	// shared materials must have a parameter for every value, since each material instance sets its own
+	return MGFXMaterial && (MGFXMaterial->bAllAnimatable || MGFXMaterial->UsesSharedMaterial());
+}
+
+UMaterialExpressionVectorParameter* FMGFXMaterialGenerator::AllocatePackedChannels(const FVector2D& NodePos, TConstArrayView<float> Values,
+                                                                                   TConstArrayView<FString> ParamNames, const FName& ParamGroup,
+                                                                                   int32 SortPriority, int32& OutChannel)
+{
+	check(Values.Num() == ParamNames.Num());
+	check(Values.Num() > 0 && Values.Num() <= 4);
+
+	if (!PackedParamExp || NumPackedChannels + Values.Num() > 4)
+	{
+		// name after the first packed parameter, which is unique and stable between generates
+		PackedParamExp = Builder.Create<UMaterialExpressionVectorParameter>(NodePos);
+		Builder.ConfigureParameter(PackedParamExp, FName(ParamNames[0] + TEXT("_Packed")), ParamGroup, SortPriority);
+		SET_PROP_R(PackedParamExp, DefaultValue, FLinearColor(0.f, 0.f, 0.f, 0.f));
+		NumPackedChannels = 0;
+		PackedParamHLSLInput.Reset();
+	}
+
+	OutChannel = NumPackedChannels;
+	NumPackedChannels += Values.Num();
+
+	FLinearColor PackedValue = PackedParamExp->DefaultValue;
+	for (int32 Idx = 0; Idx < Values.Num(); ++Idx)
+	{
+		PackedValue.Component(OutChannel + Idx) = Values[Idx];
+
+		FMGFXPackedParameterSlot Slot;
+		Slot.ParameterName = PackedParamExp->ParameterName;
+		Slot.Channel = OutChannel + Idx;
+
+		const FName ParamName(ParamNames[Idx]);
+		NewGenerated.PackedParameters.Add(ParamName, Slot);
+		if (RecordingGroup)
+		{
+			RecordingGroup->PackedParameters.Add(ParamName, Slot);
+		}
+	}
+	SET_PROP(PackedParamExp, DefaultValue, PackedValue);
+
+	return PackedParamExp;
+}
+
+void FMGFXMaterialGenerator::ResetPackedParameter()
+{
+	PackedParamExp = nullptr;
+	NumPackedChannels = 0;
+	PackedParamHLSLInput.Reset();
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateShapeFill(const UMGFXMaterialShapeFill* Fill, UMaterialExpression* ShapeExp,
+                                                               UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
+                                                               const FString& ParamPrefix, const FName& ParamGroup)
+{
+	// add reused filter width input
+	UMaterialExpressionNamedRerouteUsage* FilterWidthUsageExp = nullptr;
+	if (!Fill->bComputeFilterWidth)
+	{
+		FilterWidthUsageExp = Builder.CreateNamedRerouteUsage(Pos + FVector2D(0, GridSize * 8), FilterWidthExp);
+	}
+
+	// optionally enable filter bias
+	UMaterialExpressionStaticBool* EnableBiasExp = nullptr;
+	if (Fill->bEnableFilterBias)
+	{
+		EnableBiasExp = Builder.Create<UMaterialExpressionStaticBool>(Pos + FVector2D(0, GridSize * 16));
+		SET_PROP_R(EnableBiasExp, Value, 1);
+	}
+
+	Pos.X += GridSize * 15;
 
-	// apply translate
-	if (bNoOptimization || !Transform.Location.IsZero())
+	// add fill func
+	UMaterialExpressionMaterialFunctionCall* FillExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Fill"));
+	Builder.Connect(ShapeExp, GetShapeOutputName(ShapeExp), FillExp, "SDF");
+	if (FilterWidthUsageExp)
 	{
-		Pos.Y += GridSize * 8;
+		Builder.Connect(FilterWidthUsageExp, "", FillExp, "FilterWidth");
+	}
+	if (EnableBiasExp)
+	{
+		Builder.Connect(EnableBiasExp, "", FillExp, "EnableFilterBias");
+	}
 
-		UMaterialExpression* TranslateValueExp = GenerateVector2Parameter(Transform.Location, ParamPrefix, ParamGroup,
-		                                                                  10, Param_LocationX, Param_LocationY);
-		Pos.Y -= GridSize * 8;
+	Pos.X += GridSize * 15;
 
-		// subtract so that coordinate space matches UMG, positive offset means going right or down
-		UMaterialExpressionSubtract* TranslateUVsExp = Builder.Create<UMaterialExpressionSubtract>(Pos);
-		Builder.Connect(LastInputExp, "", TranslateUVsExp, "A");
-		Builder.Connect(TranslateValueExp, "", TranslateUVsExp, "B");
-		LastInputExp = TranslateUVsExp;
+	return GenerateTint(FillExp, Fill->GetColor(), FindAnimation(Fill, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeFill, Color)),
+	                    ParamPrefix, ParamGroup);
+}
 
-		Pos.X += GridSize * 15;
+UMaterialExpression* FMGFXMaterialGenerator::GenerateShapeStroke(const UMGFXMaterialShapeStroke* Stroke, UMaterialExpression* ShapeExp,
+                                                                 UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
+                                                                 const FString& ParamPrefix, const FName& ParamGroup)
+{
+	// add stroke width input
+	UMaterialExpression* StrokeWidthExp;
+	if (const FMGFXPropertyAnimation* StrokeWidthAnimation = FindAnimation(Stroke, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, StrokeWidth)))
+	{
+		StrokeWidthExp = GenerateAnimation(*StrokeWidthAnimation, EMGFXMaterialShapeInputType::Float, Pos + FVector2D(0, GridSize * 8));
+	}
+	else if (ShouldPackParameters())
+	{
+		StrokeWidthExp = GeneratePackedParameter(Pos + FVector2D(0, GridSize * 8), {Stroke->StrokeWidth},
+		                                         {ParamPrefix + "StrokeWidth"}, ParamGroup, 40);
+	}
+	else
+	{
+		UMaterialExpressionScalarParameter* StrokeWidthParamExp = Builder.CreateScalarParam(
+			Pos + FVector2D(0, GridSize * 8), FName(ParamPrefix + "StrokeWidth"), ParamGroup, 40);
+		SET_PROP(StrokeWidthParamExp, DefaultValue, Stroke->StrokeWidth);
+		StrokeWidthExp = StrokeWidthParamExp;
 	}
 
-	// apply rotate
-	if (bNoOptimization || !FMath::IsNearlyZero(Transform.Rotation))
+	// add reused filter width input
+	UMaterialExpressionNamedRerouteUsage* FilterWidthUsageExp = nullptr;
+	if (!Stroke->bComputeFilterWidth)
 	{
-		NodePosOffset = FVector2D(0, GridSize * 8);
-		UMaterialExpressionScalarParameter* RotationExp = Builder.CreateScalarParam(
-			Pos + NodePosOffset, FName(ParamPrefix + Param_Rotation), ParamGroup, 20);
-		SET_PROP(RotationExp, DefaultValue, Transform.Rotation);
+		FilterWidthUsageExp = Builder.CreateNamedRerouteUsage(Pos + FVector2D(0, GridSize * 14), FilterWidthExp);
+	}
 
-		Pos.X += GridSize * 15;
+	Pos.X += GridSize * 15;
 
-		// TODO: perf: allow marking rotation as animatable or not and bake in the conversion when not needed
-		// conversion from degrees, not baked in to support animation
-		NodePosOffset = FVector2D(0, GridSize * 8);
-		UMaterialExpressionDivide* RotateConvExp = Builder.Create<UMaterialExpressionDivide>(Pos + NodePosOffset);
-		Builder.Connect(RotationExp, "", RotateConvExp, "");
-		// negative to match UMG coordinate space, positive rotations are clockwise
-		SET_PROP_R(RotateConvExp, ConstB, -360.f);
+	// add stroke func
+	UMaterialExpressionMaterialFunctionCall* StrokeExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Stroke"));
+	Builder.Connect(ShapeExp, GetShapeOutputName(ShapeExp), StrokeExp, "SDF");
+	Builder.Connect(StrokeWidthExp, "", StrokeExp, "StrokeWidth");
+	if (FilterWidthUsageExp)
+	{
+		Builder.Connect(FilterWidthUsageExp, "", StrokeExp, "FilterWidth");
+	}
 
-		Pos.X += GridSize * 15;
+	Pos.X += GridSize * 15;
 
-		UMaterialExpressionMaterialFunctionCall* RotateUVsExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetTransform("Rotate"));
-		Builder.Connect(LastInputExp, "", RotateUVsExp, "UVs");
-		Builder.Connect(RotateConvExp, "", RotateUVsExp, "Rotation");
-		LastInputExp = RotateUVsExp;
+	return GenerateTint(StrokeExp, Stroke->GetColor(), FindAnimation(Stroke, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, Color)),
+	                    ParamPrefix, ParamGroup);
+}
 
-		Pos.X += GridSize * 15;
+UMaterialExpression* FMGFXMaterialGenerator::GenerateTint(UMaterialExpression* CoverageExp, const FLinearColor& Color,
+                                                          const FMGFXPropertyAnimation* ColorAnimation,
+                                                          const FString& ParamPrefix, const FName& ParamGroup)
+{
+	UMaterialExpression* RGBExp;
+	UMaterialExpression* AlphaExp;
+	FString AlphaPin;
+	if (ColorAnimation)
+	{
+		UMaterialExpression* ColorExp = GenerateAnimation(*ColorAnimation, EMGFXMaterialShapeInputType::Vector4, Pos + FVector2D(0, GridSize * 8));
+
+		Pos.X += GridSize * 30;
+
+		// custom expressions only have a single output, so split the color
+		RGBExp = Builder.CreateComponentMaskRGB(Pos + FVector2D(0, GridSize * 8));
+		Builder.Connect(ColorExp, "", RGBExp, "");
+		AlphaExp = Builder.CreateComponentMaskA(Pos + FVector2D(0, GridSize * 14));
+		Builder.Connect(ColorExp, "", AlphaExp, "");
+	}
+	else
+	{
+		// add color param
+		UMaterialExpressionVectorParameter* ColorExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos + FVector2D(0, GridSize * 8));
+		Builder.ConfigureParameter(ColorExp, FName(ParamPrefix + "Color"), ParamGroup, 40);
+		SET_PROP_R(ColorExp, DefaultValue, Color);
+		RGBExp = ColorExp;
+		AlphaExp = ColorExp;
+		AlphaPin = TEXT("A");
 	}
 
-	// apply scale
-	if (bNoOptimization || Transform.Scale != FVector2f::One())
+	Pos.X += GridSize * 15;
+
+	// mutiply by color, and append to RGBA
+	UMaterialExpressionMaterialFunctionCall* TintExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Tint"));
+	Builder.Connect(CoverageExp, "", TintExp, "In");
+	Builder.Connect(RGBExp, "", TintExp, "RGB");
+	Builder.Connect(AlphaExp, AlphaPin, TintExp, "A");
+
+	Pos.X += GridSize * 15;
+
+	return TintExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateAnimation(const FMGFXPropertyAnimation& Animation, EMGFXMaterialShapeInputType Type,
+                                                               const FVector2D& NodePos, bool bIsRotation)
+{
+	UMaterialExpression* TimeExp = GenerateAnimationTime(NodePos);
+
+	// the keys are baked into the code, so the time is the only input
+	const FString Value = GetAnimationValueHLSL(Animation, TEXT("T"), Type);
+	const FString Code = FString::Printf(TEXT("const float T = %s;\nreturn %s;"), *GetAnimationTimeHLSL(Animation, TEXT("Time")),
+	                                     bIsRotation ? *FString::Printf(TEXT("MGFX_RotationFromDegrees(%s)"), *Value) : *Value);
+
+	ECustomMaterialOutputType OutputType;
+	switch (bIsRotation ? EMGFXMaterialShapeInputType::Vector2 : Type)
 	{
-		Pos.Y += GridSize * 8;
-		UMaterialExpression* ScaleValueExp = GenerateVector2Parameter(Transform.Scale,
-		                                                              ParamPrefix, ParamGroup, 30, Param_ScaleX, Param_ScaleY);
-		Pos.Y -= GridSize * 8;
+	default:
+	case EMGFXMaterialShapeInputType::Float:
+		OutputType = CMOT_Float1;
+		break;
+	case EMGFXMaterialShapeInputType::Vector2:
+		OutputType = CMOT_Float2;
+		break;
+	case EMGFXMaterialShapeInputType::Vector3:
+		OutputType = CMOT_Float3;
+		break;
+	case EMGFXMaterialShapeInputType::Vector4:
+		OutputType = CMOT_Float4;
+		break;
+	}
 
-		UMaterialExpressionDivide* ScaleUVsExp = Builder.Create<UMaterialExpressionDivide>(Pos);
-		Builder.Connect(LastInputExp, "", ScaleUVsExp, "A");
-		Builder.Connect(ScaleValueExp, "", ScaleUVsExp, "B");
-		LastInputExp = ScaleUVsExp;
+	UMaterialExpressionCustom* AnimationExp = Builder.CreateCustom(
+		NodePos + FVector2D(GridSize * 15, 0), Code, OutputType, {TEXT("Time")},
+		FString::Printf(TEXT("Animate %s"), *Animation.PropertyName.ToString()), {FMGFXMaterialFunctions::CommonShaderPath});
+	Builder.Connect(TimeExp, "", AnimationExp, "Time");
 
-		Pos.X += GridSize * 15;
+	return AnimationExp;
+}
+
+UMaterialExpression* FMGFXMaterialGenerator::GenerateAnimationTime(const FVector2D& NodePos)
+{
+	if (MGFXMaterial->AnimationTimeSource == EMGFXAnimationTimeSource::Parameter)
+	{
+		return Builder.CreateScalarParam(NodePos, FName(Param_AnimationTime), FName("Animation"), 0);
 	}
 
-	return LastInputExp;
+	return Builder.Create<UMaterialExpressionTime>(NodePos);
 }
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateShape(const UMGFXMaterialShape* Shape, UMaterialExpression* InUVsExp,
-                                                           const FString& ParamPrefix, const FName& ParamGroup)
+const FMGFXPropertyAnimation* FMGFXMaterialGenerator::FindAnimation(const UObject* Object, FName PropertyName)
+{
+	const UMGFXMaterialLayer* Layer = Cast<UMGFXMaterialLayer>(Object);
+	if (!Layer && Object)
+	{
+		Layer = Object->GetTypedOuter<UMGFXMaterialLayer>();
+	}
+
+	return Layer ? Layer->FindAnimation(Object, PropertyName) : nullptr;
+}
+
+FString FMGFXMaterialGenerator::GetAnimationTimeHLSL(const FMGFXPropertyAnimation& Animation, const FString& Time)
+{
+	const TArray<FMGFXAnimationKey> Keys = Animation.GetSortedKeys();
+	if (!Animation.bLoop || Keys.Num() < 2)
+	{
+		return Time;
+	}
+
+	const float Start = Keys[0].Time;
+	const float Duration = Keys.Last().Time - Start;
+	if (Duration <= 0.f)
+	{
+		return Time;
+	}
+
+	return FString::Printf(TEXT("MGFX_LoopTime(%s, %s, %s)"), *Time, *ToHLSL(Start), *ToHLSL(Duration));
+}
+
+FString FMGFXMaterialGenerator::GetAnimationValueHLSL(const FMGFXPropertyAnimation& Animation, const FString& Time, EMGFXMaterialShapeInputType Type)
+{
+	const TArray<FMGFXAnimationKey> Keys = Animation.GetSortedKeys();
+	check(!Keys.IsEmpty());
+
+	// blend into each key in order, every segment before the time is fully blended and every segment after is skipped,
+	// so the first and last values are held outside of the keys
+	FString Value = ToHLSL(Keys[0].Value, Type);
+	for (int32 Idx = 1; Idx < Keys.Num(); ++Idx)
+	{
+		const FMGFXAnimationKey& PrevKey = Keys[Idx - 1];
+		const FMGFXAnimationKey& Key = Keys[Idx];
+
+		FString Alpha;
+		if (PrevKey.InterpMode == EMGFXAnimationInterpMode::Constant || Key.Time <= PrevKey.Time)
+		{
+			Alpha = FString::Printf(TEXT("step(%s, %s)"), *ToHLSL(Key.Time), *Time);
+		}
+		else if (PrevKey.InterpMode == EMGFXAnimationInterpMode::Smooth)
+		{
+			Alpha = FString::Printf(TEXT("smoothstep(%s, %s, %s)"), *ToHLSL(PrevKey.Time), *ToHLSL(Key.Time), *Time);
+		}
+		else
+		{
+			Alpha = FString::Printf(TEXT("saturate((%s - %s) * %s)"), *Time, *ToHLSL(PrevKey.Time), *ToHLSL(1.f / (Key.Time - PrevKey.Time)));
+		}
+
+		Value = FString::Printf(TEXT("lerp(%s, %s, %s)"), *Value, *ToHLSL(Key.Value, Type), *Alpha);
+	}
+
+	return Value;
+}
+
+
+// HLSL Backend
+// ------------
+
+void FMGFXMaterialGenerator::GenerateLayersHLSL()
+{
+	HLSLCode.Reset();
+	HLSLInputs.Reset();
+	HLSLIncludeFilePaths = {FMGFXMaterialFunctions::CommonShaderPath, FMGFXMaterialFunctions::ShapesShaderPath};
+	NumHLSLVariables = 0;
+	AnimationTimeHLSLInput.Reset();
+
+	// all inputs are stacked in a single column to the left of the custom expression
+	Pos = FVector2D(NodePosBaselineLeft, GridSize * 30);
+
+	// create canvas tex cords with default UVs (for UI these will be 9-sliced)
+	UMaterialExpressionTextureCoordinate* TexCoordExp = Builder.Create<UMaterialExpressionTextureCoordinate>(Pos);
+	const FString TexCoords = AddHLSLInput(TexCoordExp, TEXT("TexCoords"));
+
+	Pos.Y += GridSize * 6;
+
+	const FString CanvasSize = GenerateVector2ParameterHLSL(MGFXMaterial->BaseCanvasSize, FString(), FName("Canvas"), 0,
+	                                                        TEXT("CanvasWidth"), TEXT("CanvasHeight"));
+
+	// scale UVs to canvas size so all shapes can operate in canvas-dimensions
+	FMGFXMaterialHLSLLayerOutputs CanvasUVs;
+	CanvasUVs.UVs = AddHLSLVariable(TEXT("float2"), TEXT("CanvasUVs"), FString::Printf(TEXT("%s * %s"), *TexCoords, *CanvasSize));
+	CanvasUVs.BaseUVs = CanvasUVs.UVs;
+
+	// compute a reusable filter width based on canvas resolution
+	const FString CanvasFilterWidth = MGFXMaterial->bComputeFilterWidth
+		                                  ? FString::Printf(TEXT("MGFX_FilterWidth(%s)"), *CanvasUVs.UVs)
+		                                  : ToHLSL(MGFXMaterial->FixedFilterWidth);
+	CanvasUVs.FilterWidth = AddHLSLVariable(TEXT("float"), TEXT("CanvasFilterWidth"), CanvasFilterWidth);
+
+	// generate all layers recursively
+	FMGFXMaterialHLSLLayerOutputs LayerOutputs;
+	for (int32 Idx = MGFXMaterial->RootLayers.Num() - 1; Idx >= 0; --Idx)
+	{
+		const UMGFXMaterialLayer* ChildLayer = MGFXMaterial->RootLayers[Idx];
+
+		LayerOutputs = GenerateLayerHLSL(ChildLayer, CanvasUVs, LayerOutputs);
+	}
+
+	// unpremult after all merges
+	const FString Result = LayerOutputs.Visual.IsEmpty() ? FString(TEXT("float4(0, 0, 0, 0)")) : LayerOutputs.Visual;
+	HLSLCode += FString::Printf(TEXT("return MGFX_Unpremult(%s);\n"), *Result);
+
+	// create the custom expression with all inputs
+	Pos = FVector2D(NodePosBaselineLeft + GridSize * 20, GridSize * 30);
+
+	TArray<FName> InputNames;
+	for (const TPair<FName, UMaterialExpression*>& Input : HLSLInputs)
+	{
+		InputNames.Add(Input.Key);
+	}
+
+	UMaterialExpressionCustom* LayersExp = Builder.CreateCustom(Pos, HLSLCode, CMOT_Float4, InputNames, TEXT("Layers"), HLSLIncludeFilePaths);
+	for (const TPair<FName, UMaterialExpression*>& Input : HLSLInputs)
+	{
+		Builder.Connect(Input.Value, "", LayersExp, Input.Key.ToString());
+	}
+
+	Pos.X += GridSize * 15;
+
+	// connect to layers output reroute
+	UMaterialExpressionNamedRerouteDeclaration* OutputRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_LayersOutput, RGBARerouteColor);
+	Builder.Connect(LayersExp, OutputRerouteExp);
+
+	HLSLCode.Reset();
+	HLSLInputs.Reset();
+}
+
+void FMGFXMaterialGenerator::GenerateLayersInterpreted()
+{
+	Pos = FVector2D(NodePosBaselineLeft, GridSize * 30);
+
+	// create canvas tex cords with default UVs (for UI these will be 9-sliced)
+	UMaterialExpressionTextureCoordinate* TexCoordExp = Builder.Create<UMaterialExpressionTextureCoordinate>(Pos);
+
+	Pos.Y += GridSize * 6;
+
+	// default to the packed layers of this material, so the material works without an instance.
+	// until they have been packed, use a texture that fails the version check and renders nothing.
+	UTexture* LayerDataTexture = MGFXMaterial->PackedLayersTexture;
+	if (!LayerDataTexture)
+	{
+		LayerDataTexture = LoadObject<UTexture>(nullptr, TEXT("/Engine/EngineResources/Black.Black"));
+	}
+	const TEnumAsByte<EMaterialSamplerType> SamplerType = UMaterialExpressionTextureBase::GetSamplerTypeForTexture(LayerDataTexture);
+	const FName LayerDataGroup(TEXT("Layers"));
+	const int32 LayerDataSortPriority = 0;
+
+	UMaterialExpressionTextureObjectParameter* LayerDataExp = Builder.Create<UMaterialExpressionTextureObjectParameter>(Pos);
+	SET_PROP(LayerDataExp, ParameterName, FMGFXLayerPacker::LayerDataParameterName);
+	SET_PROP(LayerDataExp, Group, LayerDataGroup);
+	SET_PROP(LayerDataExp, SortPriority, LayerDataSortPriority);
+	SET_PROP(LayerDataExp, Texture, LayerDataTexture);
+	SET_PROP(LayerDataExp, SamplerType, SamplerType);
+
+	// create the interpreter expression
+	Pos = FVector2D(NodePosBaselineLeft + GridSize * 20, GridSize * 30);
+
+	const FName TexCoordsInput(TEXT("TexCoords"));
+	const FString Code = FString::Printf(TEXT("return MGFX_Interpret(%s, %s);"), *FMGFXLayerPacker::LayerDataParameterName.ToString(),
+	                                     *TexCoordsInput.ToString());
+	const TArray<FString> IncludeFilePaths = {
+		FMGFXMaterialFunctions::CommonShaderPath, FMGFXMaterialFunctions::ShapesShaderPath, FMGFXMaterialFunctions::InterpreterShaderPath
+	};
+	UMaterialExpressionCustom* LayersExp = Builder.CreateCustom(Pos, Code, CMOT_Float4, {TexCoordsInput, FMGFXLayerPacker::LayerDataParameterName},
+	                                                            TEXT("Layers"), IncludeFilePaths);
+	Builder.Connect(TexCoordExp, "", LayersExp, TexCoordsInput.ToString());
+	Builder.Connect(LayerDataExp, "", LayersExp, FMGFXLayerPacker::LayerDataParameterName.ToString());
+
+	Pos.X += GridSize * 15;
+
+	// connect to layers output reroute
+	UMaterialExpressionNamedRerouteDeclaration* OutputRerouteExp = Builder.CreateNamedReroute(Pos, Reroute_LayersOutput, RGBARerouteColor);
+	Builder.Connect(LayersExp, OutputRerouteExp);
+}
+
+FMGFXMaterialHLSLLayerOutputs FMGFXMaterialGenerator::GenerateLayerHLSL(const UMGFXMaterialLayer* Layer, const FMGFXMaterialHLSLLayerOutputs& UVs,
+                                                                        const FMGFXMaterialHLSLLayerOutputs& PrevOutputs)
+{
+	FMGFXMaterialHLSLLayerOutputs LayerOutputs;
+
+	const FString LayerName = GetLayerParamName(Layer);
+	const FString ParamPrefix = GetLayerParamPrefix(Layer);
+	const FName ParamGroup = FName(FString::Printf(TEXT("%s"), *LayerName));
+
+	// track the parameters and code of this layer for cost reports
+	FMGFXGeneratedLayer GeneratedLayer;
+	GeneratedLayer.Hash = GetGeneratedLayerHash(Layer);
+	int32 CodeStartIdx = HLSLCode.Len();
+
+	BeginExpressionGroup(GeneratedLayer.TransformGroup);
+
+	HLSLCode += FString::Printf(TEXT("\n// %s\n"), *LayerName);
+
+	const bool bNoOptimization = IsTransformParameterized(Layer);
+	if (bNoOptimization)
+	{
+		// apply layer transform using parameters
+		LayerOutputs.UVs = AddHLSLVariable(TEXT("float2"), TEXT("UVs"),
+		                                   GenerateTransformUVsHLSL(Layer->Transform, UVs.UVs, ParamPrefix, ParamGroup, Layer));
+
+		// static children bake their transforms relative to these uvs
+		LayerOutputs.BaseUVs = LayerOutputs.UVs;
+	}
+	else
+	{
+		// bake the transform of this layer and all static parents into one transform, relative to the nearest animatable uvs
+		LayerOutputs.BaseUVs = UVs.BaseUVs;
+		LayerOutputs.BaseTransform = Layer->Transform.ToTransform2D().Concatenate(UVs.BaseTransform);
+
+		// this may just return the base uvs if the transform is identity
+		const FString UVsValue = GenerateStaticTransformUVsHLSL(LayerOutputs.BaseTransform, UVs.BaseUVs);
+		LayerOutputs.UVs = UVsValue == UVs.BaseUVs ? UVsValue : AddHLSLVariable(TEXT("float2"), TEXT("UVs"), UVsValue);
+	}
+
+	// recalculate filter width to use for these uvs if the SDF gradient can ever be scaled
+	const bool bHasModifiedScale = !(Layer->Transform.Scale - FVector2f::One()).IsNearlyZero();
+	if (MGFXMaterial->bComputeFilterWidth && (bNoOptimization || bHasModifiedScale))
+	{
+		LayerOutputs.FilterWidth = AddHLSLVariable(TEXT("float"), TEXT("FilterWidth"),
+		                                           FString::Printf(TEXT("MGFX_FilterWidth(%s)"), *LayerOutputs.UVs));
+	}
+	else
+	{
+		// reuse parent filter width
+		LayerOutputs.FilterWidth = UVs.FilterWidth;
+	}
+
+	EndExpressionGroup(GeneratedLayer.TransformGroup);
+	GeneratedLayer.NumHLSLFunctionCalls += FMGFXMaterialCost::CountHLSLFunctionCalls(HLSLCode.Mid(CodeStartIdx));
+
+	// generate children layers bottom to top
+	FMGFXMaterialHLSLLayerOutputs ChildOutputs;
+	for (int32 Idx = Layer->NumLayers() - 1; Idx >= 0; --Idx)
+	{
+		const UMGFXMaterialLayer* ChildLayer = Layer->GetLayer(Idx);
+
+		ChildOutputs = GenerateLayerHLSL(ChildLayer, LayerOutputs, ChildOutputs);
+	}
+
+	CodeStartIdx = HLSLCode.Len();
+	BeginExpressionGroup(GeneratedLayer.ShapeGroup);
+
+	// generate shape for this layer
+	if (Layer->Shape)
+	{
+		if (Layer->HasLayers())
+		{
+			HLSLCode += FString::Printf(TEXT("\n// %s\n"), *LayerName);
+		}
+
+		const int32 ShapeCodeStartIdx = HLSLCode.Len();
+		FString CoverageMargin;
+
+		LayerOutputs.Shape = GenerateShapeHLSL(Layer->Shape, LayerOutputs.UVs, ParamPrefix, ParamGroup);
+		if (!LayerOutputs.Shape.IsEmpty())
+		{
+			// merge with the shape below before generating visuals, so that merged shapes share the same visuals
+			if (!PrevOutputs.Shape.IsEmpty())
+			{
+				LayerOutputs.Shape = GenerateMergeShapesHLSL(PrevOutputs.Shape, LayerOutputs.Shape, Layer->Shape->ShapeMergeOperation,
+				                                             Layer->Shape->ShapeMergeSmoothness);
+			}
+
+			// the visuals of shapes merged with the shape above are generated by that shape instead
+			if (!IsShapeMergedWithNext(Layer))
+			{
+				LayerOutputs.Visual = GenerateShapeVisualsHLSL(Layer->Shape, LayerOutputs.Shape, LayerOutputs.FilterWidth, ParamPrefix, ParamGroup,
+				                                               &CoverageMargin);
+
+				if (CanBranchOnBounds(Layer))
+				{
+					GenerateBoundsBranchHLSL(Layer, ShapeCodeStartIdx, CoverageMargin, LayerOutputs);
+				}
+			}
+		}
+	}
+
+	EndExpressionGroup(GeneratedLayer.ShapeGroup);
+
+	// merge this layer with its children
+	if (!ChildOutputs.Visual.IsEmpty())
+	{
+		LayerOutputs.Visual = LayerOutputs.Visual.IsEmpty()
+			                      ? ChildOutputs.Visual
+			                      : GenerateMergeVisualHLSL(LayerOutputs.Visual, ChildOutputs.Visual, Layer->MergeOperation);
+	}
+
+	// merge this layer with the previous sibling
+	if (!PrevOutputs.Visual.IsEmpty())
+	{
+		LayerOutputs.Visual = LayerOutputs.Visual.IsEmpty()
+			                      ? PrevOutputs.Visual
+			                      : GenerateMergeVisualHLSL(LayerOutputs.Visual, PrevOutputs.Visual, Layer->MergeOperation);
+	}
+
+	GeneratedLayer.NumHLSLFunctionCalls += FMGFXMaterialCost::CountHLSLFunctionCalls(HLSLCode.Mid(CodeStartIdx));
+	NewGenerated.Layers.Add(Layer, MoveTemp(GeneratedLayer));
+
+	return LayerOutputs;
+}
+
+FString FMGFXMaterialGenerator::GenerateTransformUVsHLSL(const FMGFXShapeTransform2D& Transform, const FString& InUVs,
+                                                         const FString& ParamPrefix, const FName& ParamGroup, const UMGFXMaterialLayer* Layer)
+{
+	// animated components are evaluated from their keys instead of parameters
+	const FMGFXPropertyAnimation* LocationAnimation = FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Location));
+	const FMGFXPropertyAnimation* RotationAnimation = FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Rotation));
+	const FMGFXPropertyAnimation* ScaleAnimation = FindAnimation(Layer, GET_MEMBER_NAME_CHECKED(FMGFXShapeTransform2D, Scale));
+
+	const FString Location = LocationAnimation
+		                         ? GenerateAnimationHLSL(*LocationAnimation, EMGFXMaterialShapeInputType::Vector2)
+		                         : GenerateVector2ParameterHLSL(Transform.Location, ParamPrefix, ParamGroup, 10, Param_LocationX, Param_LocationY);
+	const FString Rotation = RotationAnimation
+		                         ? GenerateAnimationHLSL(*RotationAnimation, EMGFXMaterialShapeInputType::Float, true)
+		                         : GenerateVectorParameterHLSL(FMGFXShapeTransform2D::GetRotationParameterValue(Transform.Rotation),
+		                                                       ParamPrefix + Param_RotationAxis, ParamGroup, 20);
+	const FString Scale = ScaleAnimation
+		                      ? GenerateAnimationHLSL(*ScaleAnimation, EMGFXMaterialShapeInputType::Vector2)
+		                      : GenerateVector2ParameterHLSL(Transform.Scale, ParamPrefix, ParamGroup, 30, Param_ScaleX, Param_ScaleY);
+
+	// subtract so that coordinate space matches UMG, positive offset means going right or down
+	return FString::Printf(TEXT("MGFX_Rotate(%s - %s, %s.xy) / %s"), *InUVs, *Location, *Rotation, *Scale);
+}
+
+FString FMGFXMaterialGenerator::GenerateStaticTransformUVsHLSL(const FTransform2D& Transform, const FString& InUVs) const
+{
+	FVector2f AxisX, AxisY, Offset;
+	GetInverseTransformRows(Transform, AxisX, AxisY, Offset);
+
+	const bool bHasTranslation = !Offset.IsNearlyZero();
+	const bool bHasRotationOrScale = !AxisX.Equals(FVector2f(1.f, 0.f)) || !AxisY.Equals(FVector2f(0.f, 1.f));
+
+	if (!bHasRotationOrScale)
+	{
+		return bHasTranslation ? FString::Printf(TEXT("%s + %s"), *InUVs, *ToHLSL(Offset)) : InUVs;
+	}
+
+	return FString::Printf(TEXT("MGFX_Transform(%s, float3(%s, %s, %s), float3(%s, %s, %s))"), *InUVs,
+	                       *ToHLSL(AxisX.X), *ToHLSL(AxisY.X), *ToHLSL(Offset.X),
+	                       *ToHLSL(AxisX.Y), *ToHLSL(AxisY.Y), *ToHLSL(Offset.Y));
+}
+
+FString FMGFXMaterialGenerator::GenerateShapeHLSL(const UMGFXMaterialShape* Shape, const FString& InUVs,
+                                                  const FString& ParamPrefix, const FName& ParamGroup)
 {
 	check(Shape);
 
-	TArray<FMGFXMaterialShapeInput> Inputs = Shape->GetInputs();
+	const FString FunctionName = Shape->GetHLSLFunctionName();
+	if (FunctionName.IsEmpty())
+	{
+		UE_LOG(LogMGFXEditor, Warning, TEXT("%s has no HLSL function, and will not be generated: %s"),
+		       *GetNameSafe(Shape->GetClass()), *GetNameSafe(MGFXMaterial));
+		return FString();
+	}
+
+	const FString IncludeFilePath = Shape->GetHLSLIncludeFilePath();
+	if (!IncludeFilePath.IsEmpty())
+	{
+		HLSLIncludeFilePaths.AddUnique(IncludeFilePath);
+	}
 
 	int32 ParamSortPriority = 50;
 
-	// keep track of original Y so it can be restored after generating inputs
-	const int32 OrigNodePoseY = Pos.Y;
+	const bool bNoOptimization = ShouldParameterizeAllValues() || IsLayerLive(Shape->GetTypedOuter<UMGFXMaterialLayer>());
 
-	// create shape inputs
-	TArray<UMaterialExpression*> InputExps;
-	Pos.Y += GridSize * 8;
-	for (const FMGFXMaterialShapeInput& Input : Inputs)
+	TArray<FString> Args = {InUVs};
+	for (const FMGFXMaterialShapeInput& Input : Shape->GetInputs())
 	{
 		const FLinearColor Value = Input.Value;
 
-		// TODO: allow user to mark as exposed
-		bool bShouldBeParameter = true;
+		// animated inputs are evaluated from their keys instead of a parameter or constant
+		if (const FMGFXPropertyAnimation* Animation = FindAnimation(Shape, FName(Input.Name)))
+		{
+			Args.Add(GenerateAnimationHLSL(*Animation, Input.Type));
+			continue;
+		}
+
+		// bake the value as a constant unless it needs to be animated
+		const bool bShouldBeParameter = bNoOptimization || Shape->IsInputExposed(Input.Name);
 
 		if (bShouldBeParameter)
 		{
-			// setup input as scalar params, Vector2's will be represented by 2 scalar params
-			UMaterialExpression* InputExp;
+			const FString ParamName = ParamPrefix + Input.Name;
 			switch (Input.Type)
 			{
 			default:
 			case EMGFXMaterialShapeInputType::Float:
-				InputExp = Builder.Create<UMaterialExpressionScalarParameter>(Pos);
+				Args.Add(GenerateScalarParameterHLSL(Value.R, ParamName, ParamGroup, ParamSortPriority));
 				break;
 			case EMGFXMaterialShapeInputType::Vector2:
-				InputExp = GenerateVector2Parameter(FVector2f(Input.Value.R, Input.Value.G),
-				                                    ParamPrefix, ParamGroup, ParamSortPriority, Input.Name + TEXT("X"), Input.Name + TEXT("Y"));
-				++ParamSortPriority;
+				// Vector2's are represented by 2 scalar params
+				Args.Add(GenerateVector2ParameterHLSL(FVector2f(Value.R, Value.G), ParamPrefix, ParamGroup, ParamSortPriority,
+				                                      Input.Name + TEXT("X"), Input.Name + TEXT("Y")));
 				break;
 			case EMGFXMaterialShapeInputType::Vector3:
+				Args.Add(GenerateVectorParameterHLSL(Value, ParamName, ParamGroup, ParamSortPriority) + TEXT(".rgb"));
+				break;
 			case EMGFXMaterialShapeInputType::Vector4:
-				// its normal to ignore the extra A channel for a Vector3 param
-				InputExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos);
+				Args.Add(GenerateVectorParameterHLSL(Value, ParamName, ParamGroup, ParamSortPriority));
 				break;
 			}
-			check(InputExp);
-
-			InputExps.Add(InputExp);
-
-			// configure parameter
-			// Vector2 params will already be configured, and the InputExp is actually an append.
-			if (UMaterialExpressionParameter* ParamExp = Cast<UMaterialExpressionParameter>(InputExp))
-			{
-				// TODO: include Shape name in the prefix, since there may be multiple shapes
-				Builder.ConfigureParameter(ParamExp, FName(ParamPrefix + Input.Name), ParamGroup, ParamSortPriority);
-				++ParamSortPriority;
-			}
-
-			if (auto* ConstExp = Cast<UMaterialExpressionScalarParameter>(InputExp))
-			{
-				SET_PROP(ConstExp, DefaultValue, Value.R);
-			}
-			else if (auto* Const2Exp = Cast<UMaterialExpressionVectorParameter>(InputExp))
-			{
-				SET_PROP(Const2Exp, DefaultValue, Value);
-			}
-
-			Pos.Y += GridSize * 8;
+			++ParamSortPriority;
 		}
 		else
 		{
-			// setup input as constant expressions
-			TSubclassOf<UMaterialExpression> InputExpClass = nullptr;
 			switch (Input.Type)
 			{
+			default:
 			case EMGFXMaterialShapeInputType::Float:
-				InputExpClass = UMaterialExpressionConstant::StaticClass();
+				Args.Add(ToHLSL(Value.R));
 				break;
 			case EMGFXMaterialShapeInputType::Vector2:
-				InputExpClass = UMaterialExpressionConstant2Vector::StaticClass();
+				Args.Add(ToHLSL(FVector2f(Value.R, Value.G)));
 				break;
 			case EMGFXMaterialShapeInputType::Vector3:
-				InputExpClass = UMaterialExpressionConstant3Vector::StaticClass();
+				Args.Add(ToHLSL(Value) + TEXT(".rgb"));
 				break;
 			case EMGFXMaterialShapeInputType::Vector4:
-				InputExpClass = UMaterialExpressionConstant4Vector::StaticClass();
+				Args.Add(ToHLSL(Value));
 				break;
 			}
-			check(InputExpClass);
+		}
+	}
 
-			UMaterialExpression* InputExp = Builder.Create(InputExpClass, Pos);
-			check(InputExp);
-			InputExps.Add(InputExp);
+	return AddHLSLVariable(TEXT("float"), TEXT("SDF"), FString::Printf(TEXT("%s(%s)"), *FunctionName, *FString::Join(Args, TEXT(", "))));
+}
 
-			if (auto* ConstExp = Cast<UMaterialExpressionConstant>(InputExp))
-			{
-				SET_PROP(ConstExp, R, Value.R);
-			}
-			else if (auto* Const2Exp = Cast<UMaterialExpressionConstant2Vector>(InputExp))
+FString FMGFXMaterialGenerator::GenerateShapeVisualsHLSL(const UMGFXMaterialShape* Shape, const FString& ShapeSDF, const FString& FilterWidth,
+                                                         const FString& ParamPrefix, const FName& ParamGroup, FString* OutCoverageMargin)
+{
+	// the filter width is shared by all visuals that compute it
+	FString ComputedFilterWidth;
+
+	// generate all visuals from the same SDF, merging each over the previous ones
+	FString Result;
+	for (const UMGFXMaterialShapeVisual* Visual : Shape->Visuals)
+	{
+		const FString VisualParamPrefix = GetVisualParamPrefix(ParamPrefix, Visual);
+
+		FString VisualValue;
+		if (const UMGFXMaterialShapeFill* Fill = Cast<UMGFXMaterialShapeFill>(Visual))
+		{
+			if (Fill->bComputeFilterWidth && ComputedFilterWidth.IsEmpty())
 			{
-				SET_PROP(Const2Exp, R, Value.R);
-				SET_PROP(Const2Exp, G, Value.G);
+				ComputedFilterWidth = AddHLSLVariable(TEXT("float"), TEXT("FilterWidth"), FString::Printf(TEXT("MGFX_FilterWidth(%s)"), *ShapeSDF));
 			}
-			else if (auto* Const3Exp = Cast<UMaterialExpressionConstant3Vector>(InputExp))
+			const FString FillFilterWidth = Fill->bComputeFilterWidth ? ComputedFilterWidth : FilterWidth;
+			const FString Coverage = FString::Printf(TEXT("MGFX_Fill(%s, %s, %s)"),
+			                                         *ShapeSDF, *FillFilterWidth, Fill->bEnableFilterBias ? TEXT("true") : TEXT("false"));
+			const FMGFXPropertyAnimation* ColorAnimation = FindAnimation(Fill, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeFill, Color));
+			const FString Color = ColorAnimation
+				                      ? GenerateAnimationHLSL(*ColorAnimation, EMGFXMaterialShapeInputType::Vector4)
+				                      : GenerateVectorParameterHLSL(Fill->GetColor(), VisualParamPrefix + "Color", ParamGroup, 40);
+
+			VisualValue = FString::Printf(TEXT("MGFX_Tint(%s, %s)"), *Coverage, *Color);
+		}
+		else if (const UMGFXMaterialShapeStroke* const Stroke = Cast<UMGFXMaterialShapeStroke>(Visual))
+		{
+			if (Stroke->bComputeFilterWidth && ComputedFilterWidth.IsEmpty())
 			{
-				SET_PROP(Const3Exp, Constant, Value);
+				ComputedFilterWidth = AddHLSLVariable(TEXT("float"), TEXT("FilterWidth"), FString::Printf(TEXT("MGFX_FilterWidth(%s)"), *ShapeSDF));
 			}
-			else if (auto* Const4Exp = Cast<UMaterialExpressionConstant4Vector>(InputExp))
+			const FMGFXPropertyAnimation* StrokeWidthAnimation = FindAnimation(Stroke, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, StrokeWidth));
+			const FString StrokeWidth = StrokeWidthAnimation
+				                            ? GenerateAnimationHLSL(*StrokeWidthAnimation, EMGFXMaterialShapeInputType::Float)
+				                            : GenerateScalarParameterHLSL(Stroke->StrokeWidth, VisualParamPrefix + "StrokeWidth", ParamGroup, 40);
+			const FString StrokeFilterWidth = Stroke->bComputeFilterWidth ? ComputedFilterWidth : FilterWidth;
+			const FString Coverage = FString::Printf(TEXT("MGFX_Stroke(%s, %s, %s)"), *ShapeSDF, *StrokeWidth, *StrokeFilterWidth);
+			const FMGFXPropertyAnimation* ColorAnimation = FindAnimation(Stroke, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, Color));
+			const FString Color = ColorAnimation
+				                      ? GenerateAnimationHLSL(*ColorAnimation, EMGFXMaterialShapeInputType::Vector4)
+				                      : GenerateVectorParameterHLSL(Stroke->GetColor(), VisualParamPrefix + "Color", ParamGroup, 40);
+
+			if (OutCoverageMargin)
 			{
-				SET_PROP(Const4Exp, Constant, Value);
+				// half of the stroke is outside the shape, use the widest stroke
+				const FString StrokeMargin = FString::Printf(TEXT("%s * 0.5"), *StrokeWidth);
+				*OutCoverageMargin = OutCoverageMargin->IsEmpty()
+					                     ? StrokeMargin
+					                     : FString::Printf(TEXT("max(%s, %s)"), **OutCoverageMargin, *StrokeMargin);
 			}
 
-			Pos.Y += GridSize * 8;
+			VisualValue = FString::Printf(TEXT("MGFX_Tint(%s, %s)"), *Coverage, *Color);
 		}
-	}
-	check(Inputs.Num() == InputExps.Num());
 
-	Pos.X += GridSize * 20;
-	Pos.Y = OrigNodePoseY;
+		if (!VisualValue.IsEmpty())
+		{
+			const FString VisualVar = AddHLSLVariable(TEXT("float4"), TEXT("Visual"), VisualValue);
+			Result = Result.IsEmpty() ? VisualVar : GenerateMergeVisualHLSL(VisualVar, Result, EMGFXLayerMergeOperation::Over);
+		}
+	}
 
-	// create shape function
-	UMaterialExpressionMaterialFunctionCall* ShapeExp = Builder.CreateFunction(Pos, Shape->GetMaterialFunctionPtr());
+	return Result;
+}
 
-	// connect uvs
-	if (InUVsExp)
+bool FMGFXMaterialGenerator::CanBranchOnBounds(const UMGFXMaterialLayer* Layer) const
+{
+	if (!MGFXMaterial->bEnableBoundsBranching || !Layer->HasBounds())
 	{
-		Builder.Connect(InUVsExp, "", ShapeExp, "UVs");
+		return false;
 	}
 
-	// connect inputs
-	for (int32 Idx = 0; Idx < Inputs.Num(); ++Idx)
+	// bounds are computed from the shape inputs, and can't change once generated
+	if (ShouldParameterizeAllValues() || IsLayerLive(Layer))
 	{
-		const FMGFXMaterialShapeInput& Input = Inputs[Idx];
-		UMaterialExpression* InputExp = InputExps[Idx];
-
-		Builder.Connect(InputExp, "", ShapeExp, Input.Name);
+		return false;
 	}
 
-	Pos.X += GridSize * 15;
-
-	return ShapeExp;
-}
+	for (const FMGFXMaterialShapeInput& Input : Layer->Shape->GetInputs())
+	{
+		if (Layer->Shape->IsInputExposed(Input.Name) || FindAnimation(Layer->Shape, FName(Input.Name)))
+		{
+			return false;
+		}
+	}
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateShapeVisuals(const UMGFXMaterialShape* Shape, UMaterialExpression* ShapeExp,
-                                                                  UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
-                                                                  const FString& ParamPrefix, const FName& ParamGroup)
-{
-	// TODO: support multiple visuals
-	// generate visuals
-	for (const UMGFXMaterialShapeVisual* Visual : Shape->Visuals)
+	// derivatives of the SDF are undefined inside a dynamic branch
+	for (const UMGFXMaterialShapeVisual* Visual : Layer->Shape->Visuals)
 	{
-		if (const UMGFXMaterialShapeFill* Fill = Cast<UMGFXMaterialShapeFill>(Visual))
+		const UMGFXMaterialShapeFill* Fill = Cast<UMGFXMaterialShapeFill>(Visual);
+		const UMGFXMaterialShapeStroke* Stroke = Cast<UMGFXMaterialShapeStroke>(Visual);
+		if ((Fill && Fill->bComputeFilterWidth) || (Stroke && Stroke->bComputeFilterWidth))
 		{
-			return GenerateShapeFill(Fill, ShapeExp, FilterWidthExp, ParamPrefix, ParamGroup);
+			return false;
 		}
-		else if (const UMGFXMaterialShapeStroke* const Stroke = Cast<UMGFXMaterialShapeStroke>(Visual))
+
+		// the coverage margin is computed inside the branch when the stroke width is animated
+		if (Stroke && FindAnimation(Stroke, GET_MEMBER_NAME_CHECKED(UMGFXMaterialShapeStroke, StrokeWidth)))
 		{
-			return GenerateShapeStroke(Stroke, ShapeExp, FilterWidthExp, ParamPrefix, ParamGroup);
+			return false;
 		}
-		// TODO: combine visuals, don't just use the last one
 	}
 
-	return nullptr;
+	// merged shapes need the real distance outside of the bounds.
+	if (Layer->Shape->ShapeMergeOperation != EMGFXShapeMergeOperation::None || IsShapeMergedWithNext(Layer))
+	{
+		return false;
+	}
+
+	return true;
 }
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateMergeVisual(UMaterialExpression* AExp, UMaterialExpression* BExp, EMGFXLayerMergeOperation Operation,
-                                                                 const FString& ParamPrefix, const FName& ParamGroup)
+bool FMGFXMaterialGenerator::IsShapeMergedWithNext(const UMGFXMaterialLayer* Layer)
 {
-	// default to over
-	TSoftObjectPtr<UMaterialFunctionInterface> MergeFunc = nullptr;
-
-	switch (Operation)
+	if (!Layer->Shape)
 	{
-	case EMGFXLayerMergeOperation::Over:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Over");
-		break;
-	case EMGFXLayerMergeOperation::Add:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Add");
-		break;
-	case EMGFXLayerMergeOperation::Subtract:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Subtract");
-		break;
-	case EMGFXLayerMergeOperation::Multiply:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Multiply");
-		break;
-	case EMGFXLayerMergeOperation::In:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("In");
-		break;
-	case EMGFXLayerMergeOperation::Out:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Out");
-		break;
-	case EMGFXLayerMergeOperation::Mask:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Mask");
-		break;
-	case EMGFXLayerMergeOperation::Stencil:
-		MergeFunc = FMGFXMaterialFunctions::GetMerge("Stencil");
-		break;
-	default: ;
+		return false;
 	}
 
-	if (MergeFunc.IsNull())
+	// layers are generated bottom to top, so the next sibling is the one above this layer
+	if (const IMGFXMaterialLayerParentInterface* Container = Layer->GetParentContainer())
 	{
-		// no valid merge function
-		return AExp;
+		const int32 LayerIdx = Container->GetLayerIndex(Layer);
+		const UMGFXMaterialLayer* NextLayer = LayerIdx > 0 ? Container->GetLayer(LayerIdx - 1) : nullptr;
+		return NextLayer && NextLayer->Shape && NextLayer->Shape->ShapeMergeOperation != EMGFXShapeMergeOperation::None;
 	}
 
-	UMaterialExpressionMaterialFunctionCall* MergeExp = Builder.CreateFunction(Pos, MergeFunc);
-	Builder.Connect(AExp, "", MergeExp, "A");
-	Builder.Connect(BExp, "", MergeExp, "B");
+	return false;
+}
 
-	Pos.X += GridSize * 15;
+void FMGFXMaterialGenerator::GenerateBoundsBranchHLSL(const UMGFXMaterialLayer* Layer, int32 CodeStartIdx, const FString& CoverageMargin,
+                                                      FMGFXMaterialHLSLLayerOutputs& LayerOutputs)
+{
+	// move the shape and visual code into the branch
+	const FString BranchCode = HLSLCode.Mid(CodeStartIdx);
+	HLSLCode.LeftInline(CodeStartIdx);
+
+	// skipped pixels are far outside the shape and fully transparent
+	const FString Shape = AddHLSLVariable(TEXT("float"), TEXT("SDF"), ToHLSL(1e5f));
+	const FString Visual = LayerOutputs.Visual.IsEmpty() ? FString() : AddHLSLVariable(TEXT("float4"), TEXT("Visual"), TEXT("float4(0, 0, 0, 0)"));
+
+	// test in the layer's local space, which already includes all parent and animated transforms.
+	// filtering can cover up to a full filter width outside the shape when biased.
+	const FBox2D Bounds = Layer->GetBounds();
+	const FLinearColor BoundsValue(Bounds.Min.X, Bounds.Min.Y, Bounds.Max.X, Bounds.Max.Y);
+	const FString Margin = CoverageMargin.IsEmpty()
+		                       ? LayerOutputs.FilterWidth
+		                       : FString::Printf(TEXT("%s + %s"), *LayerOutputs.FilterWidth, *CoverageMargin);
+
+	HLSLCode += FString::Printf(TEXT("[branch] if (MGFX_IsInBounds(%s, %s, %s))\n{\n"), *LayerOutputs.UVs, *ToHLSL(BoundsValue), *Margin);
+
+	TArray<FString> Lines;
+	BranchCode.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		HLSLCode += FString::Printf(TEXT("\t%s\n"), *Line);
+	}
 
-	return MergeExp;
+	HLSLCode += FString::Printf(TEXT("\t%s = %s;\n"), *Shape, *LayerOutputs.Shape);
+	if (!Visual.IsEmpty())
+	{
+		HLSLCode += FString::Printf(TEXT("\t%s = %s;\n"), *Visual, *LayerOutputs.Visual);
+	}
+	HLSLCode += TEXT("}\n");
+
+	LayerOutputs.Shape = Shape;
+	LayerOutputs.Visual = Visual;
 }
 
+FString FMGFXMaterialGenerator::GenerateMergeVisualHLSL(const FString& A, const FString& B, EMGFXLayerMergeOperation Operation)
+{
+	const FString MergeName = GetMergeOperationName(Operation);
+	if (MergeName.IsEmpty())
+	{
+		// no valid merge function
+		return A;
+	}
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateMergeShapes(UMaterialExpression* AExp, UMaterialExpression* BExp, EMGFXShapeMergeOperation Operation,
-                                                                 const FString& ParamPrefix, const FName& ParamGroup)
+	return AddHLSLVariable(TEXT("float4"), TEXT("Merge"), FString::Printf(TEXT("MGFX_Merge_%s(%s, %s)"), *MergeName, *A, *B));
+}
+
+FString FMGFXMaterialGenerator::GenerateMergeShapesHLSL(const FString& A, const FString& B, EMGFXShapeMergeOperation Operation, float Smoothness)
 {
-	if (Operation == EMGFXShapeMergeOperation::None)
+	const FString MergeName = GetShapeMergeOperationName(Operation);
+	if (MergeName.IsEmpty())
 	{
-		return BExp;
+		return B;
 	}
 
-	return nullptr;
+	const FString Value = Smoothness > 0.f
+		                      ? FString::Printf(TEXT("MGFX_SmoothMergeShapes_%s(%s, %s, %s)"), *MergeName, *A, *B, *ToHLSL(Smoothness))
+		                      : FString::Printf(TEXT("MGFX_MergeShapes_%s(%s, %s)"), *MergeName, *A, *B);
+
+	return AddHLSLVariable(TEXT("float"), TEXT("SDF"), Value);
 }
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateVector2Parameter(FVector2f DefaultValue,
-                                                                      const FString& ParamPrefix, const FName& ParamGroup, int32 BaseSortPriority,
-                                                                      const FString& ParamNameX, const FString& ParamNameY)
+FString FMGFXMaterialGenerator::GenerateScalarParameterHLSL(float Value, const FString& ParamName, const FName& ParamGroup, int32 SortPriority)
 {
-	UMaterialExpressionScalarParameter* XExp = Builder.CreateScalarParam(
-		Pos, FName(ParamPrefix + ParamNameX), ParamGroup, BaseSortPriority);
-	SET_PROP(XExp, DefaultValue, DefaultValue.X);
+	if (ShouldPackParameters())
+	{
+		return GeneratePackedParameterHLSL({Value}, {ParamName}, ParamGroup, SortPriority);
+	}
 
-	UMaterialExpressionScalarParameter* YExp = Builder.CreateScalarParam(
-		Pos + FVector2D(0, GridSize * 6), FName(ParamPrefix + ParamNameY), ParamGroup, BaseSortPriority + 1);
-	SET_PROP(YExp, DefaultValue, DefaultValue.Y);
+	UMaterialExpressionScalarParameter* ParamExp = Builder.CreateScalarParam(Pos, FName(ParamName), ParamGroup, SortPriority);
+	SET_PROP(ParamExp, DefaultValue, Value);
 
-	Pos.X += GridSize * 15;
+	Pos.Y += GridSize * 6;
 
-	// append
-	UMaterialExpressionAppendVector* AppendExp = Builder.CreateAppend(Pos, XExp, YExp);
+	return AddHLSLInput(ParamExp, ParamName);
+}
 
-	Pos.X += GridSize * 15;
+FString FMGFXMaterialGenerator::GenerateVectorParameterHLSL(const FLinearColor& Value, const FString& ParamName, const FName& ParamGroup,
+                                                            int32 SortPriority)
+{
+	UMaterialExpressionVectorParameter* ParamExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos);
+	Builder.ConfigureParameter(ParamExp, FName(ParamName), ParamGroup, SortPriority);
+	SET_PROP(ParamExp, DefaultValue, Value);
 
-	return AppendExp;
+	Pos.Y += GridSize * 10;
+
+	return AddHLSLInput(ParamExp, ParamName);
 }
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateShapeFill(const UMGFXMaterialShapeFill* Fill, UMaterialExpression* ShapeExp,
-                                                               UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
-                                                               const FString& ParamPrefix, const FName& ParamGroup)
+FString FMGFXMaterialGenerator::GenerateVector2ParameterHLSL(FVector2f Value, const FString& ParamPrefix, const FName& ParamGroup,
+                                                             int32 BaseSortPriority, const FString& ParamNameX, const FString& ParamNameY)
 {
-	// add reused filter width input
-	UMaterialExpressionNamedRerouteUsage* FilterWidthUsageExp = nullptr;
-	if (!Fill->bComputeFilterWidth)
+	if (ShouldPackParameters())
 	{
-		FilterWidthUsageExp = Builder.CreateNamedRerouteUsage(Pos + FVector2D(0, GridSize * 8), FilterWidthExp);
+		return GeneratePackedParameterHLSL({Value.X, Value.Y}, {ParamPrefix + ParamNameX, ParamPrefix + ParamNameY}, ParamGroup, BaseSortPriority);
 	}
 
-	// optionally enable filter bias
-	UMaterialExpressionStaticBool* EnableBiasExp = nullptr;
-	if (Fill->bEnableFilterBias)
-	{
-		EnableBiasExp = Builder.Create<UMaterialExpressionStaticBool>(Pos + FVector2D(0, GridSize * 16));
-		SET_PROP_R(EnableBiasExp, Value, 1);
-	}
+	const FString X = GenerateScalarParameterHLSL(Value.X, ParamPrefix + ParamNameX, ParamGroup, BaseSortPriority);
+	const FString Y = GenerateScalarParameterHLSL(Value.Y, ParamPrefix + ParamNameY, ParamGroup, BaseSortPriority + 1);
+	return FString::Printf(TEXT("float2(%s, %s)"), *X, *Y);
+}
 
-	Pos.X += GridSize * 15;
+FString FMGFXMaterialGenerator::GeneratePackedParameterHLSL(TConstArrayView<float> Values, TConstArrayView<FString> ParamNames,
+                                                            const FName& ParamGroup, int32 SortPriority)
+{
+	int32 Channel;
+	UMaterialExpressionVectorParameter* ParamExp = AllocatePackedChannels(Pos, Values, ParamNames, ParamGroup, SortPriority, Channel);
 
-	// add fill func
-	UMaterialExpressionMaterialFunctionCall* FillExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Fill"));
-	Builder.Connect(ShapeExp, "SDF", FillExp, "SDF");
-	if (FilterWidthUsageExp)
-	{
-		Builder.Connect(FilterWidthUsageExp, "", FillExp, "FilterWidth");
-	}
-	if (EnableBiasExp)
+	if (PackedParamHLSLInput.IsEmpty())
 	{
-		Builder.Connect(EnableBiasExp, "", FillExp, "EnableFilterBias");
-	}
-
-	Pos.X += GridSize * 15;
+		// a new vector parameter was created
+		PackedParamHLSLInput = AddHLSLInput(ParamExp, ParamExp->ParameterName.ToString());
 
-	// add color param
-	UMaterialExpressionVectorParameter* ColorExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos + FVector2D(0, GridSize * 8));
-	Builder.ConfigureParameter(ColorExp, FName(ParamPrefix + "Color"), ParamGroup, 40);
-	SET_PROP_R(ColorExp, DefaultValue, Fill->GetColor());
+		Pos.Y += GridSize * 10;
+	}
 
-	Pos.X += GridSize * 15;
+	return FString::Printf(TEXT("%s.%s"), *PackedParamHLSLInput, *FString(TEXT("rgba")).Mid(Channel, Values.Num()));
+}
 
-	// mutiply by color, and append to RGBA
-	UMaterialExpressionMaterialFunctionCall* TintExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Tint"));
-	Builder.Connect(FillExp, "", TintExp, "In");
-	Builder.Connect(ColorExp, "", TintExp, "RGB");
-	Builder.Connect(ColorExp, "A", TintExp, "A");
+FString FMGFXMaterialGenerator::AddHLSLInput(UMaterialExpression* InputExp, const FString& Name)
+{
+	check(InputExp);
 
-	Pos.X += GridSize * 15;
+	// input names must be unique and valid HLSL identifiers
+	FString InputName = FString::Printf(TEXT("In%d_"), HLSLInputs.Num());
+	for (const TCHAR Char : Name)
+	{
+		InputName.AppendChar(FChar::IsAlnum(Char) && Char < 128 ? Char : TEXT('_'));
+	}
 
-	return TintExp;
+	HLSLInputs.Emplace(FName(InputName), InputExp);
+	return InputName;
 }
 
-UMaterialExpression* FMGFXMaterialGenerator::GenerateShapeStroke(const UMGFXMaterialShapeStroke* Stroke, UMaterialExpression* ShapeExp,
-                                                                 UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
-                                                                 const FString& ParamPrefix, const FName& ParamGroup)
+FString FMGFXMaterialGenerator::AddHLSLVariable(const FString& Type, const FString& Name, const FString& Value)
 {
-	// add stroke width input
-	UMaterialExpressionScalarParameter* StrokeWidthExp = Builder.CreateScalarParam(
-		Pos + FVector2D(0, GridSize * 8), FName(ParamPrefix + "StrokeWidth"), ParamGroup, 40);
-	SET_PROP(StrokeWidthExp, DefaultValue, Stroke->StrokeWidth);
+	const FString VariableName = FString::Printf(TEXT("%s_%d"), *Name, NumHLSLVariables++);
+	HLSLCode += FString::Printf(TEXT("%s %s = %s;\n"), *Type, *VariableName, *Value);
+	return VariableName;
+}
 
-	// add reused filter width input
-	UMaterialExpressionNamedRerouteUsage* FilterWidthUsageExp = nullptr;
-	if (!Stroke->bComputeFilterWidth)
+FString FMGFXMaterialGenerator::GenerateAnimationHLSL(const FMGFXPropertyAnimation& Animation, EMGFXMaterialShapeInputType Type, bool bIsRotation)
+{
+	// all animations share a single time input
+	if (AnimationTimeHLSLInput.IsEmpty())
 	{
-		FilterWidthUsageExp = Builder.CreateNamedRerouteUsage(Pos + FVector2D(0, GridSize * 14), FilterWidthExp);
+		AnimationTimeHLSLInput = AddHLSLInput(GenerateAnimationTime(Pos), Param_AnimationTime);
+
+		Pos.Y += GridSize * 6;
 	}
 
-	Pos.X += GridSize * 15;
+	const FString LoopTime = GetAnimationTimeHLSL(Animation, AnimationTimeHLSLInput);
+	const FString Time = LoopTime == AnimationTimeHLSLInput ? LoopTime : AddHLSLVariable(TEXT("float"), TEXT("AnimationTime"), LoopTime);
+	const FString Value = GetAnimationValueHLSL(Animation, Time, Type);
 
-	// add stroke func
-	UMaterialExpressionMaterialFunctionCall* StrokeExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Stroke"));
-	Builder.Connect(ShapeExp, "SDF", StrokeExp, "SDF");
-	Builder.Connect(StrokeWidthExp, "", StrokeExp, "StrokeWidth");
-	if (FilterWidthUsageExp)
+	if (bIsRotation)
 	{
-		Builder.Connect(FilterWidthUsageExp, "", StrokeExp, "FilterWidth");
+		return AddHLSLVariable(TEXT("float2"), TEXT("Rotation"), FString::Printf(TEXT("MGFX_RotationFromDegrees(%s)"), *Value));
 	}
 
-	Pos.X += GridSize * 15;
+	return AddHLSLVariable(GetHLSLType(Type), TEXT("Animation"), Value);
+}
 
-	// add color param
-	UMaterialExpressionVectorParameter* ColorExp = Builder.Create<UMaterialExpressionVectorParameter>(Pos + FVector2D(0, GridSize * 8));
-	Builder.ConfigureParameter(ColorExp, FName(ParamPrefix + "Color"), ParamGroup, 40);
-	SET_PROP_R(ColorExp, DefaultValue, Stroke->GetColor());
+FString FMGFXMaterialGenerator::GetHLSLType(EMGFXMaterialShapeInputType Type)
+{
+	switch (Type)
+	{
+	default:
+	case EMGFXMaterialShapeInputType::Float:
+		return TEXT("float");
+	case EMGFXMaterialShapeInputType::Vector2:
+		return TEXT("float2");
+	case EMGFXMaterialShapeInputType::Vector3:
+		return TEXT("float3");
+	case EMGFXMaterialShapeInputType::Vector4:
+		return TEXT("float4");
+	}
+}
 
-	Pos.X += GridSize * 15;
+FString FMGFXMaterialGenerator::ToHLSL(float Value)
+{
+	return FString::SanitizeFloat(Value);
+}
 
-	// mutiply by color, and append to RGBA
-	UMaterialExpressionMaterialFunctionCall* TintExp = Builder.CreateFunction(Pos, FMGFXMaterialFunctions::GetVisual("Tint"));
-	Builder.Connect(StrokeExp, "", TintExp, "In");
-	Builder.Connect(ColorExp, "", TintExp, "RGB");
-	Builder.Connect(ColorExp, "A", TintExp, "A");
+FString FMGFXMaterialGenerator::ToHLSL(const FVector2f& Value)
+{
+	return FString::Printf(TEXT("float2(%s, %s)"), *ToHLSL(Value.X), *ToHLSL(Value.Y));
+}
 
-	Pos.X += GridSize * 15;
+FString FMGFXMaterialGenerator::ToHLSL(const FLinearColor& Value)
+{
+	return FString::Printf(TEXT("float4(%s, %s, %s, %s)"), *ToHLSL(Value.R), *ToHLSL(Value.G), *ToHLSL(Value.B), *ToHLSL(Value.A));
+}
 
-	return TintExp;
+FString FMGFXMaterialGenerator::ToHLSL(const FLinearColor& Value, EMGFXMaterialShapeInputType Type)
+{
+	switch (Type)
+	{
+	default:
+	case EMGFXMaterialShapeInputType::Float:
+		return ToHLSL(Value.R);
+	case EMGFXMaterialShapeInputType::Vector2:
+		return ToHLSL(FVector2f(Value.R, Value.G));
+	case EMGFXMaterialShapeInputType::Vector3:
+		return FString::Printf(TEXT("float3(%s, %s, %s)"), *ToHLSL(Value.R), *ToHLSL(Value.G), *ToHLSL(Value.B));
+	case EMGFXMaterialShapeInputType::Vector4:
+		return ToHLSL(Value);
+	}
 }
@@ -0,0 +1,250 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+
+#include "SMGFXMaterialEditorCostReport.h"
+
+#include "DesktopPlatformModule.h"
+#include "IDesktopPlatform.h"
+#include "MGFXEditorModule.h"
+#include "MGFXMaterialEditor.h"
+#include "SlateOptMacros.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Widgets/Input/SButton.h"
+#include "Widgets/Text/STextBlock.h"
+
+#define LOCTEXT_NAMESPACE "MGFXMaterialEditor"
+
+BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+
+// SMGFXMaterialLayerCostRow
+// -------------------------
+
+void SMGFXMaterialLayerCostRow::Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& InOwnerTableView)
+{
+	Item = InArgs._Item;
+	check(Item.IsValid());
+
+	SMultiColumnTableRow::Construct(FSuperRowType::FArguments(), InOwnerTableView);
+}
+
+TSharedRef<SWidget> SMGFXMaterialLayerCostRow::GenerateWidgetForColumn(const FName& ColumnName)
+{
+	if (ColumnName == SMGFXMaterialEditorCostReport::Column_Layer)
+	{
+		// indent children to display the hierarchy
+		return SNew(STextBlock)
+			.Margin(FMargin(6.f + Item->Depth * 12.f, 2.f, 6.f, 2.f))
+			.Text(FText::FromString(Item->LayerName));
+	}
+
+	int32 Value = 0;
+	if (ColumnName == SMGFXMaterialEditorCostReport::Column_Instructions)
+	{
+		Value = Item->NumInstructions;
+	}
+	else if (ColumnName == SMGFXMaterialEditorCostReport::Column_Expressions)
+	{
+		Value = Item->NumExpressions;
+	}
+	else if (ColumnName == SMGFXMaterialEditorCostReport::Column_Parameters)
+	{
+		Value = Item->NumParameters;
+	}
+	else if (ColumnName == SMGFXMaterialEditorCostReport::Column_FunctionCalls)
+	{
+		Value = Item->NumFunctionCalls;
+	}
+
+	return SNew(STextBlock)
+		.Margin(FMargin(6.f, 2.f))
+		.Text(FText::AsNumber(Value));
+}
+
+
+// SMGFXMaterialEditorCostReport
+// -----------------------------
+
+const FName SMGFXMaterialEditorCostReport::Column_Layer(TEXT("Layer"));
+const FName SMGFXMaterialEditorCostReport::Column_Instructions(TEXT("Instructions"));
+const FName SMGFXMaterialEditorCostReport::Column_Expressions(TEXT("Expressions"));
+const FName SMGFXMaterialEditorCostReport::Column_Parameters(TEXT("Parameters"));
+const FName SMGFXMaterialEditorCostReport::Column_FunctionCalls(TEXT("FunctionCalls"));
+
+void SMGFXMaterialEditorCostReport::Construct(const FArguments& InArgs)
+{
+	check(InArgs._MGFXMaterialEditor.IsValid());
+
+	MGFXMaterialEditor = InArgs._MGFXMaterialEditor;
+
+	MGFXMaterialEditor.Pin()->OnCostReportChangedEvent.AddSP(this, &SMGFXMaterialEditorCostReport::OnEditorCostReportChanged);
+
+	ChildSlot
+	[
+		SNew(SVerticalBox)
+
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		[
+			SNew(SHorizontalBox)
+
+			+ SHorizontalBox::Slot()
+			  .FillWidth(1.f)
+			  .VAlign(VAlign_Center)
+			  .Padding(6.f)
+			[
+				SNew(STextBlock)
+				.Text(this, &SMGFXMaterialEditorCostReport::GetTotalText)
+				.AutoWrapText(true)
+			]
+
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(6.f)
+			[
+				SNew(SButton)
+				.OnClicked(this, &SMGFXMaterialEditorCostReport::OnRefreshButtonClicked)
+				.ToolTipText(LOCTEXT("RefreshCostReportTooltip", "Compile the target material and update the report"))
+				.Content()
+				[
+					SNew(STextBlock)
+					.Text(LOCTEXT("RefreshCostReport", "Refresh"))
+				]
+			]
+
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(6.f)
+			[
+				SNew(SButton)
+				.OnClicked(this, &SMGFXMaterialEditorCostReport::OnExportButtonClicked)
+				.IsEnabled(this, &SMGFXMaterialEditorCostReport::IsExportButtonEnabled)
+				.Content()
+				[
+					SNew(STextBlock)
+					.Text(LOCTEXT("ExportCostReport", "Export JSON..."))
+				]
+			]
+		]
+
+		+ SVerticalBox::Slot()
+		[
+			SAssignNew(ListView, SListView<TSharedPtr<FMGFXMaterialLayerCost>>)
+			.SelectionMode(ESelectionMode::None)
+			.ListItemsSource(&Items)
+			.OnGenerateRow(this, &SMGFXMaterialEditorCostReport::OnGenerateRow)
+			.HeaderRow
+			(
+				SNew(SHeaderRow)
+
+				+ SHeaderRow::Column(Column_Layer)
+				.DefaultLabel(LOCTEXT("LayerColumn", "Layer"))
+				.FillWidth(0.4f)
+
+				+ SHeaderRow::Column(Column_Instructions)
+				.DefaultLabel(LOCTEXT("InstructionsColumn", "Instructions"))
+				.DefaultTooltip(LOCTEXT("InstructionsColumnTooltip",
+				                        "Estimated pixel shader instructions, attributed from the compiled material by the number of operations in each layer"))
+				.FillWidth(0.15f)
+
+				+ SHeaderRow::Column(Column_Expressions)
+				.DefaultLabel(LOCTEXT("ExpressionsColumn", "Expressions"))
+				.FillWidth(0.15f)
+
+				+ SHeaderRow::Column(Column_Parameters)
+				.DefaultLabel(LOCTEXT("ParametersColumn", "Parameters"))
+				.FillWidth(0.15f)
+
+				+ SHeaderRow::Column(Column_FunctionCalls)
+				.DefaultLabel(LOCTEXT("FunctionCallsColumn", "Function Calls"))
+				.FillWidth(0.15f)
+			)
+		]
+	];
+
+	OnEditorCostReportChanged(MGFXMaterialEditor.Pin()->GetCostReport());
+}
+
+void SMGFXMaterialEditorCostReport::OnEditorCostReportChanged(const FMGFXMaterialCostReport& CostReport)
+{
+	Items.Reset(CostReport.Layers.Num());
+	for (const FMGFXMaterialLayerCost& LayerCost : CostReport.Layers)
+	{
+		Items.Add(MakeShared<FMGFXMaterialLayerCost>(LayerCost));
+	}
+
+	ListView->RequestListRefresh();
+}
+
+FText SMGFXMaterialEditorCostReport::GetTotalText() const
+{
+	if (!MGFXMaterialEditor.IsValid() || !MGFXMaterialEditor.Pin()->GetCostReport().IsValid())
+	{
+		return LOCTEXT("NoCostReport", "Refresh to compile the target material and report its cost.");
+	}
+
+	const FMGFXMaterialCostReport& CostReport = MGFXMaterialEditor.Pin()->GetCostReport();
+	return FText::Format(LOCTEXT("CostReportTotal", "{0} instructions ({1} vertex), {2} expressions, {3} parameters, {4} samplers"),
+	                     CostReport.Total.NumInstructions, CostReport.NumVertexShaderInstructions,
+	                     CostReport.Total.NumExpressions, CostReport.Total.NumParameters, CostReport.NumSamplers);
+}
+
+TSharedRef<ITableRow> SMGFXMaterialEditorCostReport::OnGenerateRow(TSharedPtr<FMGFXMaterialLayerCost> InItem,
+                                                                     const TSharedRef<STableViewBase>& OwnerTable)
+{
+	return SNew(SMGFXMaterialLayerCostRow, OwnerTable)
+		.Item(InItem);
+}
+
+FReply SMGFXMaterialEditorCostReport::OnRefreshButtonClicked()
+{
+	if (MGFXMaterialEditor.IsValid())
+	{
+		MGFXMaterialEditor.Pin()->UpdateCostReport();
+	}
+	return FReply::Handled();
+}
+
+FReply SMGFXMaterialEditorCostReport::OnExportButtonClicked()
+{
+	IDesktopPlatform* DesktopPlatform = FDesktopPlatformModule::Get();
+	if (!DesktopPlatform || !MGFXMaterialEditor.IsValid())
+	{
+		return FReply::Handled();
+	}
+
+	const FMGFXMaterialCostReport& CostReport = MGFXMaterialEditor.Pin()->GetCostReport();
+	const FString DefaultFileName = FPaths::GetBaseFilename(CostReport.MaterialName) + TEXT("_Cost.json");
+
+	TArray<FString> FileNames;
+	const bool bSelected = DesktopPlatform->SaveFileDialog(
+		FSlateApplication::Get().FindBestParentWindowHandleForDialogs(AsShared()),
+		LOCTEXT("ExportCostReportTitle", "Export Cost Report").ToString(),
+		FPaths::ProjectSavedDir(),
+		DefaultFileName,
+		TEXT("JSON (*.json)|*.json"),
+		EFileDialogFlags::None,
+		FileNames);
+
+	if (bSelected && !FileNames.IsEmpty())
+	{
+		if (!FFileHelper::SaveStringToFile(CostReport.ToJson(), *FileNames[0]))
+		{
+			UE_LOG(LogMGFXEditor, Error, TEXT("Failed to export cost report to %s"), *FileNames[0]);
+		}
+	}
+
+	return FReply::Handled();
+}
+
+bool SMGFXMaterialEditorCostReport::IsExportButtonEnabled() const
+{
+	return MGFXMaterialEditor.IsValid() && MGFXMaterialEditor.Pin()->GetCostReport().IsValid();
+}
+
+
+END_SLATE_FUNCTION_BUILD_OPTIMIZATION
+
+#undef LOCTEXT_NAMESPACE
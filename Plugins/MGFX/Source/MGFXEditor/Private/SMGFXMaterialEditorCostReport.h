@@ -0,0 +1,83 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialCostReport.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+#include "Widgets/Views/STableRow.h"
+
+class FMGFXMaterialEditor;
+
+
+/**
+ * The widget displayed for each layer in a cost report.
+ */
+class SMGFXMaterialLayerCostRow : public SMultiColumnTableRow<TSharedPtr<FMGFXMaterialLayerCost>>
+{
+public:
+	SLATE_BEGIN_ARGS(SMGFXMaterialLayerCostRow)
+		{
+		}
+
+		/** The layer cost for this row */
+		SLATE_ARGUMENT(TSharedPtr<FMGFXMaterialLayerCost>, Item)
+
+	SLATE_END_ARGS()
+
+	/** Construct function for this widget */
+	void Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& InOwnerTableView);
+
+	virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& ColumnName) override;
+
+protected:
+	TSharedPtr<FMGFXMaterialLayerCost> Item;
+};
+
+
+/**
+ * Widget displaying the compiled cost of the target material, and the estimated cost of each layer.
+ */
+class MGFXEDITOR_API SMGFXMaterialEditorCostReport : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SMGFXMaterialEditorCostReport)
+		{
+		}
+
+		SLATE_ARGUMENT(TWeakPtr<FMGFXMaterialEditor>, MGFXMaterialEditor)
+
+	SLATE_END_ARGS()
+
+	/** Constructs this widget with InArgs */
+	void Construct(const FArguments& InArgs);
+
+	/** Weak pointer to the owning material editor. */
+	TWeakPtr<FMGFXMaterialEditor> MGFXMaterialEditor;
+
+	static const FName Column_Layer;
+	static const FName Column_Instructions;
+	static const FName Column_Expressions;
+	static const FName Column_Parameters;
+	static const FName Column_FunctionCalls;
+
+protected:
+	TSharedPtr<SListView<TSharedPtr<FMGFXMaterialLayerCost>>> ListView;
+
+	/** The layer costs of the current report. */
+	TArray<TSharedPtr<FMGFXMaterialLayerCost>> Items;
+
+	/** Update the list to display a new report. */
+	void OnEditorCostReportChanged(const FMGFXMaterialCostReport& CostReport);
+
+	FText GetTotalText() const;
+
+	TSharedRef<ITableRow> OnGenerateRow(TSharedPtr<FMGFXMaterialLayerCost> InItem, const TSharedRef<STableViewBase>& OwnerTable);
+
+	FReply OnRefreshButtonClicked();
+
+	FReply OnExportButtonClicked();
+
+	bool IsExportButtonEnabled() const;
+};
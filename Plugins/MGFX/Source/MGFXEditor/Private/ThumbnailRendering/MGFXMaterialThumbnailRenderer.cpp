@@ -21,12 +21,7 @@ void UMGFXMaterialThumbnailRenderer::Draw(UObject* Object, int32 X, int32 Y, uin
 
 	const UMGFXMaterial* MGFXMaterial = Cast<UMGFXMaterial>(Object);
 
-	if (!MGFXMaterial->Material)
-	{
-		return;
-	}
-
-	UMaterialInterface* MatInst = MGFXMaterial->Material;
+	UMaterialInterface* MatInst = MGFXMaterial ? MGFXMaterial->GetOutputMaterial() : nullptr;
 	if (MatInst != nullptr)
 	{
 		UMaterial* Mat = MatInst->GetMaterial();
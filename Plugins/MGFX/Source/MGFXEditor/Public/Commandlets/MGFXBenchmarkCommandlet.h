@@ -0,0 +1,124 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialTypes.h"
+#include "Commandlets/Commandlet.h"
+#include "MGFXBenchmarkCommandlet.generated.h"
+
+class FMGFXMaterialGenerator;
+class UMGFXMaterial;
+
+
+/**
+ * The timing of generating and compiling one synthetic MGFX material.
+ */
+USTRUCT(BlueprintType)
+struct MGFXEDITOR_API FMGFXBenchmarkResult
+{
+	GENERATED_BODY()
+
+	/** The name of the synthetic layer stack. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	FString Scenario;
+
+	/** The generator backend used. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	FString Backend;
+
+	/** The total number of layers, including children. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	int32 NumLayers = 0;
+
+	/** The deepest nesting of layers, where root layers have a depth of 1. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	int32 MaxDepth = 0;
+
+	/** The number of expressions in the generated material. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	int32 NumExpressions = 0;
+
+	/** Time to generate the material from scratch, including creating all expressions, without notifying the material. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	double GenerateMs = 0.0;
+
+	/** The part of GenerateMs spent creating and connecting expressions, before merging identical ones. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	double CreateExpressionsMs = 0.0;
+
+	/** Time to regenerate the unchanged material, reusing all expressions. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	double RegenerateMs = 0.0;
+
+	/** Time to translate the material to HLSL, measured separately from compiling. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	double TranslateMs = 0.0;
+
+	/** Time to notify the material, caching its shader maps, and wait for the shader compile jobs to finish. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	double CompileMs = 0.0;
+};
+
+
+/**
+ * The results of a generator benchmark run.
+ */
+USTRUCT(BlueprintType)
+struct MGFXEDITOR_API FMGFXBenchmarkReport
+{
+	GENERATED_BODY()
+
+	/** The engine version the benchmark ran on. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	FString EngineVersion;
+
+	/** When the benchmark ran, in ISO 8601 format. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	FString Timestamp;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Benchmark")
+	TArray<FMGFXBenchmarkResult> Results;
+
+	/** Return the report as a json string. */
+	FString ToJson() const;
+};
+
+
+/**
+ * Measures the performance of FMGFXMaterialGenerator using synthetic MGFX materials of different sizes and structures,
+ * and writes the results to a json file for tracking regressions. Can be run without a display using -nullrhi.
+ *
+ * Usage: UnrealEditor-Cmd <Project> -run=MGFXBenchmark [-Sizes=10,100,1000] [-Scenarios=Flat,Nested,AllShapes,MixedMerge]
+ *        [-Backends=Graph,HLSL] [-NoCompile] [-Output=<File>]
+ *
+ * -Sizes		The number of layers to generate for each scenario.
+ * -Scenarios	Flat: sibling layers. Nested: a chain of child layers, as deep as the backend supports. AllShapes: every shape type.
+ *				MixedMerge: every merge operation.
+ * -Backends	The generator backends to benchmark.
+ * -NoCompile	Don't translate or compile the generated materials.
+ * -Output		The json file to write. Defaults to Saved/MGFX/Benchmark.json.
+ */
+UCLASS()
+class MGFXEDITOR_API UMGFXBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMGFXBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	/** The deepest chain of layers the Nested scenario creates for backends that generate each level of nesting recursively. */
+	static constexpr int32 MaxRecursiveNestedDepth = 32;
+
+	/** Return the deepest chain of layers the Nested scenario creates for a backend, which is the deepest nesting the backend supports. */
+	static int32 GetMaxNestedDepth(EMGFXMaterialGeneratorBackend Backend);
+
+protected:
+	/** Create a synthetic MGFX material for a scenario, returning null if the scenario is unknown. */
+	static UMGFXMaterial* CreateScenarioMaterial(const FString& Scenario, int32 NumLayers, EMGFXMaterialGeneratorBackend Backend);
+
+	/** Generate, regenerate, and compile a material, and return the timings. */
+	static FMGFXBenchmarkResult RunBenchmark(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, bool bCompile);
+};
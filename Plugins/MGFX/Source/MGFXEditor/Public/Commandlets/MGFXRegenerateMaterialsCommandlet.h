@@ -0,0 +1,48 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MGFXRegenerateMaterialsCommandlet.generated.h"
+
+class FMGFXMaterialGenerator;
+class UMaterial;
+class UMGFXMaterial;
+
+
+/**
+ * Regenerates the target material of every MGFX material asset, e.g. after updating the plugin.
+ * Materials that are already up to date are skipped. Shader compiles are started without waiting, so that they compile in parallel.
+ * Shared materials are regenerated in place when only the generator version changed, and the material instance of every
+ * MGFX material using a regenerated shared material is updated. Interpreted materials have their layer data texture repacked.
+ * Can be run without a display using -nullrhi.
+ *
+ * Usage: UnrealEditor-Cmd <Project> -run=MGFXRegenerateMaterials [-Path=/Game/UI] [-Force] [-DryRun] [-NoSave]
+ *
+ * -Path		Only regenerate assets in this content path, recursively. Defaults to all assets.
+ * -Force		Regenerate materials even if they are up to date.
+ * -DryRun		Only report which materials are out of date.
+ * -NoSave		Don't save the regenerated materials and instances.
+ */
+UCLASS()
+class MGFXEDITOR_API UMGFXRegenerateMaterialsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMGFXRegenerateMaterialsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/** Update the material instance of an MGFX material using a shared material, and add every asset that changed to UpdatedAssets. */
+	static void UpdateMaterialInstance(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, UMaterial* SharedMaterial,
+	                                   TArray<UObject*>& UpdatedAssets);
+
+	/** Repack the layer data texture of an interpreted MGFX material, and add every asset that changed to UpdatedAssets. */
+	static void UpdatePackedLayersTexture(UMGFXMaterial* MGFXMaterial, TArray<UObject*>& UpdatedAssets);
+
+	/** Save the package of a regenerated asset, returning true if successful. */
+	static bool SaveAssetPackage(UObject* Asset);
+};
@@ -0,0 +1,103 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialTypes.h"
+#include "Commandlets/Commandlet.h"
+#include "UObject/StrongObjectPtr.h"
+#include "MGFXVerifyCommandlet.generated.h"
+
+class FMGFXMaterialGenerator;
+class UMGFXMaterial;
+struct FMGFXPackedLayers;
+
+
+/**
+ * Verifies that the generated materials of MGFX material assets render the same as FMGFXMaterialEvaluator,
+ * by rendering each material on the GPU with every backend and comparing the pixels within a tolerance.
+ * Packed layers are also interpreted on the CPU using FMGFXPackedLayersInterpreter and compared the same way,
+ * and the renders of each backend are compared with each other.
+ * Rendering requires a renderer, so use -NoRender when running with -nullrhi.
+ *
+ * Usage: UnrealEditor-Cmd <Project> -run=MGFXVerify [-Path=/Game/UI] [-Backends=Graph,HLSL,Interpreted] [-MaxSize=256]
+ *        [-Tolerance=0.01] [-NoRender] [-Shapes]
+ *
+ * -Path		Only verify assets in this content path, recursively. Defaults to all assets.
+ * -Backends	The generator backends to render.
+ * -MaxSize		The maximum width or height in pixels to render at, scaled down from the base canvas size.
+ * -Tolerance	The maximum difference allowed in any channel of a premultiplied pixel.
+ * -NoRender	Only compare the CPU evaluator and interpreter.
+ * -Shapes		Verify synthetic materials covering every builtin shape with a range of inputs, instead of assets.
+ *				Checks that the shape material functions used by the Graph backend match MGFXShapes.ush.
+ */
+UCLASS()
+class MGFXEDITOR_API UMGFXVerifyCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMGFXVerifyCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/** The result of verifying one material. */
+	enum class EResult : uint8
+	{
+		Passed,
+		Failed,
+		Skipped,
+	};
+
+	/** The difference between two images. */
+	struct FImageDiff
+	{
+		float MaxError = 0.f;
+
+		FIntPoint MaxErrorPixel = FIntPoint::ZeroValue;
+
+		/** The number of pixels that differ by more than the tolerance. */
+		int32 NumMismatched = 0;
+	};
+
+	/** The generator backends to render. */
+	TArray<EMGFXMaterialGeneratorBackend> Backends;
+
+	/** The maximum width or height of rendered images. */
+	int32 MaxSize = 256;
+
+	/** The maximum difference allowed in any channel of a premultiplied pixel. */
+	float Tolerance = 0.01f;
+
+	/** Render the generated materials, instead of only comparing on the CPU. */
+	bool bRender = true;
+
+	/** Compare the evaluator, interpreter, and the render of every backend for one material. */
+	EResult VerifyMaterial(FMGFXMaterialGenerator& Generator, const UMGFXMaterial* MGFXMaterial) const;
+
+	/** Create a material for each builtin shape with a range of inputs, with a fill and a wide stroke. */
+	static TArray<TStrongObjectPtr<UMGFXMaterial>> CreateShapeMaterials();
+
+	/** Return the size of the images to compare, fitting the base canvas size within MaxSize. */
+	FIntPoint GetImageSize(const UMGFXMaterial* MGFXMaterial) const;
+
+	/** Duplicate an MGFX material with the settings needed to render it to a render target, and without animations. */
+	static UMGFXMaterial* CreateRenderableMaterial(const UMGFXMaterial* MGFXMaterial, EMGFXMaterialGeneratorBackend Backend,
+	                                               const FMGFXPackedLayers& PackedLayers);
+
+	/** Return the canvas space center of every pixel, and the pixel size to evaluate them with on the CPU. */
+	static void GetPixelCenters(const FVector2f& CanvasSize, FIntPoint Size, TArray<FVector2f>& OutPoints, float& OutPixelSize);
+
+	/** Convert unpremultiplied colors evaluated on the CPU to premultiplied colors. */
+	static void Premultiply(TArrayView<FLinearColor> Colors);
+
+	/** Generate a material and render it on the GPU, returning premultiplied colors. Returns false if it couldn't be rendered. */
+	static bool RenderPixels(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, FIntPoint Size, TArray<FLinearColor>& OutColors);
+
+	/** Compare two images of premultiplied colors. */
+	FImageDiff Compare(TConstArrayView<FLinearColor> ColorsA, TConstArrayView<FLinearColor> ColorsB, FIntPoint Size) const;
+
+	/** Log the result of a comparison, returning true if the images match. */
+	bool LogDiff(const FString& Name, const FString& Description, const FImageDiff& Diff, FIntPoint Size) const;
+};
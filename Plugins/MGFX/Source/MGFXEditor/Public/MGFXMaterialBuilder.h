@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "SceneTypes.h"
+#include "UObject/GCObject.h"
+#include "Materials/MaterialExpressionCustom.h"
 #include "UObject/SoftObjectPtr.h"
 
 class UMaterialFunctionInterface;
@@ -19,6 +21,36 @@ class UMaterialExpressionParameter;
 class UMaterialExpressionScalarParameter;
 
 
+/**
+ * Expressions that were deleted from materials, kept alive so they can be recycled instead of creating new objects.
+ * This avoids allocating and garbage collecting every expression each time a material is regenerated.
+ */
+struct MGFXEDITOR_API FMGFXMaterialExpressionPool : public FGCObject
+{
+	/** Remove and return a pooled expression of an exact class for a material, or null if there are none. */
+	UMaterialExpression* Take(const UMaterial* Material, const UClass* ExpressionClass);
+
+	/** Add an expression that was deleted from a material to the pool. */
+	void Release(const UMaterial* Material, UMaterialExpression* Expression);
+
+	/** Remove any pooled expressions that are in use by a material again, e.g. after an undo. */
+	void RemoveUsedExpressions(const UMaterial* Material);
+
+	/** Return the number of pooled expressions for a material. */
+	int32 Num(const UMaterial* Material) const;
+
+	/** Forget all pooled expressions, allowing them to be garbage collected. */
+	void Reset();
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FMGFXMaterialExpressionPool"); }
+
+protected:
+	/** Pooled expressions by material, then by class. */
+	TMap<TWeakObjectPtr<const UMaterial>, TMap<const UClass*, TArray<TObjectPtr<UMaterialExpression>>>> Expressions;
+};
+
+
 /**
  * Utility class for building materials programmatically.
  */
@@ -35,18 +67,18 @@ struct MGFXEDITOR_API FMGFXMaterialBuilder
 	/**
 	 * Set the material that will be modified.
 	 * If bInBlockPostEditChange is true, temporarily make the material a preview material, so that
-	 * If bInBlockPostEditChange is true, temporarily make the material a preview material, so that
 	 * material expression updates don't trigger PostEditChange on the material itself.
 	 */
 	void SetMaterial(UMaterial* InMaterial, bool bInBlockPostEditChange);
 
 	/**
 	 * Reset the builder, clearing the material reference and restoring its preview state.
-	 * Should be called when finished building.
+	 * Should be called when finished building. If bNotifyMaterial is false, the material isn't notified with PostEditChange,
+	 * e.g. to time compiling it separately, and must be notified by the caller.
 	 */
-	void Reset();
+	void Reset(bool bNotifyMaterial = true);
 
-	/** Create a new material expression. */
+	/** Create a new material expression, recycling a previously deleted expression of the same class if possible. */
 	UMaterialExpression* Create(TSubclassOf<UMaterialExpression> ExpressionClass, const FVector2D& NodePos) const;
 
 	/** Templated create a new material expression. */
@@ -78,6 +110,11 @@ struct MGFXEDITOR_API FMGFXMaterialBuilder
 	/** Create and connect an append expression. */
 	UMaterialExpressionAppendVector* CreateAppend(const FVector2D& NodePos, UMaterialExpression* A, UMaterialExpression* B) const;
 
+	/** Create a custom HLSL expression with named inputs. */
+	UMaterialExpressionCustom* CreateCustom(const FVector2D& NodePos, const FString& Code, ECustomMaterialOutputType OutputType,
+	                                        const TArray<FName>& InputNames, const FString& Description = FString(),
+	                                        const TArray<FString>& IncludeFilePaths = TArray<FString>()) const;
+
 	/** Create and configure a scalar parameter expression. */
 	UMaterialExpressionScalarParameter* CreateScalarParam(const FVector2D& NodePos, FName ParameterName, FName Group, int32 SortPriority = 32) const;
 
@@ -92,9 +129,10 @@ struct MGFXEDITOR_API FMGFXMaterialBuilder
 	/** Find and create a usage of an existing named reroute. */
 	UMaterialExpressionNamedRerouteUsage* CreateNamedRerouteUsage(const FVector2D& NodePos, const FName Name) const;
 
-	/** Find a named reroute. */
+	/** Find a named reroute. Reroutes are indexed by name, so this doesn't search the material. */
 	UMaterialExpressionNamedRerouteDeclaration* FindNamedReroute(const FName Name) const;
 
+	/** Find a parameter by name. Parameters are indexed by name, so this doesn't search the material. */
 	UMaterialExpressionParameter* FindNamedParameter(const FName ParameterName) const;
 
 	template <class T>
@@ -125,9 +163,40 @@ struct MGFXEDITOR_API FMGFXMaterialBuilder
 
 	void RecompileMaterial();
 
-	/** Delete all expressions in the material. */
+	/** Delete all expressions in the material. Deleted expressions are pooled, to be recycled when creating new ones. */
 	void DeleteAll();
 
+	/** Delete all expressions in the material except those in KeepExpressions. Comments are always deleted. */
+	void DeleteAllExcept(const TSet<UMaterialExpression*>& KeepExpressions);
+
+	/** Forget all pooled expressions of every material, so they can be garbage collected. */
+	void ClearExpressionPool();
+
+	/**
+	 * Merge all structurally identical expressions, redirecting their outputs to a single remaining expression.
+	 * Expressions are identical if they have the same class, property values, and (merged) inputs.
+	 * Returns the number of expressions that were deleted, and optionally the remaining expression for each of them.
+	 */
+	int32 EliminateCommonSubexpressions(TMap<UMaterialExpression*, UMaterialExpression*>* OutMergedExpressions = nullptr);
+
+	/** Return true if an expression may be merged with identical expressions. */
+	static bool CanEliminateExpression(const UMaterialExpression* Expression);
+
+	/** Return a key that is equal for all structurally identical expressions, expecting all inputs to already be merged. */
+	static FString GetExpressionKey(const UMaterialExpression* Expression);
+
+	/** Move an expression by an offset. */
+	void MoveExpression(UMaterialExpression* Expression, const FVector2D& Offset) const;
+
+	/** Rebuild the index of named reroutes and parameters from all expressions in the material. */
+	void RebuildNameIndex();
+
+	/** Start adding all newly created expressions to OutExpressions, until EndRecording is called. */
+	void BeginRecording(TArray<TWeakObjectPtr<UMaterialExpression>>& OutExpressions);
+
+	/** Stop recording newly created expressions. */
+	void EndRecording();
+
 protected:
 	/** When true, prevent the material from being recompiled in post edit change property calls. */
 	bool bBlockPostEditChange = false;
@@ -137,4 +206,19 @@ protected:
 
 	/** The original value of bIsPreviewMaterial for the material before it was modified. */
 	bool bWasPreviewMaterial = false;
+
+	/** Reset a pooled expression to its class defaults and add it to the material. */
+	UMaterialExpression* RecycleExpression(UMaterialExpression* Expression, const FVector2D& NodePos) const;
+
+	/** Deleted expressions that can be recycled, across all materials built with this builder. */
+	mutable FMGFXMaterialExpressionPool ExpressionPool;
+
+	/** When set, all newly created expressions are added to this array. */
+	TArray<TWeakObjectPtr<UMaterialExpression>>* RecordedExpressions = nullptr;
+
+	/** Named reroute declarations in the material, by name. Updated when reroutes are created or deleted. */
+	mutable TMap<FName, TWeakObjectPtr<UMaterialExpressionNamedRerouteDeclaration>> NamedReroutes;
+
+	/** Parameters in the material, by name. Updated when parameters are configured or deleted. */
+	mutable TMap<FName, TWeakObjectPtr<UMaterialExpressionParameter>> NamedParameters;
 };
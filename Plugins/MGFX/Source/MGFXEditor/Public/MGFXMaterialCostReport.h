@@ -0,0 +1,105 @@
+﻿// Copyright Bohdon Sayre, All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MGFXMaterialCostReport.generated.h"
+
+class UMaterialExpression;
+
+
+/**
+ * Expression and instruction counts for part of a generated material.
+ */
+USTRUCT(BlueprintType)
+struct MGFXEDITOR_API FMGFXMaterialCost
+{
+	GENERATED_BODY()
+
+	/** The number of material expressions. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumExpressions = 0;
+
+	/** The number of parameter expressions. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumParameters = 0;
+
+	/** The number of material function calls, or HLSL function calls when using the HLSL backend. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumFunctionCalls = 0;
+
+	/** The number of operations, counting the contents of material functions. Used to attribute instructions. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumOperations = 0;
+
+	/** The number of pixel shader instructions. This is an estimate for layers, since shaders are compiled for the whole material. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumInstructions = 0;
+
+	/** Add the cost of an expression. */
+	void AddExpression(const UMaterialExpression* Expression);
+
+	/** Return the number of operations an expression performs, where parameters, constants, and swizzles are free. */
+	static int32 GetExpressionOperations(const UMaterialExpression* Expression);
+
+	/** Return the number of MGFX function calls in generated HLSL code. */
+	static int32 CountHLSLFunctionCalls(const FString& Code);
+};
+
+
+/**
+ * The cost of a single layer in a generated material, excluding its children.
+ */
+USTRUCT(BlueprintType)
+struct MGFXEDITOR_API FMGFXMaterialLayerCost : public FMGFXMaterialCost
+{
+	GENERATED_BODY()
+
+	/** The name of the layer. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	FString LayerName;
+
+	/** The depth of the layer in the hierarchy, 0 for root layers. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 Depth = 0;
+};
+
+
+/**
+ * A report of the compiled shader cost of a generated material, and an estimated attribution of that cost to each layer.
+ */
+USTRUCT(BlueprintType)
+struct MGFXEDITOR_API FMGFXMaterialCostReport
+{
+	GENERATED_BODY()
+
+	/** The path of the generated material. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	FString MaterialName;
+
+	/** The generator backend used for the material. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	FString Backend;
+
+	/** The total cost of the material, where NumInstructions is the compiled pixel shader instruction count. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	FMGFXMaterialCost Total;
+
+	/** The compiled vertex shader instruction count. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumVertexShaderInstructions = 0;
+
+	/** The number of texture samplers used. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	int32 NumSamplers = 0;
+
+	/** The cost of each layer, in hierarchy order from top to bottom. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Cost")
+	TArray<FMGFXMaterialLayerCost> Layers;
+
+	/** Return true if the report contains any results. */
+	bool IsValid() const { return !MaterialName.IsEmpty(); }
+
+	/** Return the report as a JSON string. */
+	FString ToJson() const;
+};
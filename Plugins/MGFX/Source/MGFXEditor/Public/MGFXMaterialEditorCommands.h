@@ -27,6 +27,12 @@ public:
 	/** Apply changes and regenerate the target material. */
 	TSharedPtr<FUICommandInfo> Apply;
 
+	/** Compile the target material and report the cost of each layer. */
+	TSharedPtr<FUICommandInfo> CostReport;
+
+	/** Rasterize the material into texture assets on the CPU. */
+	TSharedPtr<FUICommandInfo> Bake;
+
 	/** Set the canvas view scale to 50% */
 	TSharedPtr<FUICommandInfo> ZoomTo50;
 
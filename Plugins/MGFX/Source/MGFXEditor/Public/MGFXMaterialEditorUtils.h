@@ -5,9 +5,13 @@
 #include "CoreMinimal.h"
 #include "Factories.h"
 
+class FMGFXMaterialGenerator;
 class IMGFXMaterialLayerParentInterface;
+class UMaterial;
+class UMaterialInstanceConstant;
 class UMGFXMaterial;
 class UMGFXMaterialLayer;
+class UTexture2D;
 
 
 /**
@@ -51,6 +55,21 @@ public:
 	/** Return only the topmost layers, i.e. remove any layers that are children of other layers in the list. */
 	static TArray<UMGFXMaterialLayer*> GetTopmostLayers(const TArray<UMGFXMaterialLayer*>& Layers);
 
+	/**
+	 * Set every parameter value of an MGFX material on its material instance of a shared material,
+	 * creating the instance asset next to the MGFX material if it doesn't exist. Returns null if it couldn't be created.
+	 */
+	static UMaterialInstanceConstant* UpdateMaterialInstance(FMGFXMaterialGenerator& Generator, UMGFXMaterial* MGFXMaterial, UMaterial* SharedMaterial);
+
+	/** Create a new texture asset next to an MGFX material, named after it with a suffix. */
+	static UTexture2D* CreateTextureAsset(UMGFXMaterial* MGFXMaterial, const FString& Suffix);
+
+	/**
+	 * Pack the layers of an MGFX material into the packed layers texture asset used by the interpreted material,
+	 * creating it if needed. Returns null if it couldn't be created.
+	 */
+	static UTexture2D* UpdatePackedLayersTexture(UMGFXMaterial* MGFXMaterial);
+
 private:
 	/** Return a unique subobject name. */
 	static FName GetUniqueName(UObject* Outer, const FName& Name);
@@ -4,15 +4,19 @@
 
 #include "CoreMinimal.h"
 #include "MGFXMaterialBuilder.h"
+#include "MGFXMaterialCostReport.h"
 #include "MGFXMaterialTypes.h"
+#include "Shapes/MGFXMaterialShape.h"
+#include "UObject/ObjectKey.h"
 
 class UMGFXMaterial;
 class UMGFXMaterialLayer;
-class UMGFXMaterialShape;
 class UMGFXMaterialShapeFill;
 class UMGFXMaterialShapeStroke;
+class UMGFXMaterialShapeVisual;
 class UMaterialExpression;
 class UMaterialExpressionNamedRerouteDeclaration;
+class UMaterialExpressionVectorParameter;
 
 
 /**
@@ -25,6 +29,12 @@ struct MGFXEDITOR_API FMGFXMaterialUVsAndFilterWidth
 
 	/** The calculated filter width for the UVs. */
 	UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp = nullptr;
+
+	/** The uvs of the nearest layer with an animatable transform, or the canvas uvs. Static transforms are baked relative to these. */
+	UMaterialExpressionNamedRerouteDeclaration* BaseUVsExp = nullptr;
+
+	/** The accumulated static transform of all layers between BaseUVsExp and these uvs. */
+	FTransform2D BaseTransform;
 };
 
 
@@ -44,6 +54,139 @@ struct MGFXEDITOR_API FMGFXMaterialLayerOutputs
 };
 
 
+/**
+ * Tracks HLSL variables for a single layer when generating with the HLSL backend.
+ */
+struct MGFXEDITOR_API FMGFXMaterialHLSLLayerOutputs
+{
+	/** The uvs variable. */
+	FString UVs;
+
+	/** The calculated filter width variable for the UVs. */
+	FString FilterWidth;
+
+	/** The uvs of the nearest layer with an animatable transform, or the canvas uvs. Static transforms are baked relative to these. */
+	FString BaseUVs;
+
+	/** The accumulated static transform of all layers between BaseUVs and these uvs. */
+	FTransform2D BaseTransform;
+
+	/** The shape sdf variable for the layer. */
+	FString Shape;
+
+	/** The merged result of all visuals for the layer, as premultiplied RGBA. */
+	FString Visual;
+};
+
+
+/**
+ * The location of a scalar parameter that was packed into a channel of a vector parameter.
+ */
+struct MGFXEDITOR_API FMGFXPackedParameterSlot
+{
+	/** The name of the vector parameter. */
+	FName ParameterName;
+
+	/** The channel of the vector parameter, from 0 to 3 for RGBA. */
+	int32 Channel = 0;
+};
+
+
+/**
+ * The material parameters of an editable property, resolved when generating so that
+ * interactive edits can update them without building any parameter names.
+ */
+struct MGFXEDITOR_API FMGFXPropertyParameters
+{
+	/** How the value is split into parameters. Float and Vector2 use scalar parameters, Vector3 and Vector4 use a vector parameter. */
+	EMGFXMaterialShapeInputType Type = EMGFXMaterialShapeInputType::Float;
+
+	/** The parameter names. The second name is only used for the Y component of Vector2 values. */
+	FName ParameterNames[2];
+
+	/** The property that holds the value, if it can be read directly from the edited object. */
+	const FProperty* ValueProperty = nullptr;
+
+	/** Read the value of ValueProperty from an object. Returns false if there is no value property. */
+	bool GetValue(const UObject* Object, FLinearColor& OutValue) const;
+
+	/** Return true if a property can be used as a value property. */
+	static bool IsValidValueProperty(const FProperty* Property);
+};
+
+
+/**
+ * A group of expressions that were generated together, and can be relocated and reused as long as their source data is unchanged.
+ */
+struct MGFXEDITOR_API FMGFXGeneratedExpressionGroup
+{
+	/** The node position when the group started generating. */
+	FVector2D StartPos = FVector2D::ZeroVector;
+
+	/** The node position when the group finished generating. */
+	FVector2D EndPos = FVector2D::ZeroVector;
+
+	/** All expressions in the group. */
+	TArray<TWeakObjectPtr<UMaterialExpression>> Expressions;
+
+	/** The scalar parameters that were packed into vector parameters in the group, by scalar parameter name. */
+	TMap<FName, FMGFXPackedParameterSlot> PackedParameters;
+
+	/** Return true if all expressions are still valid and exist in a material. */
+	bool IsValid(const TSet<UMaterialExpression*>& MaterialExpressions) const;
+};
+
+
+/**
+ * The expressions that were generated for a single layer, excluding its children and any merges with other layers.
+ */
+struct MGFXEDITOR_API FMGFXGeneratedLayer
+{
+	/** Hash of all layer data that affected the generated expressions. */
+	uint32 Hash = 0;
+
+	/** The transform and filter width expressions, which are generated before any children. */
+	FMGFXGeneratedExpressionGroup TransformGroup;
+
+	/** The shape and visual expressions, which are generated after all children. */
+	FMGFXGeneratedExpressionGroup ShapeGroup;
+
+	/** The expressions merging this layer with its children and siblings. These are never reused. */
+	FMGFXGeneratedExpressionGroup MergeGroup;
+
+	/** The number of HLSL function calls generated for the layer, when using the HLSL backend. */
+	int32 NumHLSLFunctionCalls = 0;
+
+	/** The outputs of the layer before merging with its children or siblings. */
+	FMGFXMaterialLayerOutputs Outputs;
+};
+
+
+/**
+ * Tracks the expressions last generated for a material, so that unchanged layers can be reused during the next generate.
+ */
+struct MGFXEDITOR_API FMGFXGeneratedMaterial
+{
+	/** Hash of the generator settings that affect every layer. */
+	uint32 SettingsHash = 0;
+
+	/** Hash of the canvas settings used to generate the boilerplate. */
+	uint32 BoilerplateHash = 0;
+
+	/** The canvas UVs and filter width expressions. */
+	FMGFXGeneratedExpressionGroup BoilerplateGroup;
+
+	/** The generated expressions for each layer. */
+	TMap<TWeakObjectPtr<const UMGFXMaterialLayer>, FMGFXGeneratedLayer> Layers;
+
+	/** All scalar parameters that were packed into vector parameters, by scalar parameter name. */
+	TMap<FName, FMGFXPackedParameterSlot> PackedParameters;
+
+	/** The parameters of every editable layer, shape, and visual property, by object and property name. */
+	TMap<TPair<FObjectKey, FName>, FMGFXPropertyParameters> PropertyParameters;
+};
+
+
 /**
  * Handles generating a UMaterial from a UMGFXMaterial
  */
@@ -60,9 +203,112 @@ public:
 
 	FLinearColor CommentColor = FLinearColor(0.06f, 0.02f, 0.02f);
 
-	/** Generate the material. If bIsPreviewMaterial is true, no parameters will be optimized out to allow full interactive editing. */
+	/**
+	 * Notify generated materials with PostEditChange when finished, which starts compiling them.
+	 * Disabled to time generating separately from compiling, in which case the caller must notify each material.
+	 */
+	bool bNotifyMaterialWhenFinished = true;
+
+	/** The time in milliseconds the last generate spent creating and connecting expressions, before merging identical ones. */
+	double LastCreateExpressionsMs = 0.0;
+
+	/**
+	 * Generate the material. If bIsPreviewMaterial is true, no parameters of live preview layers will be optimized out to allow full interactive editing.
+	 * Expressions for layers that haven't changed since the last generate of the same material are reused.
+	 * Identical expressions are merged when not generating a preview material.
+	 */
 	void Generate(UMGFXMaterial* InMGFXMaterial, UMaterial* OutputMaterial, bool bRecompile = true, bool bInIsPreviewMaterial = false);
 
+	/** Forget all previously generated expressions, so that the next generate rebuilds every expression. */
+	void ClearGeneratedCache();
+
+	/**
+	 * Only generate these layers with live parameters in preview materials, all other layers are optimized the same as in the target material.
+	 * This keeps the preview close to the cost of the target material, but other layers must be regenerated to be edited interactively.
+	 */
+	void SetLivePreviewLayers(const TArray<const UMGFXMaterialLayer*>& Layers);
+
+	/** Generate every layer of preview materials with live parameters. This is the default. */
+	void ClearLivePreviewLayers();
+
+	/** Return true if a layer is generated with live parameters in preview materials. */
+	bool IsLivePreviewLayer(const UMGFXMaterialLayer* Layer) const;
+
+	/** Return the content hash of a preview material, which includes the live preview layers. */
+	uint32 GetPreviewContentHash(const UMGFXMaterial* InMGFXMaterial) const;
+
+	/** Return true if a preview material was generated from the current content and live preview layers. */
+	bool IsPreviewMaterialUpToDate(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material) const;
+
+	/**
+	 * Return the default values of every parameter generated for an MGFX material, by generating it into a transient material.
+	 * Used to set the values of a material instance of a shared material with the same structure.
+	 */
+	void GetParameterValues(UMGFXMaterial* InMGFXMaterial, TMap<FName, float>& OutScalarValues, TMap<FName, FLinearColor>& OutVectorValues);
+
+	/** Return true if a material was generated by this generator, and its generated expressions are known. */
+	bool IsGeneratedMaterial(UMaterial* Material) const { return GeneratedMaterials.Contains(Material); }
+
+	/** Return the vector parameter and channel a scalar parameter was packed into, or null if it wasn't packed. */
+	const FMGFXPackedParameterSlot* FindPackedParameter(UMaterial* Material, FName ParameterName) const;
+
+	/**
+	 * Return the parameters last generated in a material for a property of a layer, shape, or visual, or null if there are none.
+	 * Layer transform properties are found by the name of the property within the transform, e.g. Location.
+	 */
+	const FMGFXPropertyParameters* FindPropertyParameters(UMaterial* Material, const UObject* Object, FName PropertyName) const;
+
+	/**
+	 * Return a hash of all properties of a layer that affect its generated expressions, excluding children.
+	 * If bIncludeValues is false, values that are always parameters of shared materials are excluded.
+	 */
+	static uint32 GetLayerHash(const UMGFXMaterialLayer* Layer, bool bIncludeValues = true);
+
+	/**
+	 * Return a hash of all content of an MGFX material and the generator settings that affect its generated material.
+	 * This is stored on each generated material, and is stable between editor sessions.
+	 * For shared materials this is a hash of the structure only, which is the same for all materials that can share it.
+	 * For interpreted materials this includes the packed layers, so that their layer data texture is updated with them.
+	 * The generator version is stored separately, so that the names of shared materials don't change with it.
+	 */
+	static uint32 GetContentHash(const UMGFXMaterial* InMGFXMaterial, bool bInIsPreviewMaterial);
+
+	/** Return the asset name of the shared material for the structure of an MGFX material. */
+	static FString GetSharedMaterialName(const UMGFXMaterial* InMGFXMaterial);
+
+	/** Return the content hash a material was last generated from, or 0 if it wasn't generated. */
+	static uint32 GetStoredContentHash(UMaterial* Material);
+
+	/** Return true if a material was generated as a shared material, which is used by other MGFX materials. */
+	static bool IsSharedMaterial(UMaterial* Material);
+
+	/**
+	 * Return true if a material can be used as the shared material for the structure of an MGFX material.
+	 * Shared materials are found by a hash in their name, so this checks that the structure they were generated from matches.
+	 */
+	static bool CanReuseSharedMaterial(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material);
+
+	/** Return true if a material was generated by the current GeneratorVersion. */
+	static bool IsGeneratorVersionCurrent(UMaterial* Material);
+
+	/**
+	 * Return true if a material was generated from the current content of an MGFX material, ignoring the generator version.
+	 * Shared materials with the same content are regenerated in place when only the version changed.
+	 */
+	static bool HasSameContent(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material, bool bInIsPreviewMaterial);
+
+	/** Return true if a material was generated from the current content of an MGFX material, and doesn't need to be regenerated. */
+	static bool IsMaterialUpToDate(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material, bool bInIsPreviewMaterial);
+
+	/** Incremented whenever the generated materials change for the same content, so that existing materials are regenerated. */
+	static constexpr uint32 GeneratorVersion = 1;
+
+	/**
+	 * Create a report of the compiled cost of a material last generated by this generator, with an estimated cost for each layer.
+	 * Waits for the material's shaders to finish compiling.
+	 */
+	FMGFXMaterialCostReport CreateCostReport(const UMGFXMaterial* InMGFXMaterial, UMaterial* Material) const;
+
 	/** Add a generated warning comment to prevent user modification. */
 	void AddWarningComment();
 
@@ -76,9 +322,20 @@ public:
 	FMGFXMaterialLayerOutputs GenerateLayer(const UMGFXMaterialLayer* Layer,
 	                                        const FMGFXMaterialUVsAndFilterWidth& UVs, const FMGFXMaterialLayerOutputs& PrevOutputs);
 
-	/** Generate material nodes to apply a 2D transform. */
+	/**
+	 * Generate material nodes to apply an animatable 2D transform, using parameters for location, rotation, and scale.
+	 * Identity components are skipped, unless the transform is animatable or bIsLive is true.
+	 * Components keyframed by the animations of Layer are evaluated from their keys instead.
+	 */
 	UMaterialExpression* GenerateTransformUVs(const FMGFXShapeTransform2D& Transform, UMaterialExpression* InUVsExp,
-	                                          const FString& ParamPrefix, const FName& ParamGroup);
+	                                          const FString& ParamPrefix, const FName& ParamGroup, bool bIsLive = false,
+	                                          const UMGFXMaterialLayer* Layer = nullptr);
+
+	/**
+	 * Generate material nodes to apply the inverse of a static transform as a single 2x3 affine transform.
+	 * May return InUVsExp if the transform is identity.
+	 */
+	UMaterialExpression* GenerateStaticTransformUVs(const FTransform2D& Transform, UMaterialExpression* InUVsExp);
 
 	/** Generate material nodes to create a shape. */
 	UMaterialExpression* GenerateShape(const UMGFXMaterialShape* Shape,
@@ -86,6 +343,7 @@ public:
 
 	/**
 	 * Generate material nodes to create the visuals for a shape.
+	 * All visuals are evaluated from the same shape SDF, and merged over each other in order.
 	 * Returns an unpremultiplied 4-channel RGBA expression.
 	 */
 	UMaterialExpression* GenerateShapeVisuals(const UMGFXMaterialShape* Shape,
@@ -96,15 +354,22 @@ public:
 	UMaterialExpression* GenerateMergeVisual(UMaterialExpression* AExp, UMaterialExpression* BExp, EMGFXLayerMergeOperation Operation,
 	                                         const FString& ParamPrefix, const FName& ParamGroup);
 
-	/** Merge two shape (SDF) layers. */
+	/** Merge two shape (SDF) layers, where A is the shape below B. Returns BExp if the shapes aren't merged. */
 	UMaterialExpression* GenerateMergeShapes(UMaterialExpression* AExp, UMaterialExpression* BExp, EMGFXShapeMergeOperation Operation,
-	                                         const FString& ParamPrefix, const FName& ParamGroup);
+	                                         float Smoothness, const FString& ParamPrefix, const FName& ParamGroup);
 
 
-	/** Generate material nodes for a vector 2 parameter using two scalars. */
+	/** Generate material nodes for a vector 2 parameter using two scalars, which may be packed. */
 	UMaterialExpression* GenerateVector2Parameter(FVector2f DefaultValue, const FString& ParamPrefix, const FName& ParamGroup,
 	                                              int32 BaseSortPriority, const FString& ParamNameX, const FString& ParamNameY);
 
+	/**
+	 * Pack scalar parameters into adjacent channels of a vector parameter, and return an expression that unpacks them.
+	 * The vector parameter is shared with previously packed parameters until all channels are used.
+	 */
+	UMaterialExpression* GeneratePackedParameter(const FVector2D& NodePos, TConstArrayView<float> Values, TConstArrayView<FString> ParamNames,
+	                                             const FName& ParamGroup, int32 SortPriority);
+
 	/**
 	 * Generate material nodes for a shape fill.
 	 * Returns an unpremultiplied 4-channel RGBA expression.
@@ -121,15 +386,278 @@ public:
 	                                         UMaterialExpression* ShapeExp, UMaterialExpressionNamedRerouteDeclaration* FilterWidthExp,
 	                                         const FString& ParamPrefix, const FName& ParamGroup);
 
+	/**
+	 * Generate material nodes to tint the coverage of a visual by its color, using a parameter or the color animation if set.
+	 * Returns an unpremultiplied 4-channel RGBA expression.
+	 */
+	UMaterialExpression* GenerateTint(UMaterialExpression* CoverageExp, const FLinearColor& Color, const FMGFXPropertyAnimation* ColorAnimation,
+	                                  const FString& ParamPrefix, const FName& ParamGroup);
+
+	/**
+	 * Generate a custom expression that evaluates the keys of an animation at the animation time.
+	 * Rotations are keyed in degrees, and output as the packed rotation used by transforms.
+	 */
+	UMaterialExpression* GenerateAnimation(const FMGFXPropertyAnimation& Animation, EMGFXMaterialShapeInputType Type,
+	                                       const FVector2D& NodePos, bool bIsRotation = false);
+
+	/** Generate the time expression of animations, using the material time or the AnimationTime parameter. */
+	UMaterialExpression* GenerateAnimationTime(const FVector2D& NodePos);
+
+	/** Return the animation of a property of a layer, shape, or visual, or null if it isn't animated. */
+	static const FMGFXPropertyAnimation* FindAnimation(const UObject* Object, FName PropertyName);
+
+	/** Return HLSL for the time within an animation, wrapping looping animations between their first and last keys. */
+	static FString GetAnimationTimeHLSL(const FMGFXPropertyAnimation& Animation, const FString& Time);
+
+	/** Return HLSL that evaluates the keys of an animation as a piecewise curve, with the keys baked as constants. */
+	static FString GetAnimationValueHLSL(const FMGFXPropertyAnimation& Animation, const FString& Time, EMGFXMaterialShapeInputType Type);
+
+	/** Generate all layers as straight-line HLSL in a single custom expression, with parameters connected as inputs. */
+	void GenerateLayersHLSL();
+
+	/** Generate a custom expression that interprets the packed layers from a texture parameter. Doesn't depend on any layers. */
+	void GenerateLayersInterpreted();
+
+	/** Generate HLSL for a layer and all it's children recursively. */
+	FMGFXMaterialHLSLLayerOutputs GenerateLayerHLSL(const UMGFXMaterialLayer* Layer,
+	                                                const FMGFXMaterialHLSLLayerOutputs& UVs, const FMGFXMaterialHLSLLayerOutputs& PrevOutputs);
+
+	/**
+	 * Return HLSL that applies an animatable 2D transform, using parameters for location, rotation, and scale.
+	 * Components keyframed by the animations of Layer are evaluated from their keys instead.
+	 */
+	FString GenerateTransformUVsHLSL(const FMGFXShapeTransform2D& Transform, const FString& InUVs,
+	                                 const FString& ParamPrefix, const FName& ParamGroup, const UMGFXMaterialLayer* Layer = nullptr);
+
+	/** Return HLSL that applies the inverse of a static transform. May return InUVs if the transform is identity. */
+	FString GenerateStaticTransformUVsHLSL(const FTransform2D& Transform, const FString& InUVs) const;
+
+	/** Generate HLSL to evaluate a shape, returning the SDF variable, or empty if the shape has no HLSL function. */
+	FString GenerateShapeHLSL(const UMGFXMaterialShape* Shape, const FString& InUVs, const FString& ParamPrefix, const FName& ParamGroup);
+
+	/**
+	 * Generate HLSL for the visuals of a shape, returning a premultiplied RGBA variable.
+	 * All visuals are evaluated from the same shape SDF, and merged over each other in order.
+	 * OutCoverageMargin is set to how far outside the shape the visuals extend, excluding filtering, or empty if they don't.
+	 */
+	FString GenerateShapeVisualsHLSL(const UMGFXMaterialShape* Shape, const FString& ShapeSDF, const FString& FilterWidth,
+	                                 const FString& ParamPrefix, const FName& ParamGroup, FString* OutCoverageMargin = nullptr);
+
+	/**
+	 * Return true if the next sibling above a layer merges its shape with the layer's shape.
+	 * The visuals of merged shapes are only generated for the topmost shape, using the merged SDF.
+	 */
+	static bool IsShapeMergedWithNext(const UMGFXMaterialLayer* Layer);
+
+	/** Return true if a layer's shape and visuals can be skipped outside of its bounds using a dynamic branch. */
+	bool CanBranchOnBounds(const UMGFXMaterialLayer* Layer) const;
+
+	/**
+	 * Wrap all HLSL generated since CodeStartIdx in a dynamic branch that only runs inside the layer's bounds.
+	 * Updates the shape and visual outputs to variables declared outside the branch.
+	 */
+	void GenerateBoundsBranchHLSL(const UMGFXMaterialLayer* Layer, int32 CodeStartIdx, const FString& CoverageMargin,
+	                              FMGFXMaterialHLSLLayerOutputs& LayerOutputs);
+
+	/** Generate HLSL to merge two visual (RGBA) layers. */
+	FString GenerateMergeVisualHLSL(const FString& A, const FString& B, EMGFXLayerMergeOperation Operation);
+
+	/** Generate HLSL to merge two shape (SDF) layers, where A is the shape below B. Returns B if the shapes aren't merged. */
+	FString GenerateMergeShapesHLSL(const FString& A, const FString& B, EMGFXShapeMergeOperation Operation, float Smoothness);
+
+	/** Generate a scalar parameter used as an input to the generated HLSL. */
+	FString GenerateScalarParameterHLSL(float Value, const FString& ParamName, const FName& ParamGroup, int32 SortPriority);
+
+	/** Generate a vector parameter used as an input to the generated HLSL. */
+	FString GenerateVectorParameterHLSL(const FLinearColor& Value, const FString& ParamName, const FName& ParamGroup, int32 SortPriority);
+
+	/** Generate a vector 2 parameter using two scalars, returning a float2 of both inputs. */
+	FString GenerateVector2ParameterHLSL(FVector2f Value, const FString& ParamPrefix, const FName& ParamGroup,
+	                                     int32 BaseSortPriority, const FString& ParamNameX, const FString& ParamNameY);
+
+	/** Pack scalar parameters into adjacent channels of a vector parameter, returning the swizzled input to the generated HLSL. */
+	FString GeneratePackedParameterHLSL(TConstArrayView<float> Values, TConstArrayView<FString> ParamNames, const FName& ParamGroup, int32 SortPriority);
+
+	/** Return the name of the material function and HLSL function for a merge operation, or empty if not supported. */
+	static FString GetMergeOperationName(EMGFXLayerMergeOperation Operation);
+
+	/** Return the name of the HLSL function for a shape merge operation, or empty if the shapes aren't merged. */
+	static FString GetShapeMergeOperationName(EMGFXShapeMergeOperation Operation);
+
+	/** Return the name of a layer used for its parameters and parameter group, which is its object name if it has no display name. */
+	static FString GetLayerParamName(const UMGFXMaterialLayer* Layer);
+
+	/** Return the prefix of all parameters of a layer, e.g. "Layer." */
+	static FString GetLayerParamPrefix(const UMGFXMaterialLayer* Layer);
+
+	/**
+	 * Return the parameter prefix for a shape visual, given the prefix of its layer.
+	 * The first visual uses the layer prefix, additional visuals are prefixed with their index, e.g. "Layer.Visual1."
+	 */
+	static FString GetVisualParamPrefix(const FString& LayerParamPrefix, const UMGFXMaterialShapeVisual* Visual);
+
 	FMGFXMaterialBuilder& GetBuilder() { return Builder; }
 
 protected:
+	/** Return a hash of the generator settings that affect every layer. */
+	static uint32 GetSettingsHash(const UMGFXMaterial* InMGFXMaterial, bool bInIsPreviewMaterial);
+
+	/** Return a hash of the canvas settings that affect the boilerplate. */
+	static uint32 GetBoilerplateHash(const UMGFXMaterial* InMGFXMaterial, bool bIncludeValues = true);
+
+	/** Return a hash of layers and all their children recursively, including their order. */
+	static uint32 GetLayersContentHash(const TArray<TObjectPtr<UMGFXMaterialLayer>>& Layers, bool bIncludeValues = true);
+
+	/** Store the content hash a material was generated from on the material. */
+	static void SetStoredContentHash(UMaterial* Material, uint32 ContentHash);
+
+	/** Store whether a material is shared, and the hashes of the structure it was generated from. */
+	static void SetStoredSharedMaterialHashes(UMaterial* Material, const UMGFXMaterial* InMGFXMaterial, bool bIsShared);
+
+	/** Return true if a layer is being generated for a preview material with live parameters, and shouldn't be optimized. */
+	bool IsLayerLive(const UMGFXMaterialLayer* Layer) const;
+
+	/** Return true if a layer's transform is applied using parameters, instead of being baked into the uvs of its static parents. */
+	bool IsTransformParameterized(const UMGFXMaterialLayer* Layer) const;
+
+	/** Return the hash used to determine if a layer's previously generated expressions can be reused. */
+	uint32 GetGeneratedLayerHash(const UMGFXMaterialLayer* Layer) const;
+
+	/** Resolve the parameter names of every editable property of all layers, for fast interactive edits. */
+	void BuildPropertyParameters();
+
+	/** Add the parameters of a property of a layer, shape, or visual to the newly generated material. */
+	FMGFXPropertyParameters& AddPropertyParameters(const UObject* Object, FName PropertyName, EMGFXMaterialShapeInputType Type,
+	                                               const FString& ParamName, const FString& ParamNameY = FString());
+
+	/** Find all reusable expressions from the last generate, and delete the rest. */
+	void PrepareReusableExpressions(UMaterial* OutputMaterial);
+
+	/** Recursively find layers whose previously generated expressions can be reused. */
+	void FindReusableLayers(const TArray<TObjectPtr<UMGFXMaterialLayer>>& Layers, bool bIsParentReusable,
+	                        const TSet<UMaterialExpression*>& MaterialExpressions, TSet<UMaterialExpression*>& OutKeepExpressions);
+
+	/** Move a reused expression group to the current position, and advance the position as if it was just generated. */
+	void RelocateExpressionGroup(FMGFXGeneratedExpressionGroup& Group);
+
+	/**
+	 * Replace expressions that were merged with identical ones in all newly generated groups and layer outputs,
+	 * so that layers sharing merged expressions can still be reused.
+	 */
+	void RemapMergedExpressions(const TMap<UMaterialExpression*, UMaterialExpression*>& MergedExpressions);
+
+	/** Replace merged expressions in a group, keeping each remaining expression once. */
+	static void RemapGroupExpressions(FMGFXGeneratedExpressionGroup& Group, const TMap<UMaterialExpression*, UMaterialExpression*>& MergedExpressions);
+
+	/** Start recording newly created expressions into a group. */
+	void BeginExpressionGroup(FMGFXGeneratedExpressionGroup& Group);
+
+	/** Stop recording newly created expressions into a group. */
+	void EndExpressionGroup(FMGFXGeneratedExpressionGroup& Group);
+
+	/** Recursively add the cost of each layer to a report. */
+	void AddLayerCosts(const TArray<TObjectPtr<UMGFXMaterialLayer>>& Layers, int32 Depth, const FMGFXGeneratedMaterial* Generated,
+	                   FMGFXMaterialCostReport& Report) const;
+
+	/** Return true if scalar parameters should be packed into vector parameters. */
+	bool ShouldPackParameters() const;
+
+	/** Return true if no values should be optimized out, because every property is animatable or the material is shared. */
+	bool ShouldParameterizeAllValues() const;
+
+	/**
+	 * Find or create a vector parameter with enough free channels to pack scalar parameters, and store the values.
+	 * Returns the vector parameter, and the first channel of the packed values.
+	 */
+	UMaterialExpressionVectorParameter* AllocatePackedChannels(const FVector2D& NodePos, TConstArrayView<float> Values, TConstArrayView<FString> ParamNames,
+	                                                           const FName& ParamGroup, int32 SortPriority, int32& OutChannel);
+
+	/** Stop packing parameters into the current vector parameter. */
+	void ResetPackedParameter();
+
+	/** Return the name of the output of a shape expression that contains the SDF. */
+	static FString GetShapeOutputName(const UMaterialExpression* ShapeExp);
+
+	/** Compute the rows of a 2x3 matrix that applies the inverse of a transform to uvs. */
+	static void GetInverseTransformRows(const FTransform2D& Transform, FVector2f& OutAxisX, FVector2f& OutAxisY, FVector2f& OutOffset);
+
+	/** Add an expression as an input to the generated HLSL, returning the input name to use in code. */
+	FString AddHLSLInput(UMaterialExpression* InputExp, const FString& Name);
+
+	/** Add a local variable to the generated HLSL, returning the unique variable name. */
+	FString AddHLSLVariable(const FString& Type, const FString& Name, const FString& Value);
+
+	/** Generate HLSL that evaluates an animation, returning the variable. Rotations are output as the packed rotation used by transforms. */
+	FString GenerateAnimationHLSL(const FMGFXPropertyAnimation& Animation, EMGFXMaterialShapeInputType Type, bool bIsRotation = false);
+
+	/** Return the HLSL type of a shape input type. */
+	static FString GetHLSLType(EMGFXMaterialShapeInputType Type);
+
+	/** Return an HLSL literal for a value. */
+	static FString ToHLSL(float Value);
+	static FString ToHLSL(const FVector2f& Value);
+	static FString ToHLSL(const FLinearColor& Value);
+
+	/** Return an HLSL literal for a value stored the same way as shape inputs. */
+	static FString ToHLSL(const FLinearColor& Value, EMGFXMaterialShapeInputType Type);
+
+	/** Previously generated expressions, by output material. */
+	TMap<TWeakObjectPtr<UMaterial>, FMGFXGeneratedMaterial> GeneratedMaterials;
+
+	/** The previously generated expressions for the material currently being generated. */
+	FMGFXGeneratedMaterial* LastGenerated = nullptr;
+
+	/** The newly generated expressions for the material currently being generated. */
+	FMGFXGeneratedMaterial NewGenerated;
+
+	/** Layers whose previously generated expressions will be reused. */
+	TSet<const UMGFXMaterialLayer*> ReusableLayers;
+
+	/** True if the previously generated boilerplate will be reused. */
+	bool bReuseBoilerplate = false;
+
+	/** Expressions that were moved with a reused group, since groups may share merged expressions. */
+	TSet<const UMaterialExpression*> RelocatedExpressions;
+
+	/** The expression group currently being recorded. */
+	FMGFXGeneratedExpressionGroup* RecordingGroup = nullptr;
+
+	/** The vector parameter that scalar parameters are currently being packed into. */
+	UMaterialExpressionVectorParameter* PackedParamExp = nullptr;
+
+	/** The number of channels used in the current packed vector parameter. */
+	int32 NumPackedChannels = 0;
+
+	/** The input name of the current packed vector parameter in the generated HLSL. */
+	FString PackedParamHLSLInput;
+
+	/** The HLSL code being generated for all layers. */
+	FString HLSLCode;
+
+	/** The expressions connected as inputs to the generated HLSL, by input name. */
+	TArray<TPair<FName, UMaterialExpression*>> HLSLInputs;
+
+	/** The shader files to include for the generated HLSL. */
+	TArray<FString> HLSLIncludeFilePaths;
+
+	/** The number of local variables in the generated HLSL, used to create unique names. */
+	int32 NumHLSLVariables = 0;
+
+	/** The input name of the animation time in the generated HLSL, shared by all animations. */
+	FString AnimationTimeHLSLInput;
+
 	/** The MGFXMaterial that is being used to generate a material. */
 	TObjectPtr<UMGFXMaterial> MGFXMaterial = nullptr;
 
-	/* When true, no parameters will be optimized out to allow full interactive editing. */
+	/* When true, no parameters of live preview layers will be optimized out to allow full interactive editing. */
 	bool bIsPreviewMaterial = false;
 
+	/** When true, only LivePreviewLayers are generated with live parameters in preview materials. */
+	bool bLimitLivePreviewLayers = false;
+
+	/** The layers generated with live parameters in preview materials, when bLimitLivePreviewLayers is true. */
+	TSet<TWeakObjectPtr<const UMGFXMaterialLayer>> LivePreviewLayers;
+
 	/** The builder use to author the material. */
 	FMGFXMaterialBuilder Builder;
 
@@ -148,7 +676,8 @@ public:
 
 	FString Param_LocationX;
 	FString Param_LocationY;
-	FString Param_Rotation;
+	FString Param_RotationAxis;
 	FString Param_ScaleX;
 	FString Param_ScaleY;
+	FString Param_AnimationTime;
 };
@@ -7,6 +7,36 @@
 #include "UObject/PropertyAccessUtil.h"
 
 
+namespace MGFXPropertyAccess
+{
+	/**
+	 * The change notify mode used by the SET_PROP macros.
+	 * FMGFXMaterialGenerator sets this to Never with FMGFXScopedPropertyNotifyMode while generating,
+	 * so new expressions don't receive a notification for every property.
+	 */
+	extern MGFXEDITOR_API EPropertyAccessChangeNotifyMode NotifyMode;
+}
+
+
+/** Override the change notify mode of the SET_PROP macros within a scope. */
+struct FMGFXScopedPropertyNotifyMode
+{
+	explicit FMGFXScopedPropertyNotifyMode(EPropertyAccessChangeNotifyMode InNotifyMode)
+		: PrevNotifyMode(MGFXPropertyAccess::NotifyMode)
+	{
+		MGFXPropertyAccess::NotifyMode = InNotifyMode;
+	}
+
+	~FMGFXScopedPropertyNotifyMode()
+	{
+		MGFXPropertyAccess::NotifyMode = PrevNotifyMode;
+	}
+
+private:
+	EPropertyAccessChangeNotifyMode PrevNotifyMode;
+};
+
+
 /** Returns FName(TEXT("MemberName")) while statically checking that the member exists on Object */
 #define GET_INST_MEMBER_NAME_CHECKED(Object, MemberName) \
 	((void)sizeof(UEAsserts_Private::GetMemberNameCheckedJunk(Object->MemberName)), FName(TEXT(#MemberName)))
@@ -15,12 +45,12 @@
 #define FIND_PROP(Object, MemberName) \
 	PropertyAccessUtil::FindPropertyByName(GET_INST_MEMBER_NAME_CHECKED(Object, MemberName), Object->GetClass())
 
-/** Set the property of an object, ensuring property change callbacks are triggered. */
+/** Set the property of an object, triggering property change callbacks unless notifications are disabled. */
 #define SET_PROP(Object, MemberName, Value) \
 	{ \
 		const FProperty* Prop = FIND_PROP(Object, MemberName); \
 		PropertyAccessUtil::SetPropertyValue_Object(Prop, Object, Prop, &Value, \
-													INDEX_NONE, PropertyAccessUtil::EditorReadOnlyFlags, EPropertyAccessChangeNotifyMode::Default); \
+													INDEX_NONE, PropertyAccessUtil::EditorReadOnlyFlags, MGFXPropertyAccess::NotifyMode); \
 	}
 
 /** Set the property of an object, accepting an r-value. */
@@ -29,12 +59,12 @@
 		const FProperty* Prop = FIND_PROP(Object, MemberName); \
 		auto Value = RValue; \
 		PropertyAccessUtil::SetPropertyValue_Object(Prop, Object, Prop, &Value, \
-													INDEX_NONE, PropertyAccessUtil::EditorReadOnlyFlags, EPropertyAccessChangeNotifyMode::Default); \
+													INDEX_NONE, PropertyAccessUtil::EditorReadOnlyFlags, MGFXPropertyAccess::NotifyMode); \
 	}
 
 #define SET_PROP_PTR(Object, MemberName, PtrValue) \
 	{ \
 		const FProperty* Prop = FIND_PROP(Object, MemberName); \
 		PropertyAccessUtil::SetPropertyValue_Object(Prop, Object, Prop, PtrValue, \
-													INDEX_NONE, PropertyAccessUtil::EditorReadOnlyFlags, EPropertyAccessChangeNotifyMode::Default); \
+													INDEX_NONE, PropertyAccessUtil::EditorReadOnlyFlags, MGFXPropertyAccess::NotifyMode); \
 	}